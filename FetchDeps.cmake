@@ -7,3 +7,12 @@ if (${PANDALIB_TESTS})
     )
     FetchContent_MakeAvailable(Catch2)
 endif()
+
+if (${PANDALIB_BENCH})
+    FetchContent_Declare(benchmark
+        GIT_REPOSITORY https://github.com/google/benchmark.git
+        GIT_TAG main
+    )
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+    FetchContent_MakeAvailable(benchmark)
+endif()
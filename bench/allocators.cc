@@ -0,0 +1,190 @@
+#include <panda/memory.h>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+/*
+ * Allocator benchmarks: panda pools vs malloc (the one this binary is linked with: glibc, jemalloc or tcmalloc) vs std::pmr pools.
+ * Run with --benchmark_filter=<regex>, e.g. --benchmark_filter=ProducerConsumer
+ */
+
+using namespace panda;
+
+namespace {
+
+struct Malloc {
+    static void* allocate   (size_t size)          { return malloc(size); }
+    static void  deallocate (void* p, size_t)      { free(p); }
+};
+
+struct Pool {
+    static void* allocate   (size_t size)          { return DynamicMemoryPool::instance()->allocate(size); }
+    static void  deallocate (void* p, size_t size) { DynamicMemoryPool::instance()->deallocate(p, size); }
+};
+
+struct PmrSync {
+    static std::pmr::synchronized_pool_resource& resource () {
+        static std::pmr::synchronized_pool_resource ret;
+        return ret;
+    }
+    static void* allocate   (size_t size)          { return resource().allocate(size); }
+    static void  deallocate (void* p, size_t size) { resource().deallocate(p, size); }
+};
+
+// not thread-safe, so never used with cross-thread frees
+struct PmrUnsync {
+    static std::pmr::unsynchronized_pool_resource& resource () {
+        static thread_local std::pmr::unsynchronized_pool_resource ret;
+        return ret;
+    }
+    static void* allocate   (size_t size)          { return resource().allocate(size); }
+    static void  deallocate (void* p, size_t size) { resource().deallocate(p, size); }
+};
+
+// typical object sizes: mostly small, some medium, rare big ones
+std::vector<size_t> make_sizes (size_t cnt) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> small(8, 128), medium(129, 4096), big(4097, 65536);
+    std::uniform_int_distribution<int> kind(0, 99);
+    std::vector<size_t> ret(cnt);
+    for (auto& size : ret) {
+        int k = kind(gen);
+        size = k < 85 ? small(gen) : k < 99 ? medium(gen) : big(gen);
+    }
+    return ret;
+}
+
+std::vector<size_t> make_order (size_t cnt) {
+    std::vector<size_t> ret(cnt);
+    for (size_t i = 0; i < cnt; ++i) ret[i] = i;
+    std::shuffle(ret.begin(), ret.end(), std::mt19937(43));
+    return ret;
+}
+
+}
+
+// batch of equal blocks allocated and freed in LIFO order, per thread
+template <class A>
+static void Fixed (benchmark::State& state) {
+    const size_t size = state.range(0);
+    void* ptrs[1000];
+    for (auto _ : state) {
+        for (auto& p : ptrs) p = A::allocate(size);
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t i = 1000; i-- > 0;) A::deallocate(ptrs[i], size);
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+// the pool's own fast path for reference
+static void FixedStaticPool (benchmark::State& state) {
+    void* ptrs[1000];
+    for (auto _ : state) {
+        for (auto& p : ptrs) p = StaticMemoryPool<64>::allocate();
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t i = 1000; i-- > 0;) StaticMemoryPool<64>::deallocate(ptrs[i]);
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+static void FixedStaticPoolBulk (benchmark::State& state) {
+    void* ptrs[1000];
+    for (auto _ : state) {
+        StaticMemoryPool<64>::allocate_bulk(1000, ptrs);
+        benchmark::DoNotOptimize(ptrs);
+        StaticMemoryPool<64>::deallocate_bulk(1000, ptrs);
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+// working set of range(0) blocks of mixed sizes, each iteration frees and reallocates all of them in random order
+template <class A>
+static void Mixed (benchmark::State& state) {
+    const size_t cnt = state.range(0);
+    auto sizes = make_sizes(cnt);
+    auto order = make_order(cnt);
+    std::vector<void*> ptrs(cnt);
+    for (size_t i = 0; i < cnt; ++i) ptrs[i] = A::allocate(sizes[i]);
+
+    for (auto _ : state) {
+        for (auto i : order) {
+            A::deallocate(ptrs[i], sizes[i]);
+            ptrs[i] = A::allocate(sizes[i]);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+    }
+
+    for (size_t i = 0; i < cnt; ++i) A::deallocate(ptrs[i], sizes[i]);
+    state.SetItemsProcessed(state.iterations() * cnt);
+}
+
+/*
+ * Threads work in pairs: even thread allocates blocks and passes them to the odd one through a ring buffer, the odd one frees them.
+ * Every block is freed by a thread which did not allocate it.
+ */
+namespace {
+    struct alignas(64) Ring {
+        static constexpr const size_t SIZE = 4096;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        void* items[SIZE];
+
+        void push (void* p) {
+            auto h = head.load(std::memory_order_relaxed);
+            while (h - tail.load(std::memory_order_acquire) == SIZE) std::this_thread::yield();
+            items[h % SIZE] = p;
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        void* pop () {
+            auto t = tail.load(std::memory_order_relaxed);
+            while (head.load(std::memory_order_acquire) == t) std::this_thread::yield();
+            void* ret = items[t % SIZE];
+            tail.store(t + 1, std::memory_order_release);
+            return ret;
+        }
+    };
+
+    Ring rings[32];
+}
+
+template <class A>
+static void ProducerConsumer (benchmark::State& state) {
+    const size_t size  = state.range(0);
+    const size_t batch = 1000;
+    auto& ring = rings[state.thread_index() / 2];
+    bool producer = state.thread_index() % 2 == 0;
+
+    for (auto _ : state) {
+        if (producer) for (size_t i = 0; i < batch; ++i) ring.push(A::allocate(size));
+        else          for (size_t i = 0; i < batch; ++i) A::deallocate(ring.pop(), size);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+#define FIXED(A)    BENCHMARK_TEMPLATE(Fixed, A)->Arg(16)->Arg(64)->Arg(1024)->Arg(16384)->ThreadRange(1, 8)->UseRealTime()
+#define MIXED(A)    BENCHMARK_TEMPLATE(Mixed, A)->Arg(1000)->Arg(100000)->Arg(1000000)->Threads(1)->Threads(4)->UseRealTime()
+#define PRODCONS(A) BENCHMARK_TEMPLATE(ProducerConsumer, A)->Arg(16)->Arg(256)->Arg(4096)->Threads(2)->Threads(4)->Threads(8)->UseRealTime()
+
+FIXED(Malloc);
+FIXED(Pool);
+FIXED(PmrSync);
+FIXED(PmrUnsync);
+BENCHMARK(FixedStaticPool)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(FixedStaticPoolBulk)->ThreadRange(1, 8)->UseRealTime();
+
+MIXED(Malloc);
+MIXED(Pool);
+MIXED(PmrSync);
+MIXED(PmrUnsync);
+
+PRODCONS(Malloc);
+PRODCONS(Pool);
+PRODCONS(PmrSync);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#include <panda/from_chars.h>
+#include <benchmark/benchmark.h>
+#include <charconv>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+/*
+ * Integer parsing benchmarks: panda::from_chars vs std::from_chars vs strtoull on fields like in text protocols.
+ * Argument is the maximum number of digits, lengths are uniformly distributed in [1, max].
+ */
+
+namespace {
+
+struct PandaFromChars {
+    static const char* parse (const char* p, const char* end, uint64_t& val) { return panda::from_chars(p, end, val).ptr; }
+};
+
+struct PandaFromCharsStrict {
+    static const char* parse (const char* p, const char* end, uint64_t& val) { return panda::from_chars_strict(p, end, val).ptr; }
+};
+
+struct StdFromChars {
+    static const char* parse (const char* p, const char* end, uint64_t& val) { return std::from_chars(p, end, val).ptr; }
+};
+
+struct Strtoull {
+    static const char* parse (const char* p, const char*, uint64_t& val) {
+        char* end;
+        val = strtoull(p, &end, 10);
+        return end;
+    }
+};
+
+// space-separated numbers
+std::string make_fields (size_t cnt, size_t max_digits) {
+    std::mt19937_64 gen(1);
+    std::string ret;
+    for (size_t i = 0; i < cnt; ++i) {
+        auto len = gen() % max_digits + 1;
+        ret += char('1' + gen() % 9);
+        for (size_t j = 1; j < len; ++j) ret += char('0' + gen() % 10);
+        ret += ' ';
+    }
+    return ret;
+}
+
+}
+
+template <class Impl>
+static void ParseFields (benchmark::State& state) {
+    const size_t cnt = 10000;
+    auto data = make_fields(cnt, state.range(0));
+    for (auto _ : state) {
+        const char* p   = data.data();
+        const char* end = p + data.size();
+        uint64_t sum = 0, val;
+        while (p != end) {
+            p = Impl::parse(p, end, val) + 1;
+            sum += val;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * cnt);
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+#define FIELDS(A) BENCHMARK_TEMPLATE(ParseFields, A)->Arg(4)->Arg(10)->Arg(20)
+
+FIELDS(PandaFromChars);
+FIELDS(PandaFromCharsStrict);
+FIELDS(StdFromChars);
+FIELDS(Strtoull);
+
+BENCHMARK_MAIN();
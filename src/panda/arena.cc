@@ -0,0 +1,86 @@
+#include "arena.h"
+#include <string.h>
+#include <stdlib.h>
+
+namespace panda {
+
+thread_local Arena* Arena::_current;
+
+Arena& detail::__current_arena () {
+    auto ret = Arena::current();
+    if (!ret) throw std::logic_error("no current panda::Arena, create Arena::Scope first");
+    return *ret;
+}
+
+Arena::Arena (size_t chunk_size) : last(NULL), pos(NULL), end(NULL), _reserved(0) {
+    next_chunk_size = chunk_size < sizeof(Chunk) * 2 ? sizeof(Chunk) * 2 : chunk_size;
+}
+
+void* Arena::allocate_slow (size_t size, size_t align) {
+    size_t need = sizeof(Chunk) + size + align;
+    size_t chunk_size = next_chunk_size;
+    if (chunk_size < need) chunk_size = need;
+    else if (next_chunk_size < MAX_CHUNK_SIZE) next_chunk_size *= 2;
+
+    auto chunk = (Chunk*)malloc(chunk_size);
+    if (!chunk) throw std::bad_alloc();
+    chunk->prev = last;
+    chunk->size = chunk_size;
+    _reserved += chunk_size;
+    use_chunk(chunk, (char*)(chunk + 1));
+
+    uintptr_t ret = ((uintptr_t)pos + align - 1) & ~(uintptr_t)(align - 1);
+    pos = (char*)ret + size;
+    return (void*)ret;
+}
+
+void* Arena::reallocate (void* ptr, size_t need, size_t old, size_t align) {
+    if (ptr && (char*)ptr + old == pos && (char*)ptr + need <= end) {
+        pos = (char*)ptr + need;
+        return ptr;
+    }
+    void* ret = allocate(need, align);
+    if (ptr) memcpy(ret, ptr, old < need ? old : need);
+    return ret;
+}
+
+void Arena::use_chunk (Chunk* chunk, char* pos) {
+    last      = chunk;
+    this->pos = pos;
+    end       = (char*)chunk + chunk->size;
+}
+
+void Arena::free_chunk (Chunk* chunk) {
+    _reserved -= chunk->size;
+    free(chunk);
+}
+
+void Arena::rewind (const Marker& marker) {
+    while (last != marker.chunk) {
+        auto prev = last->prev;
+        free_chunk(last);
+        last = prev;
+    }
+    if (last) use_chunk(last, marker.pos);
+    else      pos = end = NULL;
+}
+
+void Arena::reset () {
+    if (!last) return;
+    while (last->prev) {
+        auto prev = last->prev->prev;
+        free_chunk(last->prev);
+        last->prev = prev;
+    }
+    use_chunk(last, (char*)(last + 1));
+}
+
+void Arena::clear () {
+    rewind(Marker{NULL, NULL});
+}
+
+Arena::~Arena () {
+    clear();
+}
+
+}
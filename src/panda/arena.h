@@ -0,0 +1,176 @@
+#pragma once
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdexcept>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#  if __has_include(<memory_resource>)
+#    include <memory_resource>
+#    define PANDA_ARENA_HAS_PMR 1
+#  endif
+#endif
+
+namespace panda {
+
+/*
+ * Monotonic bump-pointer allocator for objects which die together (e.g. everything allocated while processing a request).
+ * Memory is taken from the system in chunks which grow twice each time up to MAX_CHUNK_SIZE. deallocate() does nothing except for the last
+ * allocation, everything is freed at once by reset() or rewind() in O(chunks) time. Objects' destructors are not called by arena.
+ * Arena is not thread-safe.
+ */
+struct Arena {
+    static constexpr const size_t DEFAULT_CHUNK_SIZE = 4096;
+    static constexpr const size_t MAX_CHUNK_SIZE     = 1024*1024;
+
+    struct Marker {
+        void* chunk;
+        char* pos;
+    };
+
+    // makes arena current for this thread while in scope, used by ArenaStaticAllocator and ArenaAllocatedObject
+    struct Scope {
+        Scope (Arena& arena) : prev(_current) { _current = &arena; }
+        ~Scope ()                             { _current = prev; }
+
+        Scope (const Scope&) = delete;
+        Scope& operator= (const Scope&) = delete;
+
+    private:
+        Arena* prev;
+    };
+
+    explicit Arena (size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    Arena (const Arena&) = delete;
+    Arena& operator= (const Arena&) = delete;
+
+    void* allocate (size_t size, size_t align = sizeof(void*)) {
+        uintptr_t ret = ((uintptr_t)pos + align - 1) & ~(uintptr_t)(align - 1);
+        if (ret + size > (uintptr_t)end || !pos) return allocate_slow(size, align);
+        pos = (char*)ret + size;
+        return (void*)ret;
+    }
+
+    // only the last allocation is really freed
+    void deallocate (void* ptr, size_t size) {
+        if ((char*)ptr + size == pos) pos = (char*)ptr;
+    }
+
+    // grows the last allocation in place if possible
+    void* reallocate (void* ptr, size_t need, size_t old, size_t align = sizeof(void*));
+
+    // rewind() frees everything allocated after mark()
+    Marker mark   () const { return Marker{last, pos}; }
+    void   rewind (const Marker&);
+
+    // frees everything, keeps the last chunk for reuse
+    void reset ();
+
+    // frees everything
+    void clear ();
+
+    // bytes taken from the system
+    size_t reserved () const { return _reserved; }
+
+    ~Arena ();
+
+    // arena set by the innermost Scope in this thread or NULL
+    static Arena* current () { return _current; }
+
+private:
+    struct Chunk {
+        Chunk* prev;
+        size_t size; // including header
+    };
+
+    Chunk* last;
+    char*  pos;
+    char*  end;
+    size_t next_chunk_size;
+    size_t _reserved;
+
+    static thread_local Arena* _current;
+
+    void* allocate_slow (size_t size, size_t align);
+    void  free_chunk    (Chunk*);
+    void  use_chunk     (Chunk*, char* pos);
+};
+
+namespace detail {
+    Arena& __current_arena ();
+}
+
+// static allocator for basic_string and other places which accept DefaultStaticAllocator, allocates from Arena::current()
+template <class T>
+struct ArenaStaticAllocator {
+    typedef T value_type;
+
+    static constexpr const size_t ALIGN = alignof(T) > sizeof(void*) ? alignof(T) : sizeof(void*);
+
+    static T* allocate (size_t n) {
+        return (T*)detail::__current_arena().allocate(n * sizeof(T), ALIGN);
+    }
+
+    // memory is freed by arena's reset(), buffer may have been allocated by another arena
+    static void deallocate (T*, size_t) {}
+
+    static T* reallocate (T* mem, size_t need, size_t old) {
+        return (T*)detail::__current_arena().reallocate(mem, need * sizeof(T), old * sizeof(T), ALIGN);
+    }
+};
+
+// standard allocator for STL containers bound to an arena
+template <class T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    ArenaAllocator (Arena& arena) : arena(&arena) {}
+
+    template <class U>
+    ArenaAllocator (const ArenaAllocator<U>& oth) : arena(oth.arena) {}
+
+    T* allocate (size_t n) {
+        return (T*)arena->allocate(n * sizeof(T), alignof(T) > sizeof(void*) ? alignof(T) : sizeof(void*));
+    }
+
+    void deallocate (T* p, size_t n) { arena->deallocate(p, n * sizeof(T)); }
+
+    template <class U> bool operator== (const ArenaAllocator<U>& oth) const { return arena == oth.arena; }
+    template <class U> bool operator!= (const ArenaAllocator<U>& oth) const { return arena != oth.arena; }
+
+    Arena* arena;
+};
+
+// same as AllocatedObject, but objects are allocated from Arena::current() or from arena passed to new: new (arena) Obj()
+template <class TARGET>
+struct ArenaAllocatedObject {
+    static void* operator new (size_t, void* p) { return p; }
+
+    static void* operator new (size_t size, Arena& arena) {
+        return arena.allocate(size, alignof(TARGET) > sizeof(void*) ? alignof(TARGET) : sizeof(void*));
+    }
+
+    static void* operator new (size_t size) {
+        return operator new(size, detail::__current_arena());
+    }
+
+    static void operator delete (void*, size_t) {}
+    static void operator delete (void*, Arena&) {} // if constructor throws
+};
+
+#ifdef PANDA_ARENA_HAS_PMR
+// adapter for std::pmr containers
+struct ArenaResource : std::pmr::memory_resource {
+    ArenaResource (Arena& arena) : arena(arena) {}
+
+private:
+    Arena& arena;
+
+    void* do_allocate   (size_t bytes, size_t align) override            { return arena.allocate(bytes, align); }
+    void  do_deallocate (void* p, size_t bytes, size_t) override         { arena.deallocate(p, bytes); }
+    bool  do_is_equal   (const memory_resource& oth) const noexcept override { return this == &oth; }
+};
+#endif
+
+}
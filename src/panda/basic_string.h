@@ -2,6 +2,8 @@
 #include "hash.h"
 #include "from_chars.h"
 #include "string_view.h"
+#include "string_search.h"
+#include <atomic>
 #include <string>
 #include <limits>
 #include <memory>
@@ -87,6 +89,14 @@ namespace string_detail {
     };
 
     static_assert(sizeof(Buffer<char>) % 8 == 0, "Alignment problem, sizeof(Buffer<char>) should be 8 on 32-bit platforms and 16 on 64");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic refcnt must have the same layout as plain one");
+
+    // allocators with "static constexpr bool atomic_refcnt = true" make strings with thread-safe reference counter
+    template <class Alloc, class = void>
+    struct has_atomic_refcnt : std::false_type {};
+
+    template <class Alloc>
+    struct has_atomic_refcnt<Alloc, typename std::enable_if<Alloc::atomic_refcnt>::type> : std::true_type {};
 
     template <class CharT>
     struct ExternalShared : Buffer<CharT> {
@@ -94,6 +104,10 @@ namespace string_detail {
         dtor_fn dtor; // deallocator for ExternalShared, may differ from Alloc::deallocate !
         CharT*  ptr;  // pointer to external data originally passed to string's constructor
     };
+
+    // maps whole file copy-on-write, returns NULL for empty file, throws std::system_error. Implemented in unix/win string_mmap.cc
+    char* mmap_file   (basic_string_view<char> path, size_t& size, int advice);
+    void  munmap_file (char* ptr, size_t size);
 }
 
 template <class T>
@@ -117,6 +131,16 @@ struct DefaultStaticAllocator {
     }
 };
 
+/*
+ * Same as DefaultStaticAllocator, but strings using it have atomic reference counter, so that copies of one string may live in different threads.
+ * Layout is the same as of other strings. Conversions from/to strings with non-atomic counter move the buffer if it's not shared, otherwise
+ * the content is copied.
+ */
+template <class T>
+struct SharedStaticAllocator : DefaultStaticAllocator<T> {
+    static constexpr const bool atomic_refcnt = true;
+};
+
 // GCC fails to determine maybe-uninitialized cases correctly for this code
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
@@ -156,6 +180,7 @@ private:
     static constexpr const size_type EBUF_CHARS    = sizeof(ExternalShared) / sizeof(CharT);
     static constexpr const size_type MAX_SSO_BYTES = 3 * sizeof(void*) - 1; // last byte for _state
     static constexpr const float     GROW_RATE     = 1.6;
+    static constexpr const bool      FAST_SEARCH   = string_search::enabled<CharT, Traits>::value;
     static const CharT TERMINAL;
 
     union {
@@ -185,6 +210,13 @@ public:
     static const size_type npos          = std::numeric_limits<size_type>::max();
     static const size_type MAX_SSO_CHARS = (MAX_SSO_BYTES / sizeof(CharT));
     static const size_type MAX_SIZE      = npos / sizeof(CharT) - BUF_CHARS;
+    static constexpr const bool ATOMIC_REFCNT = string_detail::has_atomic_refcnt<Alloc>::value; // thread-safe refcnt, see SharedStaticAllocator
+
+    // advice for from_file_mmap()
+    static constexpr const int MMAP_NORMAL     = 0;
+    static constexpr const int MMAP_SEQUENTIAL = 1;
+    static constexpr const int MMAP_RANDOM     = 2;
+    static constexpr const int MMAP_WILLNEED   = 4;
 
     basic_string () noexcept : _str_literal(&TERMINAL), _length(0), _state(State::LITERAL) {}
 
@@ -332,7 +364,7 @@ public:
     }
 
     basic_string& assign (CharT* str, size_type len, size_type capacity, dtor_fn dtor) {
-        if (_state != State::EXTERNAL || _storage.external->refcnt != 1) {
+        if (_state != State::EXTERNAL || _refcnt(_storage.external) != 1) {
             _release();
             _new_external(str, len, capacity, dtor, (ExternalShared*)Alloc::allocate(EBUF_CHARS), &Alloc::deallocate);
         }
@@ -457,8 +489,8 @@ public:
 
     size_type capacity () const {
         switch (_state) {
-            case State::INTERNAL: return _storage.internal->refcnt == 1 ? _capacity_internal() : 0;
-            case State::EXTERNAL: return _storage.external->refcnt == 1 ? _capacity_external() : 0;
+            case State::INTERNAL: return _refcnt(_storage.internal) == 1 ? _capacity_internal() : 0;
+            case State::EXTERNAL: return _refcnt(_storage.external) == 1 ? _capacity_external() : 0;
             case State::LITERAL:  return 0;
             case State::SSO:      return _capacity_sso();
         }
@@ -479,7 +511,7 @@ public:
         switch (_state) {
             case State::INTERNAL:
             case State::EXTERNAL:
-                return _storage.any->refcnt;
+                return _refcnt(_storage.any);
             default: return 1;
         }
     }
@@ -520,7 +552,7 @@ public:
                     _release_internal(old_buf, old_dtor);
                 }
                 else if (_storage.internal->capacity > _length) {
-                    if (_storage.internal->refcnt == 1) _internal_realloc(_length);
+                    if (_refcnt(_storage.internal) == 1) _internal_realloc(_length);
                     // else _detach_cow(_length); // NOTE: it's a very hard question should or should not we do it, NOT FOR NOW
                 }
                 break;
@@ -532,7 +564,7 @@ public:
                     _release_external(old_buf, old_dtor);
                 }
                 else if (_storage.external->capacity > _length) {
-                    if (_storage.external->refcnt == 1) _external_realloc(_length);
+                    if (_refcnt(_storage.external) == 1) _external_realloc(_length);
                     // else _detach_cow(_length); // NOTE: it's a very hard question should or should not we do it, NOT FOR NOW
                 }
                 break;
@@ -544,6 +576,12 @@ public:
 
     template <class Alloc2>
     void swap (basic_string<CharT, Traits, Alloc2>& oth) {
+        if (ATOMIC_REFCNT != basic_string<CharT, Traits, Alloc2>::ATOMIC_REFCNT) { // shared buffers can't change refcnt policy
+            basic_string tmp(std::move(*this));
+            assign(std::move(oth));
+            oth.assign(std::move(tmp));
+            return;
+        }
         std::swap(_str, oth._str);
         std::swap(_length, oth._length);
         if (_state == State::SSO) oth._str = oth._sso + (oth._str - _sso);
@@ -579,7 +617,7 @@ public:
         switch (_state) {
             case State::INTERNAL:
             case State::EXTERNAL:
-                if (_storage.any->refcnt == 1) {
+                if (_refcnt(_storage.any) == 1) {
             case State::SSO:
                     // move tail or head depending on what is shorter
                     if (pos >= _length - pos) traits_type::move(_str + pos, _str + pos + count, _length - pos); // tail is shorter
@@ -589,12 +627,16 @@ public:
                     }
                     break;
                 }
-                else --_storage.any->refcnt; // fallthrough
+                else { // release shared buffer only after copying, another owner may free it right after we release
+                    auto old_state = _state;
+                    auto old_buf   = _storage.any;
+                    auto old_dtor  = _storage.dtor;
+                    _erase_new(pos, count);
+                    _release(old_state, old_buf, old_dtor);
+                    break;
+                }
             case State::LITERAL:
-                auto old_str = _str;
-                _new_auto(_length);
-                traits_type::copy(_str, old_str, pos);
-                traits_type::copy(_str + pos, old_str + pos + count, _length - pos);
+                _erase_new(pos, count);
                 break;
         }
         return *this;
@@ -674,6 +716,7 @@ public:
     size_type find (const CharT* s, size_type pos, size_type count) const {
         if (pos > _length) return npos;
         if (count == 0) return pos;
+        if (FAST_SEARCH) return _search_offset(string_search::find(_search_ptr(pos), _length - pos, (const char*)s, count), pos);
 
         const CharT* ptr = traits_type::find(_str + pos, _length - pos, *s);
         const CharT* end = _str + _length;
@@ -712,6 +755,8 @@ public:
     }
 
     size_type rfind (const CharT* s, size_type pos, size_type count) const {
+        if (count > _length) return npos;
+        if (FAST_SEARCH && count) return string_search::rfind(_search_ptr(0), (pos >= _length - count ? _length - count : pos) + count, (const char*)s, count);
         for (const CharT* ptr = _str + ((pos >= _length - count) ? (_length - count) : pos); ptr >= _str; --ptr)
             if (traits_type::compare(ptr, s, count) == 0) return ptr - _str;
         return npos;
@@ -728,6 +773,7 @@ public:
     }
 
     size_type rfind (CharT ch, size_type pos = npos) const {
+        if (FAST_SEARCH) return string_search::rfind_char(_search_ptr(0), pos >= _length ? _length : (pos+1), (char)ch);
         const CharT* ptr = _str + (pos >= _length ? _length : (pos+1));
         while (--ptr >= _str) if (traits_type::eq(*ptr, ch)) return ptr - _str;
         return npos;
@@ -744,6 +790,7 @@ public:
 
     size_type find_first_of (const CharT* s, size_type pos, size_type count) const {
         if (count == 0) return npos;
+        if (FAST_SEARCH) return pos >= _length ? npos : _search_offset(string_search::find_of(_search_ptr(pos), _length - pos, (const char*)s, count), pos);
         const CharT* end = _str + _length;
         for (const CharT* ptr = _str + pos; ptr < end; ++ptr) if (traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -774,6 +821,7 @@ public:
 
     size_type find_first_not_of (const CharT* s, size_type pos, size_type count) const {
         if (count == 0) return pos >= _length ? npos : pos;
+        if (FAST_SEARCH) return pos >= _length ? npos : _search_offset(string_search::find_of(_search_ptr(pos), _length - pos, (const char*)s, count, true), pos);
         const CharT* end = _str + _length;
         for (const CharT* ptr = _str + pos; ptr < end; ++ptr) if (!traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -790,6 +838,7 @@ public:
     }
 
     size_type find_first_not_of (CharT ch, size_type pos = 0) const {
+        if (FAST_SEARCH) return find_first_not_of(&ch, pos, 1);
         const CharT* end = _str + _length;
         for (const CharT* ptr = _str + pos; ptr < end; ++ptr) if (!traits_type::eq(*ptr, ch)) return ptr - _str;
         return npos;
@@ -806,6 +855,7 @@ public:
 
     size_type find_last_of (const CharT* s, size_type pos, size_type count) const {
         if (count == 0) return npos;
+        if (FAST_SEARCH) return string_search::rfind_of(_search_ptr(0), pos >= _length ? _length : (pos+1), (const char*)s, count);
         for (const CharT* ptr = _str + (pos >= _length ? (_length - 1) : pos); ptr >= _str; --ptr)
             if (traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -836,6 +886,7 @@ public:
 
     size_type find_last_not_of (const CharT* s, size_type pos, size_type count) const {
         if (count == 0) return pos >= _length ? (_length-1) : pos;
+        if (FAST_SEARCH) return string_search::rfind_of(_search_ptr(0), pos >= _length ? _length : (pos+1), (const char*)s, count, true);
         for (const CharT* ptr = _str + (pos >= _length ? (_length - 1) : pos); ptr >= _str; --ptr)
             if (!traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -852,6 +903,7 @@ public:
     }
 
     size_type find_last_not_of (CharT ch, size_type pos = npos) const {
+        if (FAST_SEARCH) return find_last_not_of(&ch, pos, 1);
         for (const CharT* ptr = _str + (pos >= _length ? (_length - 1) : pos); ptr >= _str; --ptr)
             if (!traits_type::eq(*ptr, ch)) return ptr - _str;
         return npos;
@@ -1139,6 +1191,9 @@ public:
         return from_chars(_str + pos, _str + pos + count, value, base);
     }
 
+    from_chars_result to_number (float&  value, chars_format fmt = chars_format::general) const { return from_chars(_str, _str + _length, value, fmt); }
+    from_chars_result to_number (double& value, chars_format fmt = chars_format::general) const { return from_chars(_str, _str + _length, value, fmt); }
+
     template <typename V>
     static basic_string from_number (V value, int base = 10) {
         auto maxsz = to_chars_maxsize<V>(base);
@@ -1149,6 +1204,35 @@ public:
         return ret;
     }
 
+    // shortest representation which parses back to the same value
+    static basic_string from_number (float  value) { return _from_float(value); }
+    static basic_string from_number (double value) { return _from_float(value); }
+
+    static basic_string from_number (double value, chars_format fmt, int precision) {
+        char buf[128];
+        auto res = to_chars(buf, buf + sizeof(buf), value, fmt, precision);
+        if (!res.ec) return basic_string(buf, res.ptr - buf);
+        basic_string ret(std::max<size_type>(precision, 0) + 400); // the longest one is %f of DBL_MAX
+        res = to_chars(ret._str, ret._str + ret.capacity(), value, fmt, precision);
+        assert(!res.ec);
+        ret.length(res.ptr - ret.data());
+        return ret;
+    }
+
+    /*
+     * Contents of file as EXTERNAL string backed by memory mapping, file is unmapped when the last COW copy (substring) dies.
+     * Pages are read from file on first access and shared with other processes mapping the same file. The mapping is private:
+     * modifying the string never changes the file, but changes made to the file by others may be visible to the string.
+     * advice is a combination of MMAP_* flags (madvise hints). Only regular files can be mapped, others throw std::system_error.
+     */
+    static basic_string from_file_mmap (basic_string_view<char> path, int advice = MMAP_NORMAL) {
+        static_assert(sizeof(CharT) == 1, "only single-byte strings may be mapped from files");
+        size_t size;
+        auto ptr = string_detail::mmap_file(path, size, advice);
+        if (!ptr) return basic_string();
+        return basic_string((CharT*)ptr, size, size, [](CharT* p, size_t sz) { string_detail::munmap_file((char*)p, sz); });
+    }
+
     const CharT* c_str () const {
         if (_state == State::LITERAL) return _str; // LITERALs are NT
         // _str[_length] access to possibly uninititalized memory, UB.
@@ -1236,11 +1320,16 @@ private:
         switch (oth._state) {
             case State::INTERNAL:
             case State::EXTERNAL:
+                if (ATOMIC_REFCNT != basic_string<CharT, Traits, Alloc2>::ATOMIC_REFCNT) { // buffer can't be shared with different refcnt policy
+                    _new_auto(length);
+                    traits_type::copy(_str, oth._str + offset, length);
+                    break;
+                }
                 _state        = oth._state;
                 _str          = oth._str + offset;
                 _storage.any  = oth._storage.any;
                 _storage.dtor = oth._storage.dtor;
-                ++_storage.any->refcnt;
+                _refcnt_inc(_storage.any);
                 break;
             case State::LITERAL:
                 _state = State::LITERAL;
@@ -1262,10 +1351,19 @@ private:
 
     template <class Alloc2>
     void _move_from (basic_string<CharT, Traits, Alloc2>&& oth) {
-        _length = oth._length;
-        memcpy(__fill, oth.__fill, MAX_SSO_BYTES+1); // also sets _state
-        if (oth._state == State::SSO) _str = _sso + (oth._str - oth._sso);
-        else _str = oth._str;
+        if (ATOMIC_REFCNT != basic_string<CharT, Traits, Alloc2>::ATOMIC_REFCNT && (oth._state == State::INTERNAL || oth._state == State::EXTERNAL) &&
+            basic_string<CharT, Traits, Alloc2>::_refcnt(oth._storage.any) != 1)
+        { // buffer is shared by other strings with different refcnt policy, it can't be taken
+            _length = oth._length;
+            _new_auto(_length);
+            traits_type::copy(_str, oth._str, _length);
+            oth._release();
+        } else {
+            _length = oth._length;
+            memcpy(__fill, oth.__fill, MAX_SSO_BYTES+1); // also sets _state
+            if (oth._state == State::SSO) _str = _sso + (oth._str - oth._sso);
+            else _str = oth._str;
+        }
         oth._state       = State::LITERAL;
         oth._str_literal = &TERMINAL;
         oth._length      = 0;
@@ -1282,8 +1380,8 @@ private:
     }
 
     void _reserve_drop_internal (size_type capacity) {
-        if (_storage.internal->refcnt > 1) {
-            --_storage.internal->refcnt;
+        if (_refcnt(_storage.internal) > 1) {
+            _release_internal();
             _new_auto(capacity);
         }
         else if (_storage.internal->capacity < capacity) { // could realloc save anything?
@@ -1294,8 +1392,8 @@ private:
     }
 
     void _reserve_drop_external (size_type capacity) {
-        if (_storage.external->refcnt > 1) {
-            --_storage.external->refcnt;
+        if (_refcnt(_storage.external) > 1) {
+            _release_external();
             _new_auto(capacity);
         }
         else if (_storage.external->capacity < capacity) {
@@ -1310,7 +1408,7 @@ private:
             case State::INTERNAL:
             case State::EXTERNAL:
                 // suppress false-positive uninitialized warning for "_storage.any" for GCC
-                if (_storage.any->refcnt > 1) _detach_cow(_length);
+                if (_refcnt(_storage.any) > 1) _detach_cow(_length);
                 break;
             case State::LITERAL:
                 _detach_str(_length);
@@ -1320,8 +1418,11 @@ private:
     }
 
     void _detach_cow (size_type capacity) {
-        --_storage.any->refcnt;
+        auto old_state = _state;
+        auto old_buf   = _storage.any;
+        auto old_dtor  = _storage.dtor;
         _detach_str(capacity);
+        _release(old_state, old_buf, old_dtor);
     }
 
     void _detach_str (size_type capacity) {
@@ -1348,7 +1449,7 @@ private:
     }
 
     void _reserve_save_internal (size_type capacity, float extra) {
-        if (_storage.internal->refcnt > 1) _detach_cow(capacity * extra);
+        if (_refcnt(_storage.internal) > 1) _detach_cow(capacity * extra);
         else if (_storage.internal->capacity < capacity) _internal_realloc(capacity * extra); // need to grow storage
         else if (_capacity_internal() < capacity) { // may not to grow storage if str is moved to the beginning
             traits_type::move(_storage.internal->start(), _str, _length);
@@ -1375,7 +1476,7 @@ private:
     }
 
     void _reserve_save_external (size_type capacity, float extra) {
-        if (_storage.external->refcnt > 1) _detach_cow(capacity * extra);
+        if (_refcnt(_storage.external) > 1) _detach_cow(capacity * extra);
         else if (_storage.external->capacity < capacity) _external_realloc(capacity * extra); // need to grow storage, switch to INTERNAL/SSO
         else if (_capacity_external() < capacity) { // may not to grow storage if str is moved to the beginning
             traits_type::move(_storage.external->ptr, _str, _length);
@@ -1411,11 +1512,7 @@ private:
 
         switch (_state) {
             case State::INTERNAL:
-                if (_storage.internal->refcnt > 1) {
-                    --_storage.internal->refcnt;
-                    _reserve_middle_new(pos, remove_count, insert_count);
-                }
-                else if (newlen > _storage.internal->capacity) {
+                if (_refcnt(_storage.internal) > 1 || newlen > _storage.internal->capacity) {
                     auto old_buf  = _storage.internal;
                     auto old_dtor = _storage.dtor;
                     _reserve_middle_new(pos, remove_count, insert_count);
@@ -1424,11 +1521,7 @@ private:
                 else _reserve_middle_move(pos, remove_count, insert_count, _storage.internal->start(), _capacity_internal());
                 break;
             case State::EXTERNAL:
-                if (_storage.external->refcnt > 1) {
-                    --_storage.external->refcnt;
-                    _reserve_middle_new(pos, remove_count, insert_count);
-                }
-                else if (newlen > _storage.external->capacity) {
+                if (_refcnt(_storage.external) > 1 || newlen > _storage.external->capacity) {
                     auto old_buf  = _storage.external;
                     auto old_dtor = _storage.dtor;
                     _reserve_middle_new(pos, remove_count, insert_count);
@@ -1448,6 +1541,13 @@ private:
         _length = newlen;
     }
 
+    void _erase_new (size_type pos, size_type count) {
+        auto old_str = _str;
+        _new_auto(_length);
+        traits_type::copy(_str, old_str, pos);
+        traits_type::copy(_str + pos, old_str + pos + count, _length - pos);
+    }
+
     void _reserve_middle_new (size_type pos, size_type remove_count, size_type insert_count) {
         auto old_str = _str;
         _new_auto(_length + insert_count - remove_count);
@@ -1505,8 +1605,45 @@ private:
     void _free_external_str () { _free_external_str(_storage.external, _storage.dtor); }
     void _free_external_buf () { _free_external_buf(_storage.external); }
 
-    static void _release_internal (Buffer* buf, dtor_fn dtor)          { if (!--buf->refcnt) _free_internal(buf, dtor); }
-    static void _release_external (ExternalShared* ebuf, dtor_fn dtor) { if (!--ebuf->refcnt) _free_external(ebuf, dtor); }
+    static void _release_internal (Buffer* buf, dtor_fn dtor)          { if (_refcnt_dec(buf)) _free_internal(buf, dtor); }
+    static void _release_external (ExternalShared* ebuf, dtor_fn dtor) { if (_refcnt_dec(ebuf)) _free_external(ebuf, dtor); }
+
+    template <typename V>
+    static basic_string _from_float (V value) {
+        constexpr auto maxsz = to_chars_maxsize<V>();
+        basic_string ret(maxsz);
+        auto res = to_chars(ret._str, ret._str + maxsz, value);
+        assert(!res.ec);
+        ret.length(res.ptr - ret.data());
+        return ret;
+    }
+
+    const char* _search_ptr (size_type pos) const { return (const char*)(_str + pos); }
+
+    static size_type _search_offset (size_t ret, size_type pos) { return ret == string_search::npos ? npos : ret + pos; }
+
+    static void _release (State state, Buffer* buf, dtor_fn dtor) {
+        if (state == State::INTERNAL)      _release_internal(buf, dtor);
+        else if (state == State::EXTERNAL) _release_external((ExternalShared*)buf, dtor);
+    }
+
+    static std::atomic<uint32_t>& _atomic_refcnt (const Buffer* buf) { return *reinterpret_cast<std::atomic<uint32_t>*>(&const_cast<Buffer*>(buf)->refcnt); }
+
+    static uint32_t _refcnt (const Buffer* buf) {
+        if (ATOMIC_REFCNT) return _atomic_refcnt(buf).load(std::memory_order_acquire);
+        return buf->refcnt;
+    }
+
+    static void _refcnt_inc (Buffer* buf) {
+        if (ATOMIC_REFCNT) _atomic_refcnt(buf).fetch_add(1, std::memory_order_relaxed);
+        else ++buf->refcnt;
+    }
+
+    // returns true if it was the last reference
+    static bool _refcnt_dec (Buffer* buf) {
+        if (ATOMIC_REFCNT) return _atomic_refcnt(buf).fetch_sub(1, std::memory_order_acq_rel) == 1;
+        return !--buf->refcnt;
+    }
 
     static void _free_internal     (Buffer* buf, dtor_fn dtor)          { dtor((CharT*)buf, buf->capacity + BUF_CHARS); }
     static void _free_external     (ExternalShared* ebuf, dtor_fn dtor) { _free_external_str(ebuf, dtor); _free_external_buf(ebuf); }
@@ -1532,6 +1669,11 @@ template <class C, class T, class A> const C basic_string<C,T,A>::TERMINAL = C()
 template <class C, class T, class A> const typename basic_string<C,T,A>::size_type basic_string<C,T,A>::npos;
 template <class C, class T, class A> const typename basic_string<C,T,A>::size_type basic_string<C,T,A>::MAX_SSO_CHARS;
 template <class C, class T, class A> const typename basic_string<C,T,A>::size_type basic_string<C,T,A>::MAX_SIZE;
+template <class C, class T, class A> constexpr const bool basic_string<C,T,A>::ATOMIC_REFCNT;
+template <class C, class T, class A> constexpr const int  basic_string<C,T,A>::MMAP_NORMAL;
+template <class C, class T, class A> constexpr const int  basic_string<C,T,A>::MMAP_SEQUENTIAL;
+template <class C, class T, class A> constexpr const int  basic_string<C,T,A>::MMAP_RANDOM;
+template <class C, class T, class A> constexpr const int  basic_string<C,T,A>::MMAP_WILLNEED;
 
 template <class C, class T, class A1, class A2> inline bool operator== (const basic_string<C,T,A1>& lhs, const basic_string<C,T,A2>& rhs) { return lhs.compare(rhs) == 0; }
 template <class C, class T, class A>            inline bool operator== (const C* lhs, const basic_string<C,T,A>& rhs)                     { return rhs.compare(lhs) == 0; }
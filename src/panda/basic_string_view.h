@@ -4,6 +4,7 @@
 #include <limits>
 #include <utility>   // swap
 #include <stdexcept>
+#include "string_search.h"
 
 namespace panda {
 
@@ -154,6 +155,7 @@ public:
     size_t find (const CharT* s, size_t pos, size_t count) const {
         if (pos > _length) return npos;
         if (count == 0) return pos;
+        if (FAST_SEARCH) return _search_offset(string_search::find(_search_ptr(pos), _length - pos, (const char*)s, count), pos);
 
         const CharT* ptr = traits_type::find(_str + pos, _length - pos, *s);
         const CharT* end = _str + _length;
@@ -181,12 +183,15 @@ public:
     }
 
     size_t rfind (CharT ch, size_t pos = npos) const {
+        if (FAST_SEARCH) return string_search::rfind_char(_search_ptr(0), pos >= _length ? _length : (pos+1), (char)ch);
         const CharT* ptr = _str + (pos >= _length ? _length : (pos+1));
         while (--ptr >= _str) if (traits_type::eq(*ptr, ch)) return ptr - _str;
         return npos;
     }
 
     size_t rfind (const CharT* s, size_t pos, size_t count) const {
+        if (count > _length) return npos;
+        if (FAST_SEARCH && count) return string_search::rfind(_search_ptr(0), (pos >= _length - count ? _length - count : pos) + count, (const char*)s, count);
         for (const CharT* ptr = _str + ((pos >= _length - count) ? (_length - count) : pos); ptr >= _str; --ptr)
             if (traits_type::compare(ptr, s, count) == 0) return ptr - _str;
         return npos;
@@ -213,6 +218,7 @@ public:
 
     size_t find_first_of (const CharT* s, size_t pos, size_t count) const {
         if (count == 0) return npos;
+        if (FAST_SEARCH) return pos >= _length ? npos : _search_offset(string_search::find_of(_search_ptr(pos), _length - pos, (const char*)s, count), pos);
         const CharT* end = _str + _length;
         for (const CharT* ptr = _str + pos; ptr < end; ++ptr) if (traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -239,6 +245,7 @@ public:
 
     size_t find_last_of (const CharT* s, size_t pos, size_t count) const {
         if (count == 0) return npos;
+        if (FAST_SEARCH) return string_search::rfind_of(_search_ptr(0), pos >= _length ? _length : (pos+1), (const char*)s, count);
         for (const CharT* ptr = _str + (pos >= _length ? (_length - 1) : pos); ptr >= _str; --ptr)
             if (traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -260,6 +267,7 @@ public:
     }
 
     size_t find_first_not_of (CharT ch, size_t pos = 0) const {
+        if (FAST_SEARCH) return find_first_not_of(&ch, pos, 1);
         const CharT* end = _str + _length;
         for (const CharT* ptr = _str + pos; ptr < end; ++ptr) if (!traits_type::eq(*ptr, ch)) return ptr - _str;
         return npos;
@@ -267,6 +275,7 @@ public:
 
     size_t find_first_not_of (const CharT* s, size_t pos, size_t count) const {
         if (count == 0) return pos >= _length ? npos : pos;
+        if (FAST_SEARCH) return pos >= _length ? npos : _search_offset(string_search::find_of(_search_ptr(pos), _length - pos, (const char*)s, count, true), pos);
         const CharT* end = _str + _length;
         for (const CharT* ptr = _str + pos; ptr < end; ++ptr) if (!traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -288,6 +297,7 @@ public:
     }
 
     size_t find_last_not_of (CharT ch, size_t pos = npos) const {
+        if (FAST_SEARCH) return find_last_not_of(&ch, pos, 1);
         for (const CharT* ptr = _str + (pos >= _length ? (_length - 1) : pos); ptr >= _str; --ptr)
             if (!traits_type::eq(*ptr, ch)) return ptr - _str;
         return npos;
@@ -295,6 +305,7 @@ public:
 
     size_t find_last_not_of (const CharT* s, size_t pos, size_t count) const {
         if (count == 0) return pos >= _length ? (_length-1) : pos;
+        if (FAST_SEARCH) return string_search::rfind_of(_search_ptr(0), pos >= _length ? _length : (pos+1), (const char*)s, count, true);
         for (const CharT* ptr = _str + (pos >= _length ? (_length - 1) : pos); ptr >= _str; --ptr)
             if (!traits_type::find(s, count, *ptr)) return ptr - _str;
         return npos;
@@ -312,6 +323,11 @@ public:
 
 
 private:
+    static constexpr const bool FAST_SEARCH = string_search::enabled<CharT, Traits>::value;
+
+    const char* _search_ptr (size_t pos) const { return (const char*)(_str + pos); }
+
+    static size_t _search_offset (size_t ret, size_t pos) { return ret == string_search::npos ? npos : ret + pos; }
 
     static int _compare (const CharT* ptr1, size_t len1, const CharT* ptr2, size_t len2) {
         int r = traits_type::compare(ptr1, ptr2, std::min(len1, len2));
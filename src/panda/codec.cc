@@ -0,0 +1,709 @@
+#include "codec.h"
+#include "string_search.h"
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define PANDA_CODEC_X86 1
+#  include <immintrin.h>
+#  define PANDA_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace panda { namespace codec {
+
+namespace {
+
+const char HEX_LOWER[] = "0123456789abcdef";
+const char HEX_UPPER[] = "0123456789ABCDEF";
+const char BASE64[]    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char BASE64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+const uint8_t INVALID = 255;
+
+struct Tables {
+    uint8_t unhex[256];
+    uint8_t unbase64[256];
+    bool    unreserved[256];
+
+    Tables () {
+        memset(unhex, INVALID, sizeof(unhex));
+        memset(unbase64, INVALID, sizeof(unbase64));
+        memset(unreserved, 0, sizeof(unreserved));
+        for (int i = 0; i < 16; ++i) {
+            unhex[(uint8_t)HEX_LOWER[i]] = i;
+            unhex[(uint8_t)HEX_UPPER[i]] = i;
+        }
+        for (int i = 0; i < 64; ++i) {
+            unbase64[(uint8_t)BASE64[i]]    = i;
+            unbase64[(uint8_t)BASE64URL[i]] = i;
+            if (i < 62) unreserved[(uint8_t)BASE64[i]] = true;
+        }
+        for (char c : {'-', '.', '_', '~'}) unreserved[(uint8_t)c] = true;
+    }
+};
+
+const Tables& tables () {
+    static const Tables ret;
+    return ret;
+}
+
+/*
+ * Vector kernels process whole blocks from the beginning and return how much input is consumed, the rest (and the rest after the first
+ * block with invalid chars for decoders) is done by scalar code. Scalar level has no kernels.
+ */
+size_t scalar_blocks     (const char*, size_t, char*)       { return 0; }
+size_t scalar_blocks_opt (const char*, size_t, char*, bool) { return 0; }
+size_t scalar_run        (const char*, size_t)              { return 0; }
+
+#ifdef PANDA_CODEC_X86
+
+inline unsigned lowest_bit (uint32_t mask) { return __builtin_ctz(mask); }
+
+/* SSSE3 */
+
+PANDA_TARGET("ssse3")
+inline __m128i sse_in_range (__m128i v, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+// nibble values -> hex digits
+PANDA_TARGET("ssse3")
+inline __m128i sse_hex_digits (__m128i n, __m128i alpha) {
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), alpha));
+}
+
+// hex digits -> nibble values, false if there are invalid chars
+PANDA_TARGET("ssse3")
+inline bool sse_hex_values (__m128i v, __m128i& res) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i digit = sse_in_range(v, '0', '9');
+    __m128i alpha = sse_in_range(lower, 'a', 'f');
+    res = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))), _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+    return _mm_movemask_epi8(_mm_or_si128(digit, alpha)) == 0xFFFF;
+}
+
+// pairs of nibbles in 16-bit words -> bytes in 16-bit words
+PANDA_TARGET("ssse3")
+inline __m128i sse_join_nibbles (__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 4), _mm_srli_epi16(v, 8));
+}
+
+PANDA_TARGET("ssse3")
+size_t sse_encode_hex (const char* src, size_t len, char* dst, bool upper) {
+    const __m128i alpha = _mm_set1_epi8(upper ? 'A' - '0' - 10 : 'a' - '0' - 10);
+    const __m128i mask  = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i hi = sse_hex_digits(_mm_and_si128(_mm_srli_epi16(in, 4), mask), alpha);
+        __m128i lo = sse_hex_digits(_mm_and_si128(in, mask), alpha);
+        _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(dst + i * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+PANDA_TARGET("ssse3")
+size_t sse_decode_hex (const char* src, size_t len, char* dst) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m128i a, b;
+        if (!sse_hex_values(_mm_loadu_si128((const __m128i*)(src + i)), a)) break;
+        if (!sse_hex_values(_mm_loadu_si128((const __m128i*)(src + i + 16)), b)) break;
+        _mm_storeu_si128((__m128i*)(dst + i / 2), _mm_packus_epi16(sse_join_nibbles(a), sse_join_nibbles(b)));
+    }
+    return i;
+}
+
+/*
+ * Base64 by Wojciech Muła's method: 12 bytes are spread into 16 6-bit indices by shuffle and multiplications, indices are turned into
+ * chars by adding offsets from a 16-entry table selected by index range.
+ */
+PANDA_TARGET("ssse3")
+inline __m128i sse_base64_indices (__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t0, t1);
+}
+
+PANDA_TARGET("ssse3")
+inline __m128i sse_base64_offsets (bool url) {
+    return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                         url ? '-' - 62 : '+' - 62, url ? '_' - 63 : '/' - 63, 'A', 0, 0);
+}
+
+PANDA_TARGET("ssse3")
+inline __m128i sse_base64_chars (__m128i idx, __m128i offsets) {
+    __m128i sel = _mm_subs_epu8(idx, _mm_set1_epi8(51)); // 1-12 for digits and 62,63, 0 for the rest
+    sel = _mm_or_si128(sel, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+    return _mm_add_epi8(idx, _mm_shuffle_epi8(offsets, sel));
+}
+
+// chars -> 6-bit values of both alphabets, false if there are invalid chars
+PANDA_TARGET("ssse3")
+inline bool sse_base64_values (__m128i v, __m128i& res) {
+    __m128i upper = sse_in_range(v, 'A', 'Z');
+    __m128i lower = sse_in_range(v, 'a', 'z');
+    __m128i digit = sse_in_range(v, '0', '9');
+    __m128i c62   = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+    __m128i c63   = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF) return false;
+    res = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(upper, _mm_sub_epi8(v, _mm_set1_epi8('A'))), _mm_and_si128(lower, _mm_sub_epi8(v, _mm_set1_epi8('a' - 26)))),
+        _mm_or_si128(_mm_and_si128(digit, _mm_add_epi8(v, _mm_set1_epi8(52 - '0'))),
+                     _mm_or_si128(_mm_and_si128(c62, _mm_set1_epi8(62)), _mm_and_si128(c63, _mm_set1_epi8(63))))
+    );
+    return true;
+}
+
+// 16 6-bit values -> 12 bytes in the beginning of vector
+PANDA_TARGET("ssse3")
+inline __m128i sse_base64_pack (__m128i v) {
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)); // pairs of values -> 12 bits
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));    // pairs of 12 bits -> 24 bits
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+PANDA_TARGET("ssse3")
+inline void sse_store12 (char* dst, __m128i v) {
+    _mm_storel_epi64((__m128i*)dst, v);
+    uint32_t rest = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(dst + 8, &rest, 4);
+}
+
+PANDA_TARGET("ssse3")
+size_t sse_encode_base64 (const char* src, size_t len, char* dst, bool url) {
+    const __m128i offsets = sse_base64_offsets(url);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 12, dst += 16) { // 16 bytes are loaded, 12 are used
+        __m128i idx = sse_base64_indices(_mm_loadu_si128((const __m128i*)(src + i)));
+        _mm_storeu_si128((__m128i*)dst, sse_base64_chars(idx, offsets));
+    }
+    return i;
+}
+
+PANDA_TARGET("ssse3")
+size_t sse_decode_base64 (const char* src, size_t len, char* dst) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16, dst += 12) {
+        __m128i v;
+        if (!sse_base64_values(_mm_loadu_si128((const __m128i*)(src + i)), v)) break;
+        sse_store12(dst, sse_base64_pack(v));
+    }
+    return i;
+}
+
+PANDA_TARGET("ssse3")
+inline __m128i sse_unreserved (__m128i v) {
+    return _mm_or_si128(
+        _mm_or_si128(sse_in_range(v, 'A', 'Z'), sse_in_range(v, 'a', 'z')),
+        _mm_or_si128(_mm_or_si128(sse_in_range(v, '0', '9'), sse_in_range(v, '-', '.')),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))))
+    );
+}
+
+PANDA_TARGET("ssse3")
+size_t sse_unreserved_run (const char* src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint32_t mask = _mm_movemask_epi8(sse_unreserved(_mm_loadu_si128((const __m128i*)(src + i)))) ^ 0xFFFF;
+        if (mask) return i + lowest_bit(mask);
+    }
+    return i;
+}
+
+/* AVX2: the same with twice wider vectors, instructions work within 128-bit lanes, so that lanes are rearranged where needed */
+
+PANDA_TARGET("avx2")
+inline __m256i avx2_in_range (__m256i v, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+PANDA_TARGET("avx2")
+inline __m256i avx2_hex_digits (__m256i n, __m256i alpha) {
+    return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)), alpha));
+}
+
+PANDA_TARGET("avx2")
+inline bool avx2_hex_values (__m256i v, __m256i& res) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i digit = avx2_in_range(v, '0', '9');
+    __m256i alpha = avx2_in_range(lower, 'a', 'f');
+    res = _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(v, _mm256_set1_epi8('0'))),
+                          _mm256_and_si256(alpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) == 0xFFFFFFFF;
+}
+
+PANDA_TARGET("avx2")
+inline __m256i avx2_join_nibbles (__m256i v) {
+    return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0xff)), 4), _mm256_srli_epi16(v, 8));
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_encode_hex (const char* src, size_t len, char* dst, bool upper) {
+    const __m256i alpha = _mm256_set1_epi8(upper ? 'A' - '0' - 10 : 'a' - '0' - 10);
+    const __m256i mask  = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i hi = avx2_hex_digits(_mm256_and_si256(_mm256_srli_epi16(in, 4), mask), alpha);
+        __m256i lo = avx2_hex_digits(_mm256_and_si256(in, mask), alpha);
+        __m256i r0 = _mm256_unpacklo_epi8(hi, lo); // bytes 0-7 and 16-23
+        __m256i r1 = _mm256_unpackhi_epi8(hi, lo); // bytes 8-15 and 24-31
+        _mm256_storeu_si256((__m256i*)(dst + i * 2), _mm256_permute2x128_si256(r0, r1, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + i * 2 + 32), _mm256_permute2x128_si256(r0, r1, 0x31));
+    }
+    return i + sse_encode_hex(src + i, len - i, dst + i * 2, upper);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_decode_hex (const char* src, size_t len, char* dst) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i a, b;
+        if (!avx2_hex_values(_mm256_loadu_si256((const __m256i*)(src + i)), a)) break;
+        if (!avx2_hex_values(_mm256_loadu_si256((const __m256i*)(src + i + 32)), b)) break;
+        __m256i res = _mm256_packus_epi16(avx2_join_nibbles(a), avx2_join_nibbles(b)); // a0 b0 a1 b1 by lanes
+        _mm256_storeu_si256((__m256i*)(dst + i / 2), _mm256_permute4x64_epi64(res, 0xD8));
+    }
+    return i + sse_decode_hex(src + i, len - i, dst + i / 2);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_encode_base64 (const char* src, size_t len, char* dst, bool url) {
+    const __m256i shuffle = _mm256_broadcastsi128_si256(_mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i offsets = _mm256_broadcastsi128_si256(sse_base64_offsets(url));
+    size_t i = 0;
+    for (; i + 28 <= len; i += 24, dst += 32) { // 12 bytes per lane
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + i))), _mm_loadu_si128((const __m128i*)(src + i + 12)), 1
+        );
+        in = _mm256_shuffle_epi8(in, shuffle);
+        __m256i t0  = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i t1  = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i idx = _mm256_or_si256(t0, t1);
+        __m256i sel = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        sel = _mm256_or_si256(sel, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*)dst, _mm256_add_epi8(idx, _mm256_shuffle_epi8(offsets, sel)));
+    }
+    return i + sse_encode_base64(src + i, len - i, dst, url);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_decode_base64 (const char* src, size_t len, char* dst) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32, dst += 24) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i upper = avx2_in_range(v, 'A', 'Z');
+        __m256i lower = avx2_in_range(v, 'a', 'z');
+        __m256i digit = avx2_in_range(v, '0', '9');
+        __m256i c62   = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('+')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+        __m256i c63   = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+        if ((uint32_t)_mm256_movemask_epi8(valid) != 0xFFFFFFFF) break;
+        v = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(upper, _mm256_sub_epi8(v, _mm256_set1_epi8('A'))),
+                            _mm256_and_si256(lower, _mm256_sub_epi8(v, _mm256_set1_epi8('a' - 26)))),
+            _mm256_or_si256(_mm256_and_si256(digit, _mm256_add_epi8(v, _mm256_set1_epi8(52 - '0'))),
+                            _mm256_or_si256(_mm256_and_si256(c62, _mm256_set1_epi8(62)), _mm256_and_si256(c63, _mm256_set1_epi8(63))))
+        );
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)); // 24 bytes in a row
+        _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(v));
+        _mm_storel_epi64((__m128i*)(dst + 16), _mm256_extracti128_si256(v, 1));
+    }
+    return i + sse_decode_base64(src + i, len - i, dst);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_unreserved_run (const char* src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i safe = _mm256_or_si256(
+            _mm256_or_si256(avx2_in_range(v, 'A', 'Z'), avx2_in_range(v, 'a', 'z')),
+            _mm256_or_si256(_mm256_or_si256(avx2_in_range(v, '0', '9'), avx2_in_range(v, '-', '.')),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('~'))))
+        );
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(safe);
+        if (mask) return i + lowest_bit(mask);
+    }
+    return i + sse_unreserved_run(src + i, len - i);
+}
+
+#endif
+
+struct Kernels {
+    Level  level;
+    size_t (*encode_hex)     (const char*, size_t, char*, bool);
+    size_t (*decode_hex)     (const char*, size_t, char*);
+    size_t (*encode_base64)  (const char*, size_t, char*, bool);
+    size_t (*decode_base64)  (const char*, size_t, char*);
+    size_t (*unreserved_run) (const char*, size_t);
+};
+
+Kernels make_kernels (Level level) {
+    if (level > max_level()) level = max_level();
+    switch (level) {
+        #ifdef PANDA_CODEC_X86
+        case Level::AVX2:  return {level, avx2_encode_hex, avx2_decode_hex, avx2_encode_base64, avx2_decode_base64, avx2_unreserved_run};
+        case Level::SSSE3: return {level, sse_encode_hex, sse_decode_hex, sse_encode_base64, sse_decode_base64, sse_unreserved_run};
+        #endif
+        default: return {Level::SCALAR, scalar_blocks_opt, scalar_blocks, scalar_blocks_opt, scalar_blocks, scalar_run};
+    }
+}
+
+Kernels& kernels () {
+    static Kernels ret = make_kernels(max_level());
+    return ret;
+}
+
+}
+
+Level level () { return kernels().level; }
+
+Level max_level () {
+    #ifdef PANDA_CODEC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))  return Level::AVX2;
+    if (__builtin_cpu_supports("ssse3")) return Level::SSSE3;
+    #endif
+    return Level::SCALAR;
+}
+
+void set_level (Level level) { kernels() = make_kernels(level); }
+
+size_t encode_hex (const char* src, size_t len, char* dst, bool upper) {
+    auto digits = upper ? HEX_UPPER : HEX_LOWER;
+    for (size_t i = kernels().encode_hex(src, len, dst, upper); i < len; ++i) {
+        uint8_t c = src[i];
+        dst[i*2]   = digits[c >> 4];
+        dst[i*2+1] = digits[c & 15];
+    }
+    return len * 2;
+}
+
+size_t decode_hex (const char* src, size_t len, char* dst) {
+    if (len % 2) return npos;
+    auto& unhex = tables().unhex;
+    for (size_t i = kernels().decode_hex(src, len, dst); i < len; i += 2) {
+        uint8_t hi = unhex[(uint8_t)src[i]], lo = unhex[(uint8_t)src[i+1]];
+        if ((hi | lo) == INVALID) return npos;
+        dst[i / 2] = char(hi << 4 | lo);
+    }
+    return len / 2;
+}
+
+size_t encode_base64 (const char* src, size_t len, char* dst, bool url, bool pad) {
+    auto abc = url ? BASE64URL : BASE64;
+    size_t i = kernels().encode_base64(src, len, dst, url);
+    char* out = dst + i / 3 * 4;
+    for (; i + 3 <= len; i += 3, out += 4) {
+        uint32_t v = (uint8_t)src[i] << 16 | (uint8_t)src[i+1] << 8 | (uint8_t)src[i+2];
+        out[0] = abc[v >> 18];
+        out[1] = abc[v >> 12 & 63];
+        out[2] = abc[v >> 6 & 63];
+        out[3] = abc[v & 63];
+    }
+    if (i < len) {
+        bool two = i + 2 == len;
+        uint32_t v = (uint8_t)src[i] << 16 | (two ? (uint8_t)src[i+1] << 8 : 0);
+        *out++ = abc[v >> 18];
+        *out++ = abc[v >> 12 & 63];
+        if (two)      *out++ = abc[v >> 6 & 63];
+        else if (pad) *out++ = '=';
+        if (pad)      *out++ = '=';
+    }
+    return out - dst;
+}
+
+size_t decode_base64 (const char* src, size_t len, char* dst) {
+    if (len % 4 == 0 && len && src[len-1] == '=') len -= src[len-2] == '=' ? 2 : 1;
+    if (len % 4 == 1) return npos;
+    auto& unbase64 = tables().unbase64;
+    size_t i = kernels().decode_base64(src, len, dst);
+    char* out = dst + i / 4 * 3;
+    for (; i + 4 <= len; i += 4, out += 3) {
+        uint32_t a = unbase64[(uint8_t)src[i]], b = unbase64[(uint8_t)src[i+1]], c = unbase64[(uint8_t)src[i+2]], d = unbase64[(uint8_t)src[i+3]];
+        if ((a | b | c | d) == INVALID) return npos;
+        uint32_t v = a << 18 | b << 12 | c << 6 | d;
+        out[0] = char(v >> 16);
+        out[1] = char(v >> 8);
+        out[2] = char(v);
+    }
+    if (i < len) { // 2 or 3 chars without padding, extra bits are ignored
+        bool three = i + 3 == len;
+        uint32_t a = unbase64[(uint8_t)src[i]], b = unbase64[(uint8_t)src[i+1]], c = three ? unbase64[(uint8_t)src[i+2]] : 0;
+        if ((a | b | c) == INVALID) return npos;
+        uint32_t v = a << 18 | b << 12 | c << 6;
+        *out++ = char(v >> 16);
+        if (three) *out++ = char(v >> 8);
+    }
+    return out - dst;
+}
+
+size_t encode_percent (const char* src, size_t len, char* dst, bool plus) {
+    auto& unreserved = tables().unreserved;
+    auto& k = kernels();
+    char* out = dst;
+    size_t i = 0;
+    while (i < len) {
+        size_t run = k.unreserved_run(src + i, len - i);
+        while (i + run < len && unreserved[(uint8_t)src[i + run]]) ++run;
+        memcpy(out, src + i, run);
+        out += run;
+        i += run;
+        for (; i < len && !unreserved[(uint8_t)src[i]]; ++i) {
+            uint8_t c = src[i];
+            if (plus && c == ' ') *out++ = '+';
+            else {
+                out[0] = '%';
+                out[1] = HEX_UPPER[c >> 4];
+                out[2] = HEX_UPPER[c & 15];
+                out += 3;
+            }
+        }
+    }
+    return out - dst;
+}
+
+size_t decode_percent (const char* src, size_t len, char* dst, bool plus) {
+    auto& unhex = tables().unhex;
+    char* out = dst;
+    size_t i = 0;
+    while (i < len) {
+        size_t run;
+        if (plus) run = string_search::find_of(src + i, len - i, "%+", 2);
+        else {
+            auto p = (const char*)memchr(src + i, '%', len - i);
+            run = p ? p - src - i : npos;
+        }
+        if (run == npos) run = len - i;
+        memcpy(out, src + i, run);
+        out += run;
+        i += run;
+        if (i == len) break;
+
+        if (src[i] == '+') {
+            *out++ = ' ';
+            ++i;
+        }
+        else if (i + 2 < len && (unhex[(uint8_t)src[i+1]] | unhex[(uint8_t)src[i+2]]) != INVALID) {
+            *out++ = char(unhex[(uint8_t)src[i+1]] << 4 | unhex[(uint8_t)src[i+2]]);
+            i += 3;
+        }
+        else *out++ = src[i++];
+    }
+    return out - dst;
+}
+
+}
+
+namespace {
+    // kernel writes at most `maxsize` chars after current content of `out` and returns how many it wrote or npos
+    template <class F>
+    bool append (string& out, size_t maxsize, F&& kernel) {
+        auto len = out.length();
+        auto buf = out.reserve(len + maxsize);
+        auto cnt = kernel(buf + len);
+        if (cnt == codec::npos) return false;
+        out.length(len + cnt);
+        return true;
+    }
+}
+
+void encode_hex (string_view src, string& out, bool upper) {
+    append(out, codec::hex_encoded_size(src.length()), [&](char* dst) { return codec::encode_hex(src.data(), src.length(), dst, upper); });
+}
+
+string encode_hex (string_view src, bool upper) {
+    string ret;
+    encode_hex(src, ret, upper);
+    return ret;
+}
+
+bool decode_hex (string_view src, string& out) {
+    return append(out, codec::hex_decoded_size(src.length()), [&](char* dst) { return codec::decode_hex(src.data(), src.length(), dst); });
+}
+
+string decode_hex (string_view src) {
+    string ret;
+    if (!decode_hex(src, ret)) throw std::invalid_argument("decode_hex");
+    return ret;
+}
+
+void encode_base64 (string_view src, string& out, bool url, bool pad) {
+    append(out, codec::base64_encoded_size(src.length(), pad), [&](char* dst) {
+        return codec::encode_base64(src.data(), src.length(), dst, url, pad);
+    });
+}
+
+string encode_base64 (string_view src, bool url, bool pad) {
+    string ret;
+    encode_base64(src, ret, url, pad);
+    return ret;
+}
+
+bool decode_base64 (string_view src, string& out) {
+    return append(out, codec::base64_decoded_size(src.length()), [&](char* dst) { return codec::decode_base64(src.data(), src.length(), dst); });
+}
+
+string decode_base64 (string_view src) {
+    string ret;
+    if (!decode_base64(src, ret)) throw std::invalid_argument("decode_base64");
+    return ret;
+}
+
+void encode_percent (string_view src, string& out, bool plus) {
+    append(out, codec::percent_encoded_size(src.length()), [&](char* dst) {
+        return codec::encode_percent(src.data(), src.length(), dst, plus);
+    });
+}
+
+string encode_percent (string_view src, bool plus) {
+    string ret;
+    encode_percent(src, ret, plus);
+    return ret;
+}
+
+void decode_percent (string_view src, string& out, bool plus) {
+    append(out, codec::percent_decoded_size(src.length()), [&](char* dst) {
+        return codec::decode_percent(src.data(), src.length(), dst, plus);
+    });
+}
+
+string decode_percent (string_view src, bool plus) {
+    string ret;
+    decode_percent(src, ret, plus);
+    return ret;
+}
+
+void base64_encoder::update (string_view chunk, string& out) {
+    auto ptr = chunk.data();
+    auto len = chunk.length();
+    if (_tail_len) {
+        if (_tail_len + len < 3) {
+            memcpy(_tail + _tail_len, ptr, len);
+            _tail_len += len;
+            return;
+        }
+        char triple[3];
+        memcpy(triple, _tail, _tail_len);
+        memcpy(triple + _tail_len, ptr, 3 - _tail_len);
+        ptr += 3 - _tail_len;
+        len -= 3 - _tail_len;
+        _tail_len = 0;
+        encode_base64(string_view(triple, 3), out, _url, _pad);
+    }
+    size_t full = len / 3 * 3;
+    encode_base64(string_view(ptr, full), out, _url, _pad);
+    _tail_len = len - full;
+    memcpy(_tail, ptr + full, _tail_len);
+}
+
+void base64_encoder::finish (string& out) {
+    encode_base64(string_view(_tail, _tail_len), out, _url, _pad);
+    _tail_len = 0;
+}
+
+bool base64_decoder::_decode (const char* src, size_t len, string& out) {
+    if (_ended || !decode_base64(string_view(src, len), out)) return false;
+    _ended = src[len-1] == '=';
+    return true;
+}
+
+bool base64_decoder::update (string_view chunk, string& out) {
+    auto ptr = chunk.data();
+    auto len = chunk.length();
+    if (!len) return true;
+    if (_ended) return false;
+    if (_tail_len) {
+        size_t cnt = std::min(4 - _tail_len, len);
+        memcpy(_tail + _tail_len, ptr, cnt);
+        _tail_len += cnt;
+        ptr += cnt;
+        len -= cnt;
+        if (_tail_len < 4) return true;
+        _tail_len = 0;
+        if (!_decode(_tail, 4, out)) return false;
+    }
+    size_t full = len / 4 * 4;
+    if (full && !_decode(ptr, full, out)) return false;
+    _tail_len = len - full;
+    memcpy(_tail, ptr + full, _tail_len);
+    return true;
+}
+
+bool base64_decoder::finish (string& out) {
+    if (!_tail_len) return true;
+    bool ok = _tail_len > 1 && _decode(_tail, _tail_len, out);
+    _tail_len = 0;
+    return ok;
+}
+
+bool hex_decoder::update (string_view chunk, string& out) {
+    auto ptr = chunk.data();
+    auto len = chunk.length();
+    if (!len) return true;
+    if (_has_tail) {
+        char pair[2] = {_tail, *ptr++};
+        --len;
+        _has_tail = false;
+        if (!decode_hex(string_view(pair, 2), out)) return false;
+    }
+    size_t full = len & ~size_t(1);
+    if (!decode_hex(string_view(ptr, full), out)) return false;
+    if (len != full) {
+        _tail = ptr[full];
+        _has_tail = true;
+    }
+    return true;
+}
+
+void percent_decoder::update (string_view chunk, string& out) {
+    auto ptr = chunk.data();
+    auto len = chunk.length();
+    while (_tail_len) { // '%' and maybe one char after it
+        if (!len) return;
+        if (_tail_len == 1) {
+            _tail[_tail_len++] = *ptr++;
+            --len;
+            continue;
+        }
+        char esc[3] = {_tail[0], _tail[1], *ptr};
+        if (codec::decode_percent(esc, 3, esc, _plus) == 1) { // valid escape
+            out += esc[0];
+            ++ptr;
+            --len;
+            _tail_len = 0;
+            continue;
+        }
+        // '%' is literal, the rest is decoded again, as it may start another escape
+        out += '%';
+        if (_tail[1] == '%') _tail_len = 1;
+        else {
+            decode_percent(string_view(_tail + 1, 1), out, _plus);
+            _tail_len = 0;
+        }
+    }
+    // escape may be cut by the end of chunk
+    size_t hold = 0;
+    if      (len >= 1 && ptr[len-1] == '%') hold = 1;
+    else if (len >= 2 && ptr[len-2] == '%') hold = 2;
+    decode_percent(string_view(ptr, len - hold), out, _plus);
+    memcpy(_tail, ptr + len - hold, hold);
+    _tail_len = hold;
+}
+
+void percent_decoder::finish (string& out) {
+    decode_percent(string_view(_tail, _tail_len), out, _plus);
+    _tail_len = 0;
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "string.h"
+
+namespace panda {
+
+/*
+ * Text codecs: hex, base64 (RFC 4648) and percent-encoding (RFC 3986).
+ *
+ * codec:: functions are raw kernels working on memory buffers, bulk of data is processed by SSE/AVX2 code chosen on first use by CPU
+ * features (like string_search), the rest by portable code. Destination must have room for *_size() bytes. Decoders return
+ * codec::npos on invalid input, in that case content of destination is unspecified.
+ *
+ * String functions write into a string of exact size (reserve + length) with no reallocations, appending overloads add to existing
+ * content, so that stateless encoders may be fed by chunks. Stateful conversions of chunked data are done by encoder and decoder objects.
+ */
+namespace codec {
+    static constexpr const size_t npos = size_t(-1);
+
+    enum class Level { SCALAR, SSSE3, AVX2 };
+
+    Level level     (); // implementation in use
+    Level max_level (); // best one supported by CPU
+    void  set_level (Level); // for tests and benchmarks, not thread-safe. Levels above max_level() are lowered.
+
+    constexpr size_t hex_encoded_size     (size_t len) { return len * 2; }
+    constexpr size_t hex_decoded_size     (size_t len) { return len / 2; }
+    constexpr size_t base64_encoded_size  (size_t len, bool pad = true) { return pad ? (len + 2) / 3 * 4 : len / 3 * 4 + (len % 3 ? len % 3 + 1 : 0); }
+    constexpr size_t base64_decoded_size  (size_t len) { return len / 4 * 3 + (len % 4 ? len % 4 - 1 : 0); } // maximum, padding is not known
+    constexpr size_t percent_encoded_size (size_t len) { return len * 3; } // maximum
+    constexpr size_t percent_decoded_size (size_t len) { return len; }     // maximum
+
+    size_t encode_hex (const char* src, size_t len, char* dst, bool upper = false);
+    size_t decode_hex (const char* src, size_t len, char* dst); // both cases, length must be even
+
+    // url: "-_" instead of "+/". Decoder accepts both alphabets, padding is optional, whitespaces are not allowed
+    size_t encode_base64 (const char* src, size_t len, char* dst, bool url = false, bool pad = true);
+    size_t decode_base64 (const char* src, size_t len, char* dst);
+
+    // all but unreserved chars (ALPHA DIGIT "-._~") are escaped, plus: space is encoded as '+' and '+' is decoded as space (HTML forms)
+    size_t encode_percent (const char* src, size_t len, char* dst, bool plus = false);
+    size_t decode_percent (const char* src, size_t len, char* dst, bool plus = false); // never fails, invalid escapes are copied as is
+}
+
+string encode_hex     (string_view src, bool upper = false);
+void   encode_hex     (string_view src, string& out, bool upper = false);
+string decode_hex     (string_view src); // throws std::invalid_argument
+bool   decode_hex     (string_view src, string& out); // on error returns false and out is unchanged
+
+string encode_base64  (string_view src, bool url = false, bool pad = true);
+void   encode_base64  (string_view src, string& out, bool url = false, bool pad = true);
+string decode_base64  (string_view src); // throws std::invalid_argument
+bool   decode_base64  (string_view src, string& out); // on error returns false and out is unchanged
+
+string encode_percent (string_view src, bool plus = false);
+void   encode_percent (string_view src, string& out, bool plus = false);
+string decode_percent (string_view src, bool plus = false);
+void   decode_percent (string_view src, string& out, bool plus = false);
+
+// output of update() calls and finish() is the same as of one call for concatenation of chunks
+struct base64_encoder {
+    base64_encoder (bool url = false, bool pad = true) : _url(url), _pad(pad), _tail_len(0) {}
+
+    void update (string_view chunk, string& out);
+    void finish (string& out);
+
+private:
+    bool   _url;
+    bool   _pad;
+    char   _tail[2];
+    size_t _tail_len;
+};
+
+// after false is returned from update() or finish() input is invalid and decoder must be reset() to be used again
+struct base64_decoder {
+    base64_decoder () { reset(); }
+
+    bool update (string_view chunk, string& out);
+    bool finish (string& out);
+    void reset  () { _tail_len = 0; _ended = false; }
+
+private:
+    char   _tail[4];
+    size_t _tail_len;
+    bool   _ended; // padding was met
+
+    bool _decode (const char* src, size_t len, string& out);
+};
+
+struct hex_decoder {
+    hex_decoder () : _has_tail(false) {}
+
+    bool update (string_view chunk, string& out);
+    bool finish (string&) { return !_has_tail; }
+    void reset  () { _has_tail = false; }
+
+private:
+    char _tail;
+    bool _has_tail;
+};
+
+struct percent_decoder {
+    percent_decoder (bool plus = false) : _plus(plus), _tail_len(0) {}
+
+    void update (string_view chunk, string& out);
+    void finish (string& out);
+
+private:
+    bool   _plus;
+    char   _tail[2]; // incomplete escape
+    size_t _tail_len;
+};
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "hash.h"
+#include "flat_string_table.h"
+#include <tuple>
+
+/*
+ * panda::flat_string_map is an open addressing hash map (Swiss table, see flat_string_table.h) for panda::string keys.
+ * Interface is close to std::unordered_map without buckets and allocators. All lookup methods accept panda strings, string_views and
+ * anything convertible to them without creating a key, try_emplace() and operator[] create a key only if it is inserted.
+ * Any insertion may invalidate iterators and references, erase() invalidates only erased ones.
+ * StoreHash=true makes element bigger by size_t, but rehashes don't call hasher and keys are compared only for equal hashes.
+ */
+
+namespace panda {
+
+    template <class Key, class T, class Hash = hash::default_hasher, class KeyEqual = std::equal_to<>, bool StoreHash = false>
+    class flat_string_map : public detail::flat_string_table<detail::flat_map_policy<Key,T>, Hash, KeyEqual, StoreHash> {
+        using Base = detail::flat_string_table<detail::flat_map_policy<Key,T>, Hash, KeyEqual, StoreHash>;
+        template <class X> using enable_if_lookup = typename Base::template enable_if_lookup<X>;
+    public:
+        using typename Base::key_type;
+        using typename Base::value_type;
+        using typename Base::size_type;
+        using typename Base::iterator;
+        using typename Base::const_iterator;
+        using mapped_type = T;
+
+        using Base::Base;
+
+        flat_string_map () {}
+
+        template <class InputIt>
+        flat_string_map (InputIt first, InputIt last, size_type n = 0, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual()) : Base(n, hash, eq) {
+            insert(first, last);
+        }
+
+        flat_string_map (std::initializer_list<value_type> list, size_type n = 0, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual())
+            : flat_string_map(list.begin(), list.end(), n, hash, eq) {}
+
+        flat_string_map& operator= (std::initializer_list<value_type> list) {
+            this->clear();
+            insert(list);
+            return *this;
+        }
+
+        template <class X, typename = enable_if_lookup<X>>
+        T& at (const X& key) {
+            auto it = this->find(key);
+            if (it == this->end()) throw std::out_of_range("flat_string_map::at");
+            return it->second;
+        }
+
+        template <class X, typename = enable_if_lookup<X>>
+        const T& at (const X& key) const {
+            auto it = this->find(key);
+            if (it == this->end()) throw std::out_of_range("flat_string_map::at");
+            return it->second;
+        }
+
+        template <class X, typename = enable_if_lookup<X>>
+        T& operator[] (X&& key) { return try_emplace(std::forward<X>(key)).first->second; }
+
+        template <class X, class... Args, typename = enable_if_lookup<X>>
+        std::pair<iterator, bool> try_emplace (X&& key, Args&&... args) {
+            auto res = this->_try_emplace(key, [&](void* p) {
+                new (p) value_type(std::piecewise_construct, std::forward_as_tuple(Base::_make_key(std::forward<X>(key))), std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+            return {this->_iter(res.first), res.second};
+        }
+
+        template <class X, class M, typename = enable_if_lookup<X>>
+        std::pair<iterator, bool> insert_or_assign (X&& key, M&& value) {
+            auto res = try_emplace(std::forward<X>(key), std::forward<M>(value));
+            if (!res.second) res.first->second = std::forward<M>(value);
+            return res;
+        }
+
+        template <class X, class M, typename = enable_if_lookup<X>>
+        std::pair<iterator, bool> emplace (X&& key, M&& value) { return try_emplace(std::forward<X>(key), std::forward<M>(value)); }
+
+        // other forms create value before lookup, like in std::unordered_map. Its key is const, so it is copied (which is cheap for panda strings)
+        template <class... Args>
+        std::pair<iterator, bool> emplace (Args&&... args) {
+            value_type tmp(std::forward<Args>(args)...);
+            return try_emplace(tmp.first, std::move(tmp.second));
+        }
+
+        std::pair<iterator, bool> insert (const value_type& value) { return try_emplace(value.first, value.second); }
+        std::pair<iterator, bool> insert (value_type&& value)      { return try_emplace(value.first, std::move(value.second)); }
+
+        template <class P, typename = typename std::enable_if<std::is_constructible<value_type, P&&>::value>::type>
+        std::pair<iterator, bool> insert (P&& value) { return emplace(std::forward<P>(value)); }
+
+        template <class InputIt>
+        void insert (InputIt first, InputIt last) { for (; first != last; ++first) insert(*first); }
+
+        void insert (std::initializer_list<value_type> list) { insert(list.begin(), list.end()); }
+    };
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "hash.h"
+#include "flat_string_table.h"
+
+/*
+ * panda::flat_string_set is an open addressing hash set (Swiss table, see flat_string_table.h) for panda::string keys.
+ * All lookup methods accept panda strings, string_views and anything convertible to them without creating a key, insert() creates
+ * a key only if it is inserted. Any insertion may invalidate iterators and references, erase() invalidates only erased ones.
+ */
+
+namespace panda {
+
+    template <class Key, class Hash = hash::default_hasher, class KeyEqual = std::equal_to<>, bool StoreHash = false>
+    class flat_string_set : public detail::flat_string_table<detail::flat_set_policy<Key>, Hash, KeyEqual, StoreHash> {
+        using Base = detail::flat_string_table<detail::flat_set_policy<Key>, Hash, KeyEqual, StoreHash>;
+        template <class X> using enable_if_lookup = typename Base::template enable_if_lookup<X>;
+    public:
+        using typename Base::key_type;
+        using typename Base::value_type;
+        using typename Base::size_type;
+        using typename Base::iterator;
+        using typename Base::const_iterator;
+
+        using Base::Base;
+
+        flat_string_set () {}
+
+        template <class InputIt>
+        flat_string_set (InputIt first, InputIt last, size_type n = 0, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual()) : Base(n, hash, eq) {
+            insert(first, last);
+        }
+
+        flat_string_set (std::initializer_list<value_type> list, size_type n = 0, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual())
+            : flat_string_set(list.begin(), list.end(), n, hash, eq) {}
+
+        flat_string_set& operator= (std::initializer_list<value_type> list) {
+            this->clear();
+            insert(list);
+            return *this;
+        }
+
+        template <class X, typename = enable_if_lookup<X>>
+        std::pair<iterator, bool> insert (X&& key) {
+            auto res = this->_try_emplace(key, [&](void* p) { new (p) value_type(Base::_make_key(std::forward<X>(key))); });
+            return {this->_iter(res.first), res.second};
+        }
+
+        template <class... Args>
+        std::pair<iterator, bool> emplace (Args&&... args) { return insert(key_type(std::forward<Args>(args)...)); }
+
+        template <class InputIt>
+        void insert (InputIt first, InputIt last) { for (; first != last; ++first) insert(*first); }
+
+        void insert (std::initializer_list<value_type> list) { insert(list.begin(), list.end()); }
+    };
+
+}
@@ -0,0 +1,507 @@
+#pragma once
+#include "string.h"
+#include "string_view.h"
+#include <new>
+#include <cstring>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <stdexcept>
+#include <initializer_list>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+namespace panda { namespace detail {
+
+/*
+ * Open addressing hash table with SIMD probing (Swiss table) for flat_string_map and flat_string_set.
+ *
+ * Elements are stored in one array, every slot has a control byte in a parallel array: EMPTY, DELETED or 7 lower bits of element's hash.
+ * Lookup loads a group of 16 control bytes at once (SSE2, which is always available on x86_64, other platforms check them one by one),
+ * matches them against hash bits and compares keys only for matched slots, so most of the time it is one hash, one or two group loads
+ * and one key comparison. Control bytes of the first group are mirrored after the end, so that groups may start at any slot.
+ * Capacity is a power of 2 (at least GROUP_SIZE), at most 7/8 of slots are used, deleted slots are marked DELETED until next rehash.
+ *
+ * Keys are found by anything convertible to string_view without creating a key (hasher and comparator must accept both, as
+ * hash::default_hasher and std::equal_to<> do), key is created only when inserting. With StoreHash full hashes are stored along with
+ * elements, then rehashing doesn't hash keys again and hash is compared before key, which helps for long keys with common prefixes.
+ */
+struct flat_table_ctrl {
+    static constexpr const int8_t EMPTY      = -128;
+    static constexpr const int8_t DELETED    = -2;
+    static constexpr const size_t GROUP_SIZE = 16;
+
+    static const int8_t* empty_group () {
+        static const int8_t ret[GROUP_SIZE] = {EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY,
+                                               EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY};
+        return ret;
+    }
+
+    // bit i of masks is set for matched byte i of the group
+    struct group {
+        #ifdef __SSE2__
+        __m128i ctrl;
+
+        explicit group (const int8_t* p) : ctrl(_mm_loadu_si128((const __m128i*)p)) {}
+
+        uint32_t match       (int8_t h2) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))); }
+        uint32_t match_empty ()          const { return match(EMPTY); }
+        uint32_t match_free  ()          const { return _mm_movemask_epi8(ctrl); } // EMPTY and DELETED have high bit set
+        #else
+        const int8_t* ctrl;
+
+        explicit group (const int8_t* p) : ctrl(p) {}
+
+        uint32_t match (int8_t h2) const {
+            uint32_t ret = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) ret |= uint32_t(ctrl[i] == h2) << i;
+            return ret;
+        }
+        uint32_t match_empty () const { return match(EMPTY); }
+        uint32_t match_free  () const {
+            uint32_t ret = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) ret |= uint32_t(ctrl[i] < 0) << i;
+            return ret;
+        }
+        #endif
+    };
+
+    static unsigned lowest_bit (uint32_t mask) {
+        #ifdef __GNUC__
+        return __builtin_ctz(mask);
+        #else
+        unsigned ret = 0;
+        while (!(mask & 1)) { mask >>= 1; ++ret; }
+        return ret;
+        #endif
+    }
+};
+
+template <class Key, class T>
+struct flat_map_policy {
+    using key_type   = Key;
+    using value_type = std::pair<const Key, T>;
+    static const Key& key (const value_type& v) { return v.first; }
+};
+
+template <class Key>
+struct flat_set_policy {
+    using key_type   = Key;
+    using value_type = Key;
+    static const Key& key (const value_type& v) { return v; }
+};
+
+template <class Policy, class Hash, class KeyEqual, bool StoreHash>
+class flat_string_table : protected flat_table_ctrl {
+public:
+    using key_type        = typename Policy::key_type;
+    using value_type      = typename Policy::value_type;
+    using size_type       = size_t;
+    using difference_type = ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = KeyEqual;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+    using pointer         = value_type*;
+    using const_pointer   = const value_type*;
+
+private:
+    template <typename C, typename TR, typename A>
+    static inline std::true_type  _is_base_string (panda::basic_string<C,TR,A> const volatile) { return std::true_type(); }
+    static inline std::false_type _is_base_string (...) { return std::false_type(); }
+
+    static_assert(decltype(_is_base_string(key_type()))::value, "Key must be based on panda::basic_string");
+
+    // functors are copied, not default-constructed and assigned: seeded hashers would draw a new random seed for nothing
+    flat_string_table (const Hash& hash, const KeyEqual& eq)
+        : _hash(hash), _eq(eq), _ctrl(const_cast<int8_t*>(empty_group())), _slots(), _hashes(), _capacity(0), _size(0), _growth_left(0) {}
+
+protected:
+    using SVKey = basic_string_view<typename key_type::value_type, typename key_type::traits_type>;
+
+    // lookup argument: key itself or anything convertible to string_view, like other strings, views and literals
+    template <class X>
+    using enable_if_lookup = typename std::enable_if<std::is_same<typename std::decay<X>::type, key_type>::value || std::is_convertible<const X&, SVKey>::value>::type;
+
+    static const size_t npos = size_t(-1);
+
+    // hasher and comparator always get key_type or SVKey
+    static const key_type& _lk (const key_type& key) { return key; }
+    template <class X>
+    static SVKey _lk (const X& key) { return SVKey(key); }
+
+public:
+    template <bool Const>
+    struct basic_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename Policy::value_type;
+        using difference_type   = ptrdiff_t;
+        using pointer           = typename std::conditional<Const, const value_type*, value_type*>::type;
+        using reference         = typename std::conditional<Const, const value_type&, value_type&>::type;
+
+        basic_iterator () : _ctrl(), _end(), _slot() {}
+
+        template <bool C, typename = typename std::enable_if<Const && !C>::type>
+        basic_iterator (const basic_iterator<C>& oth) : _ctrl(oth._ctrl), _end(oth._end), _slot(oth._slot) {}
+
+        reference operator*  () const { return *_slot; }
+        pointer   operator-> () const { return _slot; }
+
+        basic_iterator& operator++ () {
+            ++_ctrl;
+            ++_slot;
+            _skip();
+            return *this;
+        }
+
+        basic_iterator operator++ (int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        template <bool C> bool operator== (const basic_iterator<C>& oth) const { return _ctrl == oth._ctrl; }
+        template <bool C> bool operator!= (const basic_iterator<C>& oth) const { return _ctrl != oth._ctrl; }
+
+    private:
+        friend flat_string_table;
+        template <bool> friend struct basic_iterator;
+
+        const int8_t* _ctrl;
+        const int8_t* _end;
+        pointer       _slot;
+
+        basic_iterator (const int8_t* ctrl, const int8_t* end, pointer slot) : _ctrl(ctrl), _end(end), _slot(slot) {}
+
+        void _skip () {
+            while (_ctrl != _end && *_ctrl < 0) {
+                ++_ctrl;
+                ++_slot;
+            }
+        }
+    };
+
+    using iterator       = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    flat_string_table () : flat_string_table(Hash(), KeyEqual()) {}
+
+    explicit flat_string_table (size_type n, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual()) : flat_string_table(hash, eq) {
+        reserve(n);
+    }
+
+    flat_string_table (const flat_string_table& oth) : flat_string_table(oth._hash, oth._eq) {
+        reserve(oth._size);
+        for (auto& v : oth) _insert_unique(oth._hash_of(v), [&](void* p) { new (p) value_type(v); });
+    }
+
+    // moved-from table is empty and keeps copies of hasher and comparator
+    flat_string_table (flat_string_table&& oth) noexcept(_nothrow_functors) : flat_string_table(oth._hash, oth._eq) { swap(oth); }
+
+    ~flat_string_table () { _destroy(); }
+
+    flat_string_table& operator= (const flat_string_table& oth) {
+        if (this != &oth) {
+            flat_string_table tmp(oth);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    flat_string_table& operator= (flat_string_table&& oth) noexcept(_nothrow_functors) {
+        swap(oth);
+        return *this;
+    }
+
+    iterator       begin  ()       { return _begin<false>(); }
+    const_iterator begin  () const { return _begin<true>(); }
+    const_iterator cbegin () const { return _begin<true>(); }
+    iterator       end    ()       { return iterator(_ctrl + _capacity, _ctrl + _capacity, _slots + _capacity); }
+    const_iterator end    () const { return const_iterator(_ctrl + _capacity, _ctrl + _capacity, _slots + _capacity); }
+    const_iterator cend   () const { return end(); }
+
+    bool      empty    () const { return !_size; }
+    size_type size     () const { return _size; }
+    size_type capacity () const { return _capacity; }
+
+    hasher    hash_function () const { return _hash; }
+    key_equal key_eq        () const { return _eq; }
+
+    float load_factor     () const { return _capacity ? float(_size) / _capacity : 0; }
+    float max_load_factor () const { return 7.f / 8; }
+
+    template <class X, typename = enable_if_lookup<X>>
+    iterator find (const X& key) { return _iter(_find(_lk(key))); }
+
+    template <class X, typename = enable_if_lookup<X>>
+    const_iterator find (const X& key) const { return _iter(_find(_lk(key))); }
+
+    // hash must be equal to hash_function()(key), e.g. "key"_h for default hasher (see hash.h)
+    template <class X, typename = enable_if_lookup<X>>
+    iterator find_hashed (const X& key, size_t hash) { return _iter(_find(_lk(key), hash)); }
+
+    template <class X, typename = enable_if_lookup<X>>
+    const_iterator find_hashed (const X& key, size_t hash) const { return _iter(_find(_lk(key), hash)); }
+
+    template <class X, typename = enable_if_lookup<X>>
+    size_type count (const X& key) const { return _find(_lk(key)) != npos; }
+
+    template <class X, typename = enable_if_lookup<X>>
+    bool contains (const X& key) const { return _find(_lk(key)) != npos; }
+
+    template <class X, typename = enable_if_lookup<X>>
+    std::pair<iterator,iterator> equal_range (const X& key) {
+        auto it = find(key);
+        if (it == end()) return {it, it};
+        auto next = it;
+        return {it, ++next};
+    }
+
+    template <class X, typename = enable_if_lookup<X>>
+    std::pair<const_iterator,const_iterator> equal_range (const X& key) const {
+        auto it = find(key);
+        if (it == end()) return {it, it};
+        auto next = it;
+        return {it, ++next};
+    }
+
+    template <class X, typename = enable_if_lookup<X>>
+    size_type erase (const X& key) {
+        auto i = _find(_lk(key));
+        if (i == npos) return 0;
+        _erase(i);
+        return 1;
+    }
+
+    iterator erase (const_iterator it) {
+        size_t i = it._slot - _slots;
+        _erase(i);
+        return _iter_from(i + 1);
+    }
+
+    iterator erase (iterator it) { return erase(const_iterator(it)); }
+
+    iterator erase (const_iterator first, const_iterator last) {
+        while (first != last) first = erase(first);
+        return _iter_from(first._slot - _slots);
+    }
+
+    void clear () {
+        if (!_capacity) return;
+        for (size_t i = 0; i < _capacity; ++i) if (_ctrl[i] >= 0) _slots[i].~value_type();
+        memset(_ctrl, EMPTY, _capacity + GROUP_SIZE - 1);
+        _size        = 0;
+        _growth_left = _max_size(_capacity);
+    }
+
+    // makes room for n elements without rehashes
+    void reserve (size_type n) {
+        size_t cap = GROUP_SIZE;
+        while (_max_size(cap) < n) cap *= 2;
+        if (cap > _capacity) _rehash(cap);
+    }
+
+    void rehash (size_type n) {
+        size_t cap = GROUP_SIZE;
+        while (cap < n || _max_size(cap) < _size) cap *= 2;
+        if (!_size && !n) {
+            _destroy();
+            _reset();
+        }
+        else if (cap != _capacity) _rehash(cap);
+    }
+
+    void swap (flat_string_table& oth) noexcept(_nothrow_functors) {
+        using std::swap;
+        swap(_hash, oth._hash);
+        swap(_eq, oth._eq);
+        swap(_ctrl, oth._ctrl);
+        swap(_slots, oth._slots);
+        swap(_hashes, oth._hashes);
+        swap(_capacity, oth._capacity);
+        swap(_size, oth._size);
+        swap(_growth_left, oth._growth_left);
+    }
+
+    bool operator== (const flat_string_table& oth) const {
+        if (_size != oth._size) return false;
+        for (auto& v : *this) {
+            auto it = oth.find(Policy::key(v));
+            if (it == oth.end() || !(*it == v)) return false;
+        }
+        return true;
+    }
+
+    bool operator!= (const flat_string_table& oth) const { return !operator==(oth); }
+
+protected:
+    static constexpr bool _nothrow_functors = std::is_nothrow_copy_constructible<Hash>::value && std::is_nothrow_move_assignable<Hash>::value &&
+                                              std::is_nothrow_copy_constructible<KeyEqual>::value && std::is_nothrow_move_assignable<KeyEqual>::value;
+
+    Hash        _hash;
+    KeyEqual    _eq;
+    int8_t*     _ctrl;
+    value_type* _slots;
+    size_t*     _hashes; // only with StoreHash
+    size_t      _capacity;
+    size_t      _size;
+    size_t      _growth_left; // EMPTY slots which may be used before rehash
+
+    static constexpr size_t _max_size (size_t cap) { return cap - cap / 8; }
+
+    static int8_t _h2 (size_t hash) { return int8_t(hash & 0x7f); }
+
+    size_t _hash_of (const value_type& v) const { return _hash(Policy::key(v)); }
+
+    template <class X>
+    size_t _find (const X& key) const { return _size ? _find(key, _hash(key)) : npos; }
+
+    template <class X>
+    size_t _find (const X& key, size_t hash) const {
+        if (!_capacity) return npos;
+        size_t mask = _capacity - 1;
+        size_t pos  = (hash >> 7) & mask;
+        auto   h2   = _h2(hash);
+        // triangular probing visits every group once when number of groups is a power of 2
+        for (size_t step = GROUP_SIZE;; pos = (pos + step) & mask, step += GROUP_SIZE) {
+            group g(_ctrl + pos);
+            for (auto m = g.match(h2); m; m &= m - 1) {
+                size_t i = (pos + lowest_bit(m)) & mask;
+                if ((!StoreHash || _hashes[i] == hash) && _eq(Policy::key(_slots[i]), key)) return i;
+            }
+            if (g.match_empty()) return npos;
+        }
+    }
+
+    size_t _find_free (size_t hash) const {
+        size_t mask = _capacity - 1;
+        size_t pos  = (hash >> 7) & mask;
+        for (size_t step = GROUP_SIZE;; pos = (pos + step) & mask, step += GROUP_SIZE) {
+            if (auto m = group(_ctrl + pos).match_free()) return (pos + lowest_bit(m)) & mask;
+        }
+    }
+
+    void _set_ctrl (size_t i, int8_t v) {
+        _ctrl[i] = v;
+        if (i < GROUP_SIZE - 1) _ctrl[_capacity + i] = v;
+    }
+
+    // finds slot for a new element, growing table if needed, and marks it as used by hash, the slot must be constructed after that
+    size_t _prepare_insert (size_t hash) {
+        size_t i = _capacity ? _find_free(hash) : 0;
+        if (!_capacity || (!_growth_left && _ctrl[i] == EMPTY)) {
+            // table full of DELETED slots is cleaned up without growing
+            _rehash(_capacity && _size < _max_size(_capacity) / 2 ? _capacity : (_capacity ? _capacity * 2 : GROUP_SIZE));
+            i = _find_free(hash);
+        }
+        if (_ctrl[i] == EMPTY) --_growth_left;
+        _set_ctrl(i, _h2(hash));
+        if (StoreHash) _hashes[i] = hash;
+        return i;
+    }
+
+    // construct(void*) creates element in place
+    template <class F>
+    size_t _insert_unique (size_t hash, F&& construct) {
+        size_t i = _prepare_insert(hash);
+        try {
+            construct((void*)(_slots + i));
+        } catch (...) {
+            _set_ctrl(i, DELETED);
+            throw;
+        }
+        ++_size;
+        return i;
+    }
+
+    // inserts element if key is not found, so that key is converted to key_type only in that case
+    template <class X, class F>
+    std::pair<size_t, bool> _try_emplace (const X& key, F&& construct) {
+        auto&& k    = _lk(key);
+        size_t hash = _hash(k);
+        if (_size) {
+            auto i = _find(k, hash);
+            if (i != npos) return {i, false};
+        }
+        return {_insert_unique(hash, construct), true};
+    }
+
+    static key_type _make_key (const key_type& key) { return key; }
+    static key_type _make_key (key_type&& key)      { return std::move(key); }
+    template <class X>
+    static key_type _make_key (const X& key) {
+        SVKey sv(key);
+        return key_type(sv.data(), sv.length());
+    }
+
+    void _erase (size_t i) {
+        _slots[i].~value_type();
+        _set_ctrl(i, DELETED);
+        --_size;
+    }
+
+    iterator _iter (size_t i) const {
+        if (i == npos) return const_cast<flat_string_table*>(this)->end();
+        return iterator(_ctrl + i, _ctrl + _capacity, _slots + i);
+    }
+
+    iterator _iter_from (size_t i) const {
+        iterator ret(_ctrl + i, _ctrl + _capacity, _slots + i);
+        ret._skip();
+        return ret;
+    }
+
+    template <bool Const>
+    basic_iterator<Const> _begin () const {
+        basic_iterator<Const> ret(_ctrl, _ctrl + _capacity, _slots);
+        ret._skip();
+        return ret;
+    }
+
+    // one allocation: slots, hashes, control bytes
+    static size_t _hashes_offset (size_t cap) { return (cap * sizeof(value_type) + alignof(size_t) - 1) / alignof(size_t) * alignof(size_t); }
+    static size_t _ctrl_offset   (size_t cap) { return _hashes_offset(cap) + (StoreHash ? cap * sizeof(size_t) : 0); }
+    static size_t _alloc_size    (size_t cap) { return _ctrl_offset(cap) + cap + GROUP_SIZE - 1; }
+
+    void _allocate (size_t cap) {
+        auto buf     = (char*)::operator new(_alloc_size(cap));
+        _slots       = (value_type*)buf;
+        _hashes      = StoreHash ? (size_t*)(buf + _hashes_offset(cap)) : nullptr;
+        _ctrl        = (int8_t*)(buf + _ctrl_offset(cap));
+        _capacity    = cap;
+        _growth_left = _max_size(cap);
+        memset(_ctrl, EMPTY, cap + GROUP_SIZE - 1);
+    }
+
+    // new table is built aside and swapped in. Elements are copied unless they can be moved without exceptions (a pair with const key
+    // usually can't), so that the table is unchanged if copying throws. Exceptions from hasher leave it valid, but unspecified
+    void _rehash (size_t cap) {
+        flat_string_table tmp(_hash, _eq);
+        tmp._allocate(cap);
+        for (size_t i = 0; i < _capacity; ++i) {
+            if (_ctrl[i] < 0) continue;
+            size_t hash = StoreHash ? _hashes[i] : _hash_of(_slots[i]);
+            tmp._insert_unique(hash, [&](void* p) { new (p) value_type(std::move_if_noexcept(_slots[i])); });
+        }
+        swap(tmp);
+    }
+
+    void _destroy () {
+        if (!_capacity) return;
+        for (size_t i = 0; i < _capacity; ++i) if (_ctrl[i] >= 0) _slots[i].~value_type();
+        ::operator delete(_slots);
+    }
+
+    void _reset () {
+        _ctrl        = const_cast<int8_t*>(empty_group());
+        _slots       = nullptr;
+        _hashes      = nullptr;
+        _capacity    = 0;
+        _size        = 0;
+        _growth_left = 0;
+    }
+};
+
+}}
@@ -1,8 +1,13 @@
 #include "from_chars.h"
-#include <cctype> // isspace
+#include "endian.h"
 #include <cstring> // memcpy
 #include <stdexcept>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define PANDA_CHARS_X86 1
+#  include <immintrin.h>
+#endif
+
 namespace panda {
 
 static unsigned _index[256];
@@ -19,8 +24,8 @@ static bool _init () {
 }
 static const bool _inited = _init();
 
-static inline bool _is_space (unsigned char ch)    { return std::isspace(ch); }
-//static inline bool _is_space (unsigned wchar_t ch) { return std::iswspace(ch); }
+// the same set as isspace() in "C" locale
+static inline bool _is_space (unsigned ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
 
 template <class C>
 static inline bool _find_sign (const C*& ptr, const C* const end) {
@@ -54,48 +59,164 @@ static inline UT _parse (const UC*& ptr, const UC* const end, unsigned base, UT
     return res;
 }
 
+/*
+ * Base 10 fast path. Digits are checked and converted by 8 at once within uint64_t (SWAR), or by 16 at once with SSE4.1 when CPU has it.
+ * Up to 19 digits can't overflow uint64_t, so that there are no per-digit overflow checks: the value is compared to max in the end.
+ */
+static const uint64_t _pow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+static inline int _ctz64 (uint64_t val) {
+    #if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(val);
+    #else
+    int ret = 0;
+    for (; !(val & 1); val >>= 1) ++ret;
+    return ret;
+    #endif
+}
+
+// number of leading digit chars in 8 bytes loaded as little-endian
+static inline int _swar_count (uint64_t chunk) {
+    uint64_t nd = (chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4);
+    nd ^= 0x3333333333333333; // zero bytes are digits
+    return nd ? _ctz64(nd) >> 3 : 8;
+}
+
+// value of first `cnt` (1-8) digit chars
+static inline uint64_t _swar_value (uint64_t chunk, int cnt) {
+    if (cnt < 8) chunk <<= 8 * (8 - cnt); // leading zero bytes act as '0'
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+    return ((chunk & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+}
+
+#ifdef PANDA_CHARS_X86
+// number of leading digit chars in 16 bytes (0-16), value is set to their value
+__attribute__((target("sse4.1")))
+static int _sse41_parse16 (const char* ptr, uint64_t& value) {
+    static const int8_t shift[32] = {
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+    };
+    __m128i v = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)ptr), _mm_set1_epi8('0'));
+    __m128i bad = _mm_or_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)), _mm_cmplt_epi8(v, _mm_setzero_si128()));
+    unsigned mask = _mm_movemask_epi8(bad);
+    int cnt = mask ? __builtin_ctz(mask) : 16;
+    if (!cnt) return 0;
+
+    v = _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i*)(shift + cnt))); // right-align digits, zeros before them
+    v = _mm_maddubs_epi16(v, _mm_set_epi8(1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10)); // 8 x 2 digits
+    v = _mm_madd_epi16(v, _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100));                            // 4 x 4 digits
+    v = _mm_packus_epi32(v, v);
+    v = _mm_madd_epi16(v, _mm_set_epi16(1, 10000, 1, 10000, 1, 10000, 1, 10000));                    // 2 x 8 digits
+    uint64_t res;
+    _mm_storel_epi64((__m128i*)&res, v);
+    value = (res & 0xFFFFFFFF) * 100000000 + (res >> 32);
+    return cnt;
+}
+
+static const bool _has_sse41 = (__builtin_cpu_init(), __builtin_cpu_supports("sse4.1"));
+#endif
+
+template <typename UT, typename UC>
+static inline UT _parse10 (const UC*& ptr, const UC* const end, UT max, bool& overflow) {
+    uint64_t res = 0;
+    int      n   = 0; // significant digits in res
+    overflow = false;
+
+    auto p = ptr;
+    while (p != end && *p == '0') ++p;
+
+    #ifdef PANDA_CHARS_X86
+    if (_has_sse41 && end - p >= 16) {
+        n = _sse41_parse16((const char*)p, res);
+        p += n;
+        if (n < 16) goto done;
+    }
+    #endif
+
+    while (end - p >= 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, p, 8);
+        chunk = le2h64(chunk);
+        int cnt = _swar_count(chunk);
+        if (n + cnt > 19) break;
+        if (cnt) res = res * _pow10[cnt] + _swar_value(chunk, cnt);
+        n += cnt;
+        p += cnt;
+        if (cnt < 8) goto done;
+    }
+
+    for (; p != end; ++p) {
+        unsigned d = *p - '0';
+        if (d > 9) break;
+        if (n < 19 || (n == 19 && res <= (UINT64_MAX - d) / 10)) {
+            res = res * 10 + d;
+            ++n;
+        }
+        else overflow = true;
+    }
+
+    done:
+    if (p == ptr) return 0; // no digits
+    ptr = p;
+    if (overflow || res > max) {
+        overflow = true;
+        return max;
+    }
+    return (UT)res;
+}
+
+template <typename UT, typename UC>
+static inline UT _parse_any (const UC*& ptr, const UC* const end, unsigned base, UT max, bool& overflow) {
+    if (base == 10 && sizeof(UC) == 1) return _parse10(ptr, end, max, overflow);
+    return _parse(ptr, end, base, max, overflow);
+}
+
 template <typename UT, typename C>
-static inline typename std::enable_if<std::is_unsigned<UT>::value, from_chars_result>::type _from_chars (const C* s, const C* send, UT& value, unsigned base) {
+static inline typename std::enable_if<std::is_unsigned<UT>::value, from_chars_result>::type _from_chars (const C* s, const C* send, UT& value, unsigned base, bool strict = false) {
     using UC = typename std::make_unsigned<C>::type;
     const UC* ptr = (const UC*)s;
     const UC* const end = (const UC*)send;
     if (base < 2 || base > 36) base = 10;
 
-    while (ptr != end && _is_space(*ptr)) ++ptr; // skip whitespaces in the beginning
+    if (!strict) while (ptr != end && _is_space(*ptr)) ++ptr; // skip whitespaces in the beginning
 
     bool overflow;
     auto tmp = ptr;
-    value = _parse(ptr, end, base, std::numeric_limits<UT>::max(), overflow);
+    auto res = _parse_any(ptr, end, base, std::numeric_limits<UT>::max(), overflow);
 
     if (ptr - tmp == 0) return {s, make_error_code(std::errc::invalid_argument)};
+    value = res;
     if (overflow)       return {(const C*)ptr, make_error_code(std::errc::result_out_of_range)};
     return {(const C*)ptr, std::error_code()};
 }
 
 template <typename T, typename C>
-static inline typename std::enable_if<!std::is_unsigned<T>::value, from_chars_result>::type _from_chars (const C* s, const C* send, T& value, unsigned base) {
+static inline typename std::enable_if<!std::is_unsigned<T>::value, from_chars_result>::type _from_chars (const C* s, const C* send, T& value, unsigned base, bool strict = false) {
     using UC = typename std::make_unsigned<C>::type;
     using UT = typename std::make_unsigned<T>::type;
     const UC* ptr = (const UC*)s;
     const UC* const end = (const UC*)send;
     if (base < 2 || base > 36) base = 10;
 
-    while (ptr != end && _is_space(*ptr)) ++ptr; // skip whitespaces in the beginning
+    if (!strict) while (ptr != end && _is_space(*ptr)) ++ptr; // skip whitespaces in the beginning
 
     bool minus = false;
     if (ptr != end && *ptr == '-') { ++ptr; minus = true; }
     bool overflow;
     auto tmp = ptr;
 
+    T res;
     if (minus) {
         UT max = (UT)std::numeric_limits<T>::max() - (T)(std::numeric_limits<T>::max() + std::numeric_limits<T>::min());
-        UT tmp = _parse<UT>(ptr, end, base, max, overflow);
-        value = (T)0 - tmp;
+        UT tmp = _parse_any<UT>(ptr, end, base, max, overflow);
+        res = (T)0 - tmp;
     } else {
-        value = _parse<UT>(ptr, end, base, (UT)std::numeric_limits<T>::max(), overflow);
+        res = _parse_any<UT>(ptr, end, base, (UT)std::numeric_limits<T>::max(), overflow);
     }
 
     if (ptr - tmp == 0) return {s, make_error_code(std::errc::invalid_argument)};
+    value = res;
     if (overflow)       return {(const C*)ptr, make_error_code(std::errc::result_out_of_range)};
     return {(const C*)ptr, std::error_code()};
 }
@@ -111,6 +232,80 @@ from_chars_result from_chars (const char* first, const char* last, unsigned&
 from_chars_result from_chars (const char* first, const char* last, unsigned long&      value, int base) { return _from_chars<unsigned long>     (first, last, value, base); }
 from_chars_result from_chars (const char* first, const char* last, unsigned long long& value, int base) { return _from_chars<unsigned long long>(first, last, value, base); }
 
+from_chars_result from_chars_strict (const char* first, const char* last, int8_t&             value, int base) { return _from_chars<int8_t>            (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, int16_t&            value, int base) { return _from_chars<int16_t>           (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, int&                value, int base) { return _from_chars<int>               (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, long&               value, int base) { return _from_chars<long>              (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, long long&          value, int base) { return _from_chars<long long>         (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, uint8_t&            value, int base) { return _from_chars<uint8_t>           (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, uint16_t&           value, int base) { return _from_chars<uint16_t>          (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, unsigned&           value, int base) { return _from_chars<unsigned>          (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, unsigned long&      value, int base) { return _from_chars<unsigned long>     (first, last, value, base, true); }
+from_chars_result from_chars_strict (const char* first, const char* last, unsigned long long& value, int base) { return _from_chars<unsigned long long>(first, last, value, base, true); }
+
+/*
+ * Bases 10 and 16 count digits first and then write them right into destination from the end, two digits per step from pair tables
+ * (one division per two digits). Other bases go through a buffer of constexpr size.
+ */
+static const char _digits10[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static char _digits16[512];
+
+static bool _init16 () {
+    for (int i = 0; i < 256; ++i) {
+        _digits16[i*2]   = _rindex[i >> 4];
+        _digits16[i*2+1] = _rindex[i & 15];
+    }
+    return true;
+}
+static const bool _inited16 = _inited && _init16();
+
+template <typename UT>
+static inline int _count10 (UT value) {
+    int ret = 1;
+    for (;;) {
+        if (value < 10)    return ret;
+        if (value < 100)   return ret + 1;
+        if (value < 1000)  return ret + 2;
+        if (value < 10000) return ret + 3;
+        value /= 10000;
+        ret += 4;
+    }
+}
+
+template <typename UT>
+static inline int _count16 (UT value) {
+    int ret = 1;
+    while (value >>= 4) ++ret;
+    return ret;
+}
+
+template <typename UT>
+static inline void _write10 (char* end, UT value) {
+    while (value >= 100) {
+        auto i = (value % 100) * 2;
+        value /= 100;
+        end -= 2;
+        std::memcpy(end, _digits10 + i, 2);
+    }
+    if (value >= 10) std::memcpy(end - 2, _digits10 + value * 2, 2);
+    else             end[-1] = char('0' + value);
+}
+
+template <typename UT>
+static inline void _write16 (char* end, UT value) {
+    while (value >= 256) {
+        end -= 2;
+        std::memcpy(end, _digits16 + (value & 0xff) * 2, 2);
+        value >>= 8;
+    }
+    if (value >= 16) std::memcpy(end - 2, _digits16 + value * 2, 2);
+    else             end[-1] = _rindex[value];
+}
+
 template <typename UT, typename C>
 static inline C* _compile (C* ptr, UT value, int base) {
     do {
@@ -120,39 +315,43 @@ static inline C* _compile (C* ptr, UT value, int base) {
     return ptr;
 }
 
-template <typename UT, typename C>
-static inline typename std::enable_if<std::is_unsigned<UT>::value, to_chars_result>::type _to_chars (C* d, C* dend, UT value, int base) {
-    if (base < 2 || base > 36) base = 10;
-    int maxsize = std::ceil(std::numeric_limits<UT>::digits * std::log(2) / std::log(base)); /* enough for UT-bit integer represented in given base */
-    char* strval = (char*)alloca(maxsize);
-    char* end = strval + maxsize;
+// value is written as abs, with '-' in front if minus
+template <typename UT>
+static inline to_chars_result _to_chars_abs (char* d, char* dend, UT value, bool minus, int base) {
+    // 32-bit divisions are much faster than 64-bit ones
+    using WT = typename std::conditional<(sizeof(UT) <= sizeof(uint32_t)), uint32_t, UT>::type;
+
+    if (base == 10 || base == 16) {
+        size_t len = (base == 10 ? _count10<WT>(value) : _count16<WT>(value)) + minus;
+        if (size_t(dend - d) < len) return {dend, make_error_code(std::errc::value_too_large)};
+        if (minus) *d = '-';
+        if (base == 10) _write10<WT>(d + len, value);
+        else            _write16<WT>(d + len, value);
+        return {d + len, std::error_code()};
+    }
+
+    if (base < 2 || base > 36) return _to_chars_abs(d, dend, value, minus, 10);
+    char buf[to_chars_maxsize<UT>(2) + 1];
+    char* end   = buf + sizeof(buf);
     char* begin = _compile(end, value, base);
+    if (minus) *--begin = '-';
     auto len = end - begin;
     if (dend - d < len) return {dend, make_error_code(std::errc::value_too_large)};
     std::memcpy(d, begin, len);
     return {d + len, std::error_code()};
 }
 
+template <typename UT, typename C>
+static inline typename std::enable_if<std::is_unsigned<UT>::value, to_chars_result>::type _to_chars (C* d, C* dend, UT value, int base) {
+    return _to_chars_abs(d, dend, value, false, base);
+}
+
 template <typename T, typename C>
 static inline typename std::enable_if<!std::is_unsigned<T>::value, to_chars_result>::type _to_chars (C* d, C* dend, T value, int base) {
     using UT = typename std::make_unsigned<T>::type;
-    if (base < 2 || base > 36) base = 10;
-    int maxsize = std::ceil(std::numeric_limits<UT>::digits * std::log(2) / std::log(base) + 1);
-    char* strval = (char*)alloca(maxsize);
-    char* end = strval + maxsize;
-    char* begin;
-
-    if (value >= 0) begin = _compile(end, value, base);
-    else {
-        UT positive_value = (UT)std::numeric_limits<T>::max() - (T)(std::numeric_limits<T>::max() + value);
-        begin = _compile(end, positive_value, base);
-        *--begin = '-';
-    }
-
-    auto len = end - begin;
-    if (dend - d < len) return {dend, make_error_code(std::errc::value_too_large)};
-    std::memcpy(d, begin, len);
-    return {d + len, std::error_code()};
+    if (value >= 0) return _to_chars_abs(d, dend, (UT)value, false, base);
+    UT positive_value = (UT)std::numeric_limits<T>::max() - (T)(std::numeric_limits<T>::max() + value);
+    return _to_chars_abs(d, dend, positive_value, true, base);
 }
 
 to_chars_result to_chars (char* first, char* last, int8_t             value, int base) { return _to_chars<int8_t>  (first, last, value, base); }
@@ -21,6 +21,15 @@ struct to_chars_result {
     std::error_code ec;
 };
 
+// same as std::chars_format
+enum class chars_format {
+    scientific = 1,
+    fixed      = 2,
+    hex        = 4,
+    general    = fixed | scientific
+};
+
+// leading whitespaces (ASCII ones, regardless of locale) are skipped, base 10 is parsed 8 or 16 digits at once
 from_chars_result from_chars (const char* first, const char* last, int8_t&             value, int base = 10);
 from_chars_result from_chars (const char* first, const char* last, int16_t&            value, int base = 10);
 from_chars_result from_chars (const char* first, const char* last, int&                value, int base = 10);
@@ -32,6 +41,18 @@ from_chars_result from_chars (const char* first, const char* last, unsigned&
 from_chars_result from_chars (const char* first, const char* last, unsigned long&      value, int base = 10);
 from_chars_result from_chars (const char* first, const char* last, unsigned long long& value, int base = 10);
 
+// same as std::from_chars(): no whitespaces allowed before number
+from_chars_result from_chars_strict (const char* first, const char* last, int8_t&             value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, int16_t&            value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, int&                value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, long&               value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, long long&          value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, uint8_t&            value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, uint16_t&           value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, unsigned&           value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, unsigned long&      value, int base = 10);
+from_chars_result from_chars_strict (const char* first, const char* last, unsigned long long& value, int base = 10);
+
 to_chars_result to_chars (char* first, char* last, int8_t             value, int base = 10);
 to_chars_result to_chars (char* first, char* last, int16_t            value, int base = 10);
 to_chars_result to_chars (char* first, char* last, int                value, int base = 10);
@@ -43,14 +64,45 @@ to_chars_result to_chars (char* first, char* last, unsigned           value, int
 to_chars_result to_chars (char* first, char* last, unsigned long      value, int base = 10);
 to_chars_result to_chars (char* first, char* last, unsigned long long value, int base = 10);
 
+/*
+ * Floating point numbers. Without precision the output is the shortest one which parses back to the same value, the closest to it
+ * of equally short ones (Grisu3 with exact fallback, digits are the same as std::to_chars gives); general format chooses the shorter
+ * of fixed and scientific ones. With precision they work like printf's %f, %e, %g and %a.
+ * Parsing accepts "inf", "infinity" and "nan" (case-insensitive), skips leading whitespaces and does not accept '+' sign or "0x" prefix.
+ */
+from_chars_result from_chars (const char* first, const char* last, float&  value, chars_format fmt = chars_format::general);
+from_chars_result from_chars (const char* first, const char* last, double& value, chars_format fmt = chars_format::general);
+
+to_chars_result to_chars (char* first, char* last, float  value, chars_format fmt = chars_format::general);
+to_chars_result to_chars (char* first, char* last, double value, chars_format fmt = chars_format::general);
+to_chars_result to_chars (char* first, char* last, float  value, chars_format fmt, int precision);
+to_chars_result to_chars (char* first, char* last, double value, chars_format fmt, int precision);
+
+namespace detail {
+    // number of digits of value in given base, invalid base means 10 like in to_chars()
+    constexpr size_t chars_count (unsigned long long value, int base) {
+        if (base < 2 || base > 36) base = 10;
+        size_t ret = 1;
+        for (; value >= (unsigned)base; ++ret) value /= base;
+        return ret;
+    }
+}
+
+// exact maximum length of to_chars() output, may be used as array size
 template <typename UT>
 constexpr typename std::enable_if<std::is_unsigned<UT>::value, size_t>::type to_chars_maxsize (int base = 10) {
-    return std::ceil(std::numeric_limits<UT>::digits * (std::log(2) / std::log(base)));
+    return detail::chars_count(std::numeric_limits<UT>::max(), base);
+}
+
+template <typename T>
+constexpr typename std::enable_if<std::is_signed<T>::value && std::is_integral<T>::value, size_t>::type to_chars_maxsize (int base = 10) {
+    return detail::chars_count((unsigned long long)std::numeric_limits<T>::max() + 1, base) + 1; // minus sign and abs(min)
 }
 
+// shortest representation in general format: sign, digits, point, "e-" and exponent
 template <typename T>
-constexpr typename std::enable_if<!std::is_unsigned<T>::value, size_t>::type to_chars_maxsize (int base = 10) {
-    return std::ceil(std::numeric_limits<T>::digits * (std::log(2) / std::log(base)) + 1);
+constexpr typename std::enable_if<std::is_floating_point<T>::value, size_t>::type to_chars_maxsize (int = 10) {
+    return std::numeric_limits<T>::max_digits10 + 7;
 }
 
 }
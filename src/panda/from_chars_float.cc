@@ -0,0 +1,576 @@
+#include "from_chars.h"
+#include <cerrno>
+#include <cfloat>
+#include <clocale>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <initializer_list>
+
+namespace panda {
+
+/*
+ * Shortest round-trip output is Grisu3 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers"):
+ * the value and its rounding boundaries are scaled by a cached power of ten into 64-bit fixed point and digits are generated until
+ * the result is closer to the value than to any neighbour. Grisu3 knows when 64-bit precision is not enough to prove that the digits
+ * are the shortest and the closest ones (about 0.5% of doubles), then the shortest correctly rounded digits which parse back
+ * are found with printf and strtod. So digits are always the same as std::to_chars gives.
+ */
+
+namespace {
+
+struct DiyFp {
+    uint64_t f;
+    int      e;
+
+    DiyFp () : f(), e() {}
+    DiyFp (uint64_t f, int e) : f(f), e(e) {}
+
+    DiyFp operator- (const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+    DiyFp operator* (const DiyFp& rhs) const {
+        const uint64_t M32 = 0xFFFFFFFF;
+        uint64_t a = f >> 32, b = f & M32, c = rhs.f >> 32, d = rhs.f & M32;
+        uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+        uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32) + (uint64_t(1) << 31); // rounding
+        return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+    }
+
+    DiyFp normalize () const {
+        int s = __builtin_clzll(f);
+        return DiyFp(f << s, e - s);
+    }
+};
+
+template <class T> struct FloatTraits;
+
+template <> struct FloatTraits<double> {
+    using bits_t = uint64_t;
+    static constexpr const int SIGNIFICAND_SIZE = 52;
+    static constexpr const int EXPONENT_BIAS    = 1023;
+};
+
+template <> struct FloatTraits<float> {
+    using bits_t = uint32_t;
+    static constexpr const int SIGNIFICAND_SIZE = 23;
+    static constexpr const int EXPONENT_BIAS    = 127;
+};
+
+/*
+ * Normalized 64-bit significands of 10^k for k = -348, -340, ..., 340, rounded to nearest. They are computed once with 192-bit precision,
+ * which is far more than enough for correct rounding to 64 bits.
+ */
+static constexpr const int CACHED_POWERS_CNT = 87;
+static constexpr const int CACHED_POWER_MIN  = -348;
+
+struct CachedPowers {
+    uint64_t f[CACHED_POWERS_CNT];
+    int      e[CACHED_POWERS_CNT];
+
+    CachedPowers () {
+        // value = m * 2^exp, m is 192-bit number with top bit set, m[0] is the highest word
+        uint64_t m[3] = {uint64_t(1) << 63, 0, 0};
+        int exp = -191;
+        for (int k = 0; k <= 340; ++k) {
+            if ((k - CACHED_POWER_MIN) % 8 == 0) store((k - CACHED_POWER_MIN) / 8, m, exp);
+            mul10(m, exp);
+        }
+        m[0] = uint64_t(1) << 63; m[1] = m[2] = 0;
+        exp = -191;
+        for (int k = 0; k >= CACHED_POWER_MIN; --k) {
+            if ((k - CACHED_POWER_MIN) % 8 == 0) store((k - CACHED_POWER_MIN) / 8, m, exp);
+            div10(m, exp);
+        }
+    }
+
+    void store (int idx, const uint64_t* m, int exp) {
+        f[idx] = m[0];
+        e[idx] = exp + 128;
+        if (m[1] >> 63) { // round to nearest
+            if (++f[idx] == 0) {
+                f[idx] = uint64_t(1) << 63;
+                ++e[idx];
+            }
+        }
+    }
+
+    static void mul10 (uint64_t* m, int& exp) {
+        uint64_t r[4];
+        uint64_t carry = 0;
+        for (int i = 2; i >= 0; --i) {
+            uint64_t lo = m[i] & 0xFFFFFFFF, hi = m[i] >> 32;
+            uint64_t plo = lo * 10 + (carry & 0xFFFFFFFF);
+            uint64_t phi = hi * 10 + (plo >> 32) + (carry >> 32);
+            r[i+1] = (phi << 32) | (plo & 0xFFFFFFFF);
+            carry  = phi >> 32;
+        }
+        r[0] = carry; // 1..4 bits
+        int s = 64 - __builtin_clzll(r[0]);
+        m[0] = (r[0] << (64 - s)) | (r[1] >> s);
+        m[1] = (r[1] << (64 - s)) | (r[2] >> s);
+        m[2] = (r[2] << (64 - s)) | (r[3] >> s);
+        exp += s;
+    }
+
+    static void div10 (uint64_t* m, int& exp) {
+        // 256-bit (m << 64) / 10, by 32-bit digits
+        uint32_t d[8] = {
+            uint32_t(m[0] >> 32), uint32_t(m[0]), uint32_t(m[1] >> 32), uint32_t(m[1]), uint32_t(m[2] >> 32), uint32_t(m[2]), 0, 0
+        };
+        uint64_t rem = 0;
+        for (auto& x : d) {
+            uint64_t cur = (rem << 32) | x;
+            x   = uint32_t(cur / 10);
+            rem = cur % 10;
+        }
+        uint64_t q[4] = {
+            (uint64_t(d[0]) << 32) | d[1], (uint64_t(d[2]) << 32) | d[3], (uint64_t(d[4]) << 32) | d[5], (uint64_t(d[6]) << 32) | d[7]
+        };
+        int s = __builtin_clzll(q[0]); // quotient is more than 2^251, so s is 4
+        m[0] = (q[0] << s) | (q[1] >> (64 - s));
+        m[1] = (q[1] << s) | (q[2] >> (64 - s));
+        m[2] = (q[2] << s) | (q[3] >> (64 - s));
+        exp -= s; // value/10 = q * 2^(exp-64) = m * 2^(exp-s)
+    }
+};
+
+const CachedPowers& cached_powers () {
+    static const CachedPowers ret;
+    return ret;
+}
+
+// cached power c such that w.e + c.e + 64 is in [-60, -32], 10^K = 1/c
+DiyFp get_cached_power (int e, int& K) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = static_cast<int>(dk);
+    if (dk - k > 0.0) k++;
+    unsigned index = static_cast<unsigned>((k >> 3) + 1);
+    K = -(CACHED_POWER_MIN + static_cast<int>(index << 3));
+    auto& cp = cached_powers();
+    return DiyFp(cp.f[index], cp.e[index]);
+}
+
+static const uint64_t POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// moves the last digit down while it gets closer to the value, fails if the result is not surely the closest one inside the boundaries
+inline bool round_weed (char* buffer, int len, uint64_t distance_too_high_w, uint64_t unsafe_interval, uint64_t rest, uint64_t ten_kappa,
+                        uint64_t unit)
+{
+    uint64_t small_distance = distance_too_high_w - unit;
+    uint64_t big_distance   = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance))
+    {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) return false;
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+inline int count_digits (uint32_t n) {
+    int ret = 1;
+    while (n >= 10 && ret < 10) { n /= 10; ++ret; }
+    return ret;
+}
+
+// all of low, w, high have the same exponent in [-60, -32]. Boundaries are imprecise by 1 unit, which is taken into account
+bool digit_gen (const DiyFp& low, const DiyFp& w, const DiyFp& high, char* buffer, int& len, int& K) {
+    uint64_t    unit     = 1;
+    const DiyFp too_low  (low.f - unit, low.e);
+    const DiyFp too_high (high.f + unit, high.e);
+    DiyFp       unsafe_interval = too_high - too_low;
+    const DiyFp one(uint64_t(1) << -w.e, w.e);
+    uint32_t integrals   = static_cast<uint32_t>(too_high.f >> -one.e);
+    uint64_t fractionals = too_high.f & (one.f - 1);
+    int      kappa       = count_digits(integrals);
+    uint32_t divisor     = uint32_t(POW10[kappa - 1]);
+    len = 0;
+
+    while (kappa > 0) {
+        buffer[len++] = char('0' + integrals / divisor);
+        integrals %= divisor;
+        kappa--;
+        uint64_t rest = (static_cast<uint64_t>(integrals) << -one.e) + fractionals;
+        if (rest < unsafe_interval.f) {
+            K += kappa;
+            return round_weed(buffer, len, (too_high - w).f, unsafe_interval.f, rest, static_cast<uint64_t>(divisor) << -one.e, unit);
+        }
+        divisor /= 10;
+    }
+
+    for (;;) {
+        fractionals       *= 10;
+        unit              *= 10;
+        unsafe_interval.f *= 10;
+        buffer[len++] = char('0' + (fractionals >> -one.e));
+        fractionals &= one.f - 1;
+        kappa--;
+        if (fractionals < unsafe_interval.f) {
+            K += kappa;
+            return round_weed(buffer, len, (too_high - w).f * unit, unsafe_interval.f, fractionals, one.f, unit);
+        }
+    }
+}
+
+// positive finite non-zero value -> digits (without trailing zeros requirements) and K: value = digits * 10^K. False if unsure
+template <class T>
+bool grisu3 (T value, char* buffer, int& len, int& K) {
+    using FT = FloatTraits<T>;
+    typename FT::bits_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const int      ssize   = FT::SIGNIFICAND_SIZE;
+    const uint64_t hidden  = uint64_t(1) << ssize;
+    const int      biased  = int(bits >> ssize);
+    const uint64_t mantbits = uint64_t(bits) & (hidden - 1);
+
+    DiyFp v = biased ? DiyFp(mantbits + hidden, biased - FT::EXPONENT_BIAS - ssize) : DiyFp(mantbits, 1 - FT::EXPONENT_BIAS - ssize);
+
+    // boundaries are halfway to the neighbours, lower one is closer when significand is a power of two
+    DiyFp plus = DiyFp((v.f << 1) + 1, v.e - 1).normalize();
+    DiyFp minus = (v.f == hidden && biased > 1) ? DiyFp((v.f << 2) - 1, v.e - 2) : DiyFp((v.f << 1) - 1, v.e - 1);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    DiyFp c_mk = get_cached_power(plus.e, K);
+    return digit_gen(minus * c_mk, v.normalize() * c_mk, plus * c_mk, buffer, len, K);
+}
+
+inline bool parses_back (float value, const char* s)  { return strtof(s, nullptr) == value; }
+inline bool parses_back (double value, const char* s) { return strtod(s, nullptr) == value; }
+
+// closest n digits which parse back to value, if any
+template <class T>
+bool exact_digits (T value, int n, uint64_t& digits, int& K) {
+    // correctly rounded digits, the decimal point (whatever locale says) is skipped
+    char tmp[48];
+    snprintf(tmp, sizeof(tmp), "%.*e", n - 1, double(value));
+    uint64_t d = 0;
+    const char* p = tmp;
+    for (; *p != 'e'; ++p) if (*p >= '0' && *p <= '9') d = d * 10 + uint64_t(*p - '0');
+    int exp = atoi(p + 1) - (n - 1);
+
+    // they are the closest n digits, but when the lower boundary is closer (power of two) only the next ones may be inside
+    for (uint64_t c : {d, d + 1, d - 1}) {
+        if (c < POW10[n - 1] || c >= POW10[n]) continue;
+        snprintf(tmp, sizeof(tmp), "%llue%d", (unsigned long long)c, exp);
+        if (!parses_back(value, tmp)) continue;
+        digits = c;
+        K      = exp;
+        return true;
+    }
+    return false;
+}
+
+// slow exact path for values which grisu3() rejects. If n digits parse back, n+1 do too, so the length is searched by bisection
+template <class T>
+void shortest_exact (T value, char* buffer, int& len, int& K) {
+    int lo = 1, hi = std::numeric_limits<T>::max_digits10; // max_digits10 digits always parse back
+    uint64_t digits;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (exact_digits(value, mid, digits, K)) hi = mid;
+        else                                     lo = mid + 1;
+    }
+    exact_digits(value, lo, digits, K);
+    for (int i = lo - 1; i >= 0; --i, digits /= 10) buffer[i] = char('0' + digits % 10);
+    len = lo;
+}
+
+inline char* write_exponent (char* p, int exp) {
+    *p++ = 'e';
+    if (exp < 0) { *p++ = '-'; exp = -exp; }
+    else         *p++ = '+';
+    if (exp >= 100) {
+        *p++ = char('0' + exp / 100);
+        exp %= 100;
+    }
+    *p++ = char('0' + exp / 10);
+    *p++ = char('0' + exp % 10);
+    return p;
+}
+
+inline size_t exponent_size (int exp) { return (exp <= -100 || exp >= 100) ? 5 : 4; }
+
+inline to_chars_result copy_out (char* first, char* last, const char* src, size_t len) {
+    if (size_t(last - first) < len) return {last, make_error_code(std::errc::value_too_large)};
+    memcpy(first, src, len);
+    return {first + len, std::error_code()};
+}
+
+template <class T>
+to_chars_result _to_chars_shortest (char* first, char* last, T value, chars_format fmt) {
+    if (fmt == chars_format::hex) return to_chars(first, last, double(value), fmt, -1);
+
+    char  buf[32];
+    char* p = buf;
+    if (std::signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+
+    if (std::isnan(value)) {
+        memcpy(p, "nan", 3);
+        return copy_out(first, last, buf, p + 3 - buf);
+    }
+    if (std::isinf(value)) {
+        memcpy(p, "inf", 3);
+        return copy_out(first, last, buf, p + 3 - buf);
+    }
+    if (value == 0) {
+        const char* zero = fmt == chars_format::scientific ? "0e+00" : "0";
+        size_t zlen = strlen(zero);
+        memcpy(p, zero, zlen);
+        return copy_out(first, last, buf, p + zlen - buf);
+    }
+
+    char digits[20];
+    int  n, K;
+    if (!grisu3(value, digits, n, K)) shortest_exact(value, digits, n, K);
+    while (n > 1 && digits[n-1] == '0') { --n; ++K; }
+    int  X = n - 1 + K; // decimal exponent in scientific notation
+    auto sign = p - buf;
+
+    size_t sci_len   = n + (n > 1) + exponent_size(X);
+    size_t fixed_len = K >= 0 ? n + K : (n + K > 0 ? n + 1 : 2 + (-K - n) + n);
+    bool   fixed     = fmt == chars_format::fixed || (fmt == chars_format::general && fixed_len <= sci_len);
+
+    if (!fixed) {
+        *p++ = digits[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, n - 1);
+            p += n - 1;
+        }
+        p = write_exponent(p, X);
+        return copy_out(first, last, buf, p - buf);
+    }
+
+    // fixed may be as long as 300+ chars, write it directly
+    if (size_t(last - first) < sign + fixed_len) return {last, make_error_code(std::errc::value_too_large)};
+    char* d = first;
+    if (sign) *d++ = '-';
+    if (K >= 0) {
+        memcpy(d, digits, n);
+        d += n;
+        memset(d, '0', K);
+        d += K;
+    } else if (n + K > 0) {
+        memcpy(d, digits, n + K);
+        d += n + K;
+        *d++ = '.';
+        memcpy(d, digits + n + K, -K);
+        d += -K;
+    } else {
+        *d++ = '0';
+        *d++ = '.';
+        memset(d, '0', -K - n);
+        d += -K - n;
+        memcpy(d, digits, n);
+        d += n;
+    }
+    return {d, std::error_code()};
+}
+
+inline char decimal_point () { return *localeconv()->decimal_point; }
+
+to_chars_result _to_chars_precision (char* first, char* last, double value, chars_format fmt, int precision) {
+    const char* spec;
+    switch (fmt) {
+        case chars_format::fixed:      spec = "%.*f"; break;
+        case chars_format::scientific: spec = "%.*e"; break;
+        case chars_format::hex:        spec = precision < 0 ? "%a" : "%.*a"; break;
+        default:                       spec = "%.*g"; break;
+    }
+
+    char stackbuf[128];
+    std::string heapbuf;
+    char* buf = stackbuf;
+    int len = precision < 0 ? snprintf(buf, sizeof(stackbuf), spec, value) : snprintf(buf, sizeof(stackbuf), spec, precision, value);
+    if (len >= (int)sizeof(stackbuf)) {
+        heapbuf.resize(len + 1);
+        buf = &heapbuf[0];
+        precision < 0 ? snprintf(buf, len + 1, spec, value) : snprintf(buf, len + 1, spec, precision, value);
+    }
+
+    char* src = buf;
+    if (fmt == chars_format::hex) { // std::to_chars doesn't write "0x" prefix
+        char* x = src + (*src == '-');
+        if (x[0] == '0' && (x[1] == 'x' || x[1] == 'X')) {
+            memmove(x, x + 2, len - (x - src) - 2);
+            len -= 2;
+        }
+    }
+
+    char dp = decimal_point();
+    if (dp != '.') for (int i = 0; i < len; ++i) if (src[i] == dp) src[i] = '.';
+
+    return copy_out(first, last, src, len);
+}
+
+// the same set as isspace() in "C" locale, like integer parsing uses
+inline bool is_space (unsigned char ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
+
+inline bool match_ci (const char*& ptr, const char* end, const char* word) {
+    auto p = ptr;
+    for (; *word; ++word, ++p) if (p == end || (*p | 0x20) != *word) return false;
+    ptr = p;
+    return true;
+}
+
+template <class T> inline T      str_to (const char* s, char** end);
+template <>        inline float  str_to (const char* s, char** end) { return strtof(s, end); }
+template <>        inline double str_to (const char* s, char** end) { return strtod(s, end); }
+
+template <class T> struct FastPath;
+
+// values which are exact in T are multiplied/divided by exact powers of ten, that gives correctly rounded result (Clinger)
+template <> struct FastPath<double> {
+    static constexpr const uint64_t MAX_MANTISSA = uint64_t(1) << 53;
+    static constexpr const int      MAX_EXP      = 22;
+    static double pow10 (int e) {
+        static const double p[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        return p[e];
+    }
+};
+
+template <> struct FastPath<float> {
+    static constexpr const uint64_t MAX_MANTISSA = uint64_t(1) << 24;
+    static constexpr const int      MAX_EXP      = 10;
+    static float pow10 (int e) {
+        static const float p[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+        return p[e];
+    }
+};
+
+template <class T>
+from_chars_result _from_chars_float (const char* first, const char* last, T& value, chars_format fmt) {
+    auto ptr = first;
+    while (ptr != last && is_space(*ptr)) ++ptr;
+    auto num = ptr;
+
+    bool minus = ptr != last && *ptr == '-';
+    if (minus) ++ptr;
+
+    if (ptr != last && ((*ptr | 0x20) == 'i' || (*ptr | 0x20) == 'n')) {
+        if (match_ci(ptr, last, "inf")) {
+            match_ci(ptr, last, "inity");
+            value = minus ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+            return {ptr, std::error_code()};
+        }
+        if (match_ci(ptr, last, "nan")) {
+            if (ptr != last && *ptr == '(') { // nan(n-char-sequence)
+                auto p = ptr + 1;
+                while (p != last && (isalnum((unsigned char)*p) || *p == '_')) ++p;
+                if (p != last && *p == ')') ptr = p + 1;
+            }
+            value = minus ? -std::numeric_limits<T>::quiet_NaN() : std::numeric_limits<T>::quiet_NaN();
+            return {ptr, std::error_code()};
+        }
+        return {first, make_error_code(std::errc::invalid_argument)};
+    }
+
+    bool hex = fmt == chars_format::hex;
+    auto is_digit = [hex](char c) { return hex ? isxdigit((unsigned char)c) : (c >= '0' && c <= '9'); };
+
+    uint64_t mant      = 0;
+    int      ndigits   = 0; // significant digits in mant
+    int      exp10     = 0;
+    bool     truncated = false;
+    bool     any       = false;
+
+    auto digit = [&](char c, bool frac) {
+        any = true;
+        if (hex) return;
+        unsigned d = c - '0';
+        if (mant == 0 && d == 0) { // leading zero
+            if (frac) --exp10;
+            return;
+        }
+        if (ndigits < 19) {
+            mant = mant * 10 + d;
+            ++ndigits;
+            if (frac) --exp10;
+        } else {
+            if (!frac) ++exp10;
+            if (d) truncated = true;
+        }
+    };
+
+    for (; ptr != last && is_digit(*ptr); ++ptr) digit(*ptr, false);
+    if (ptr != last && *ptr == '.') {
+        auto p = ptr + 1;
+        for (; p != last && is_digit(*p); ++p) digit(*p, true);
+        if (any) ptr = p;
+    }
+    if (!any) return {first, make_error_code(std::errc::invalid_argument)};
+
+    bool has_exp = false;
+    char exp_char = hex ? 'p' : 'e';
+    if (fmt != chars_format::fixed && ptr != last && (*ptr | 0x20) == exp_char) {
+        auto p = ptr + 1;
+        bool eminus = false;
+        if (p != last && (*p == '-' || *p == '+')) eminus = *p++ == '-';
+        if (p != last && *p >= '0' && *p <= '9') {
+            int e = 0;
+            for (; p != last && *p >= '0' && *p <= '9'; ++p) if (e < 100000) e = e * 10 + (*p - '0');
+            exp10 += eminus ? -e : e;
+            has_exp = true;
+            ptr = p;
+        }
+    }
+    if (fmt == chars_format::scientific && !has_exp) return {first, make_error_code(std::errc::invalid_argument)};
+
+    using FP = FastPath<T>;
+    if (!hex && !truncated && mant <= FP::MAX_MANTISSA && exp10 >= -FP::MAX_EXP && exp10 <= FP::MAX_EXP && FLT_EVAL_METHOD == 0) {
+        T res = T(mant);
+        if (exp10 < 0) res /= FP::pow10(-exp10);
+        else           res *= FP::pow10(exp10);
+        value = minus ? -res : res;
+        return {ptr, std::error_code()};
+    }
+    if (!hex && mant == 0) {
+        value = minus ? -T(0) : T(0);
+        return {ptr, std::error_code()};
+    }
+
+    // slow path: libc does correct rounding for any number of digits
+    std::string tmp;
+    tmp.reserve(ptr - num + 2);
+    if (minus) tmp += '-';
+    if (hex) tmp += "0x";
+    tmp.append(num + minus, ptr);
+    char dp = decimal_point();
+    if (dp != '.') for (auto& c : tmp) if (c == '.') c = dp;
+
+    errno = 0;
+    T res = str_to<T>(tmp.c_str(), nullptr);
+    if (errno == ERANGE && (std::isinf(res) || res == 0)) return {ptr, make_error_code(std::errc::result_out_of_range)};
+    value = res;
+    return {ptr, std::error_code()};
+}
+
+}
+
+from_chars_result from_chars (const char* first, const char* last, float&  value, chars_format fmt) { return _from_chars_float(first, last, value, fmt); }
+from_chars_result from_chars (const char* first, const char* last, double& value, chars_format fmt) { return _from_chars_float(first, last, value, fmt); }
+
+to_chars_result to_chars (char* first, char* last, float  value, chars_format fmt) { return _to_chars_shortest(first, last, value, fmt); }
+to_chars_result to_chars (char* first, char* last, double value, chars_format fmt) { return _to_chars_shortest(first, last, value, fmt); }
+
+to_chars_result to_chars (char* first, char* last, float value, chars_format fmt, int precision) {
+    return _to_chars_precision(first, last, value, fmt, precision);
+}
+
+to_chars_result to_chars (char* first, char* last, double value, chars_format fmt, int precision) {
+    return _to_chars_precision(first, last, value, fmt, precision);
+}
+
+}
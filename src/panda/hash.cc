@@ -1,7 +1,15 @@
 #include "hash.h"
 #include <new>
+#include <algorithm>
+#include <random>
 #include <stdlib.h>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define PANDA_HASH_X86 1
+#  include <immintrin.h>
+#  define PANDA_TARGET(isa) __attribute__((target(isa)))
+#endif
+
 namespace panda { namespace hash {
 
 uint64_t hash_murmur64a_misaligned (string_view str) {
@@ -102,4 +110,343 @@ uint32_t hash_jenkins_one_at_a_time (string_view str) {
     return hash;
 }
 
+namespace {
+
+using xxh3::Acc;
+using xxh3::STRIPE_LEN;
+using xxh3::BLOCK_LEN;
+using xxh3::STRIPES_PER_BLOCK;
+using xxh3::SECRET_SIZE;
+using xxh3::SECRET_CONSUME_RATE;
+using xxh3::SECRET_LASTACC;
+
+/*
+ * Kernels consume whole stripes, which must be followed by more data, `block_pos` is the number of stripe in current block, block is
+ * finished by scrambling accumulators. The last stripe of input (overlapping with previous ones) is processed with its own secret
+ * offset if `last` is given. Accumulators stay in registers during a call.
+ */
+void scalar_consume (Acc& acc, const char* p, size_t stripes, const unsigned char* s, size_t& block_pos, const char* last) {
+    size_t pos = block_pos; // local copy, may be aliased by char pointers
+    while (stripes) {
+        size_t n = std::min(stripes, STRIPES_PER_BLOCK - pos);
+        xxh3::accumulate(acc, p, s + pos*SECRET_CONSUME_RATE, n);
+        p += n*STRIPE_LEN;
+        stripes -= n;
+        pos += n;
+        if (pos == STRIPES_PER_BLOCK) {
+            xxh3::scramble(acc, s + SECRET_SIZE - STRIPE_LEN);
+            pos = 0;
+        }
+    }
+    block_pos = pos;
+    if (last) xxh3::accumulate512(acc, last, s + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC);
+}
+
+#ifdef PANDA_HASH_X86
+
+/* SSE2 */
+
+PANDA_TARGET("sse2")
+inline void sse_accumulate512 (__m128i* acc, const char* p, const unsigned char* s) {
+    for (int i = 0; i < 4; ++i) {
+        __m128i data = _mm_loadu_si128((const __m128i*)p + i);
+        __m128i key  = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)s + i));
+        __m128i prod = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+        acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(prod, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+}
+
+PANDA_TARGET("sse2")
+inline void sse_scramble (__m128i* acc, const unsigned char* s) {
+    const __m128i prime = _mm_set1_epi32((int)xxh3::PRIME32_1);
+    for (int i = 0; i < 4; ++i) {
+        __m128i a  = _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47));
+        a          = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)s + i));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        acc[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+    }
+}
+
+PANDA_TARGET("sse2")
+void sse_consume (Acc& res, const char* p, size_t stripes, const unsigned char* s, size_t& block_pos, const char* last) {
+    __m128i acc[4];
+    for (int i = 0; i < 4; ++i) acc[i] = _mm_loadu_si128((const __m128i*)res.v + i);
+
+    size_t pos = block_pos; // local copy, may be aliased by char pointers
+    if (pos) {
+        size_t cnt = std::min(stripes, STRIPES_PER_BLOCK - pos);
+        for (size_t i = 0; i < cnt; ++i) sse_accumulate512(acc, p + i*STRIPE_LEN, s + (pos + i)*SECRET_CONSUME_RATE);
+        p       += cnt*STRIPE_LEN;
+        stripes -= cnt;
+        pos     += cnt;
+        if (pos == STRIPES_PER_BLOCK) {
+            sse_scramble(acc, s + SECRET_SIZE - STRIPE_LEN);
+            pos = 0;
+        }
+    }
+    for (; stripes >= STRIPES_PER_BLOCK; stripes -= STRIPES_PER_BLOCK, p += BLOCK_LEN) {
+        for (size_t i = 0; i < STRIPES_PER_BLOCK; ++i) sse_accumulate512(acc, p + i*STRIPE_LEN, s + i*SECRET_CONSUME_RATE);
+        sse_scramble(acc, s + SECRET_SIZE - STRIPE_LEN);
+    }
+    for (size_t i = 0; i < stripes; ++i) sse_accumulate512(acc, p + i*STRIPE_LEN, s + (pos + i)*SECRET_CONSUME_RATE);
+    block_pos = pos + stripes;
+
+    if (last) sse_accumulate512(acc, last, s + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC);
+    for (int i = 0; i < 4; ++i) _mm_storeu_si128((__m128i*)res.v + i, acc[i]);
+}
+
+/* AVX2 */
+
+PANDA_TARGET("avx2")
+inline void avx2_accumulate512 (__m256i* acc, const char* p, const unsigned char* s) {
+    for (int i = 0; i < 2; ++i) {
+        __m256i data = _mm256_loadu_si256((const __m256i*)p + i);
+        __m256i key  = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)s + i));
+        __m256i prod = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+        acc[i] = _mm256_add_epi64(acc[i], _mm256_add_epi64(prod, _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+}
+
+PANDA_TARGET("avx2")
+inline void avx2_scramble (__m256i* acc, const unsigned char* s) {
+    const __m256i prime = _mm256_set1_epi32((int)xxh3::PRIME32_1);
+    for (int i = 0; i < 2; ++i) {
+        __m256i a  = _mm256_xor_si256(acc[i], _mm256_srli_epi64(acc[i], 47));
+        a          = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*)s + i));
+        __m256i lo = _mm256_mul_epu32(a, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        acc[i] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+    }
+}
+
+PANDA_TARGET("avx2")
+void avx2_consume (Acc& res, const char* p, size_t stripes, const unsigned char* s, size_t& block_pos, const char* last) {
+    __m256i acc[2];
+    for (int i = 0; i < 2; ++i) acc[i] = _mm256_loadu_si256((const __m256i*)res.v + i);
+
+    size_t pos = block_pos; // local copy, may be aliased by char pointers
+    if (pos) {
+        size_t cnt = std::min(stripes, STRIPES_PER_BLOCK - pos);
+        for (size_t i = 0; i < cnt; ++i) avx2_accumulate512(acc, p + i*STRIPE_LEN, s + (pos + i)*SECRET_CONSUME_RATE);
+        p       += cnt*STRIPE_LEN;
+        stripes -= cnt;
+        pos     += cnt;
+        if (pos == STRIPES_PER_BLOCK) {
+            avx2_scramble(acc, s + SECRET_SIZE - STRIPE_LEN);
+            pos = 0;
+        }
+    }
+    for (; stripes >= STRIPES_PER_BLOCK; stripes -= STRIPES_PER_BLOCK, p += BLOCK_LEN) {
+        for (size_t i = 0; i < STRIPES_PER_BLOCK; ++i) avx2_accumulate512(acc, p + i*STRIPE_LEN, s + i*SECRET_CONSUME_RATE);
+        avx2_scramble(acc, s + SECRET_SIZE - STRIPE_LEN);
+    }
+    for (size_t i = 0; i < stripes; ++i) avx2_accumulate512(acc, p + i*STRIPE_LEN, s + (pos + i)*SECRET_CONSUME_RATE);
+    block_pos = pos + stripes;
+
+    if (last) avx2_accumulate512(acc, last, s + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC);
+    for (int i = 0; i < 2; ++i) _mm256_storeu_si256((__m256i*)res.v + i, acc[i]);
+}
+
+#endif
+
+struct Kernels {
+    Level level;
+    void (*consume) (Acc&, const char*, size_t, const unsigned char*, size_t&, const char*);
+};
+
+Kernels make_kernels (Level level) {
+    if (level > max_level()) level = max_level();
+    switch (level) {
+        #ifdef PANDA_HASH_X86
+        case Level::AVX2: return {level, avx2_consume};
+        case Level::SSE2: return {level, sse_consume};
+        #endif
+        default: return {Level::SCALAR, scalar_consume};
+    }
+}
+
+Kernels& kernels () {
+    static Kernels ret = make_kernels(max_level());
+    return ret;
+}
+
+// seeded long inputs use secret derived from default one
+void make_secret (unsigned char* secret, uint64_t seed) {
+    for (size_t i = 0; i < SECRET_SIZE; i += 16) {
+        uint64_t lo = xxh3::read64(xxh3::default_secret + i) + seed;
+        uint64_t hi = xxh3::read64(xxh3::default_secret + i + 8) - seed;
+        for (int j = 0; j < 8; ++j) {
+            secret[i + j]     = (unsigned char)(lo >> (j*8));
+            secret[i + 8 + j] = (unsigned char)(hi >> (j*8));
+        }
+    }
+}
+
+Acc long_acc (const char* p, size_t len, const unsigned char* s) {
+    Acc acc = xxh3::init_acc();
+    size_t pos = 0;
+    kernels().consume(acc, p, (len - 1) / STRIPE_LEN, s, pos, p + len - STRIPE_LEN);
+    return acc;
+}
+
+}
+
+Level level () { return kernels().level; }
+
+Level max_level () {
+    #ifdef PANDA_HASH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+    #endif
+    return Level::SCALAR;
+}
+
+void set_level (Level level) { kernels() = make_kernels(level); }
+
+uint64_t xxh3::long64 (const char* p, size_t len, uint64_t seed) {
+    if (!seed) return hash64_long(long_acc(p, len, default_secret), len, default_secret);
+    unsigned char secret[SECRET_SIZE];
+    make_secret(secret, seed);
+    return hash64_long(long_acc(p, len, secret), len, secret);
+}
+
+uint128 xxh3::long128 (const char* p, size_t len, uint64_t seed) {
+    if (!seed) return hash128_long(long_acc(p, len, default_secret), len, default_secret);
+    unsigned char secret[SECRET_SIZE];
+    make_secret(secret, seed);
+    return hash128_long(long_acc(p, len, secret), len, secret);
+}
+
+hasher::hasher (uint64_t seed) : _seed(seed) {
+    make_secret(_secret, seed);
+    reset();
+}
+
+void hasher::reset () {
+    _acc      = xxh3::init_acc();
+    _pos      = 0;
+    _length   = 0;
+    _buffered = 0;
+}
+
+void hasher::_consume (const char* p, size_t stripes) {
+    kernels().consume(_acc, p, stripes, _secret, _pos, nullptr);
+    memcpy(_buf, p + (stripes - 1) * STRIPE_LEN, STRIPE_LEN);
+}
+
+hasher& hasher::update (string_view data) {
+    auto p   = data.data();
+    auto len = data.length();
+    auto buf = _buf + STRIPE_LEN;
+    _length += len;
+
+    if (_buffered + len <= BUFFER_SIZE) {
+        memcpy(buf + _buffered, p, len);
+        _buffered += len;
+        return *this;
+    }
+
+    // stripes are consumed only when something follows them
+    if (_buffered) {
+        size_t fill = BUFFER_SIZE - _buffered;
+        memcpy(buf + _buffered, p, fill);
+        p   += fill;
+        len -= fill;
+        _consume(buf, BUFFER_SIZE / STRIPE_LEN);
+    }
+    if (len > BUFFER_SIZE) {
+        size_t stripes = (len - 1) / STRIPE_LEN;
+        _consume(p, stripes);
+        p   += stripes * STRIPE_LEN;
+        len -= stripes * STRIPE_LEN;
+    }
+    memcpy(buf, p, len);
+    _buffered = len;
+    return *this;
+}
+
+// for long inputs the last stripe may start in the previous consumed one, which is kept in the beginning of _buf
+xxh3::Acc hasher::_final_acc () const {
+    Acc  acc = _acc;
+    auto pos = _pos;
+    auto end = _buf + STRIPE_LEN + _buffered;
+    kernels().consume(acc, _buf + STRIPE_LEN, (_buffered - 1) / STRIPE_LEN, _secret, pos, end - STRIPE_LEN);
+    return acc;
+}
+
+uint64_t hasher::finalize () const {
+    if (_length <= xxh3::MID_SIZE_MAX) return xxh3::hash64_short(_buf + STRIPE_LEN, _length, _seed);
+    return xxh3::hash64_long(_final_acc(), _length, _secret);
+}
+
+uint128 hasher::finalize128 () const {
+    if (_length <= xxh3::MID_SIZE_MAX) return xxh3::hash128_short(_buf + STRIPE_LEN, _length, _seed);
+    return xxh3::hash128_long(_final_acc(), _length, _secret);
+}
+
+namespace {
+
+inline uint64_t rotl (uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+struct SipState {
+    uint64_t v0, v1, v2, v3;
+
+    SipState (const uint128& key) :
+        v0(0x736f6d6570736575ULL ^ key.low), v1(0x646f72616e646f6dULL ^ key.high),
+        v2(0x6c7967656e657261ULL ^ key.low), v3(0x7465646279746573ULL ^ key.high) {}
+
+    void round () {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+};
+
+template <int C, int D>
+uint64_t siphash (string_view str, const uint128& key) {
+    SipState s(key);
+    auto p   = str.data();
+    auto len = str.length();
+    for (auto end = p + (len & ~size_t(7)); p != end; p += 8) {
+        uint64_t m = xxh3::read64(p);
+        s.v3 ^= m;
+        for (int i = 0; i < C; ++i) s.round();
+        s.v0 ^= m;
+    }
+
+    uint64_t b = uint64_t(len) << 56;
+    for (size_t i = 0; i < (len & 7); ++i) b |= uint64_t((unsigned char)p[i]) << (i*8);
+    s.v3 ^= b;
+    for (int i = 0; i < C; ++i) s.round();
+    s.v0 ^= b;
+
+    s.v2 ^= 0xff;
+    for (int i = 0; i < D; ++i) s.round();
+    return s.v0 ^ s.v1 ^ s.v2 ^ s.v3;
+}
+
+}
+
+uint64_t hash_siphash13 (string_view str, const uint128& key) { return siphash<1,3>(str, key); }
+uint64_t hash_siphash24 (string_view str, const uint128& key) { return siphash<2,4>(str, key); }
+
+uint64_t _seed = 0;
+
+uint64_t random_seed () {
+    std::random_device rd;
+    return (uint64_t(rd()) << 32) ^ rd();
+}
+
+void set_seed (uint64_t seed) { _seed = seed; }
+
+#if defined(PANDA_HASH_RANDOM_SEED) && defined(__GNUC__)
+// before any other static initializers, containers may be filled by them
+static struct SeedInit { SeedInit () { _seed = random_seed(); } } _seed_init __attribute__((init_priority(101)));
+#elif defined(PANDA_HASH_RANDOM_SEED)
+static struct SeedInit { SeedInit () { _seed = random_seed(); } } _seed_init;
+#endif
+
 }}
@@ -2,7 +2,9 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+#include <type_traits>
 #include "string_view/defs.h"
+#include "hash/xxh3.h"
 
 namespace panda { namespace hash {
 
@@ -10,8 +12,49 @@ uint64_t hash_murmur64a             (string_view);
 uint64_t hash_murmur64a_misaligned  (string_view);
 uint32_t hash_jenkins_one_at_a_time (string_view);
 
-inline uint64_t hash64 (string_view v) { return hash_murmur64a_misaligned(v); }
-inline uint32_t hash32 (string_view v) { return hash_jenkins_one_at_a_time(v); }
+namespace xxh3 {
+    uint64_t long64  (const char*, size_t, uint64_t seed);
+    uint128  long128 (const char*, size_t, uint64_t seed);
+}
+
+// XXH3 (compatible with xxHash 0.8), short inputs are inlined, long ones are processed by SSE2/AVX2 code chosen by CPU features
+inline uint64_t hash_xxh3_64 (string_view v, uint64_t seed = 0) {
+    return v.length() <= xxh3::MID_SIZE_MAX ? xxh3::hash64_short(v.data(), v.length(), seed) : xxh3::long64(v.data(), v.length(), seed);
+}
+
+inline uint128 hash_xxh3_128 (string_view v, uint64_t seed = 0) {
+    return v.length() <= xxh3::MID_SIZE_MAX ? xxh3::hash128_short(v.data(), v.length(), seed) : xxh3::long128(v.data(), v.length(), seed);
+}
+
+// vector code in use for long inputs, set_level() is for tests and benchmarks, not thread-safe
+enum class Level { SCALAR, SSE2, AVX2 };
+Level level     ();
+Level max_level ();
+void  set_level (Level);
+
+// SipHash with 128 bit key, slower than XXH3 but is a PRF, so that collisions can't be found without knowing the key
+uint64_t hash_siphash13 (string_view, const uint128& key);
+uint64_t hash_siphash24 (string_view, const uint128& key);
+
+/*
+ * Seed of default hashes below. It is 0 unless library is built with PANDA_HASH_RANDOM_SEED, so that hashes are the same in every run
+ * and compile-time chashXX() and "key"_h match them (with PANDA_HASH_RANDOM_SEED they don't compile, see below). Anyone who can choose keys of a container (HTTP headers, JSON keys) can make them
+ * collide with a known seed, so services hashing keys from network should call set_seed(random_seed()) at startup before any hashed
+ * container is filled (changing seed makes existing containers unusable), or use containers with seeded_hasher/sip_hasher below.
+ */
+extern uint64_t _seed;
+
+uint64_t random_seed ();
+inline uint64_t seed () { return _seed; }
+void set_seed (uint64_t);
+
+/*
+ * Default hashes (std::hash for strings, unordered_string_map, etc). Values are not stable between library versions, store
+ * results of named functions if needed. 32 bit hash is the lower half of 64 bit one, like XXH3 recommends.
+ */
+inline uint64_t hash64  (string_view v) { return hash_xxh3_64(v, _seed); }
+inline uint32_t hash32  (string_view v) { return uint32_t(hash_xxh3_64(v, _seed)); }
+inline uint128  hash128 (string_view v) { return hash_xxh3_128(v, _seed); }
 
 namespace {
     template <int T> struct _hashXX;
@@ -23,7 +66,119 @@ template <typename T = size_t> inline T hashXX (string_view);
 template <> inline unsigned           hashXX<unsigned>           (string_view v) { return _hashXX<sizeof(unsigned)>()(v); }
 template <> inline unsigned long      hashXX<unsigned long>      (string_view v) { return _hashXX<sizeof(unsigned long)>()(v); }
 template <> inline unsigned long long hashXX<unsigned long long> (string_view v) { return _hashXX<sizeof(unsigned long long)>()(v); }
+template <> inline uint128            hashXX<uint128>            (string_view v) { return hash128(v); }
+
+namespace {
+    template <class S> string_view _bytes (const S& s) { return string_view((const char*)s.data(), s.length() * sizeof(*s.data())); }
+}
+
+// the same as std::hash for panda strings and views, but accepts all of them, so that lookups may be done without making a key
+struct default_hasher {
+    template <class S> size_t operator() (const S& s) const { return hashXX<size_t>(_bytes(s)); }
+};
+
+/*
+ * Hashers for unordered containers of strings or string views with their own seed or key, random by default, so that keys colliding
+ * in one container (or process) don't collide in another, e.g. unordered_string_map<string, T, hash::seeded_hasher>.
+ * find_hashed() must be given hash_function()(key) for such containers.
+ */
+struct seeded_hasher {
+    seeded_hasher () : _seed(random_seed()) {}
+    explicit seeded_hasher (uint64_t seed) : _seed(seed) {}
+
+    template <class S> size_t operator() (const S& s) const { return size_t(hash_xxh3_64(_bytes(s), _seed)); }
+
+private:
+    uint64_t _seed;
+};
+
+struct sip_hasher {
+    sip_hasher () : _key{random_seed(), random_seed()} {}
+    explicit sip_hasher (const uint128& key) : _key(key) {}
+
+    template <class S> size_t operator() (const S& s) const { return size_t(hash_siphash13(_bytes(s), _key)); }
+
+private:
+    uint128 _key;
+};
 
-}}
+/*
+ * Incremental hashing of data coming by pieces without concatenating them: finalize() and finalize128() give the same result as
+ * hash64()/hash128() (or hash_xxh3_64/128 with given seed) of concatenation of all pieces passed to update() since construction or reset().
+ * More data may be added after finalize().
+ */
+struct hasher {
+    hasher () : hasher(seed()) {}
+    explicit hasher (uint64_t seed);
+
+    hasher& update (string_view);
+
+    uint64_t finalize    () const;
+    uint128  finalize128 () const;
+    uint64_t length      () const { return _length; }
+
+    void reset ();
+
+private:
+    static constexpr size_t BUFFER_SIZE = 256; // must be more than xxh3::MID_SIZE_MAX, so that short inputs are hashed at once
+
+    xxh3::Acc     _acc;
+    size_t        _pos; // stripe in current block
+    uint64_t      _length;
+    size_t        _buffered;
+    uint64_t      _seed;
+    unsigned char _secret[xxh3::SECRET_SIZE];
+    char          _buf[xxh3::STRIPE_LEN + BUFFER_SIZE]; // last consumed stripe + buffered data
+
+    void      _consume   (const char*, size_t stripes);
+    xxh3::Acc _final_acc () const;
+};
+
+// hashes of concatenation of strings from range (anything iterable with elements having data() and length())
+template <class Range>
+uint64_t hash64_range (const Range& range) {
+    hasher h;
+    for (const auto& s : range) h.update(_bytes(s));
+    return h.finalize();
+}
+
+template <class Range>
+uint128 hash128_range (const Range& range) {
+    hasher h;
+    for (const auto& s : range) h.update(_bytes(s));
+    return h.finalize128();
+}
+
+/*
+ * Compile-time versions of hash64/hash32/hash128/hashXX giving the same values while seed() is 0, so that hashes of fixed keys may be computed once by
+ * compiler, e.g. for unordered_string_map::find_hashed(). They are much slower than runtime ones, don't use them for runtime data.
+ */
+constexpr uint64_t chash64  (string_view v) { return xxh3::hash64(v.data(), v.length()); }
+constexpr uint32_t chash32  (string_view v) { return uint32_t(xxh3::hash64(v.data(), v.length())); }
+constexpr uint128  chash128 (string_view v) { return xxh3::hash128(v.data(), v.length()); }
+
+template <typename T = size_t>
+constexpr T chashXX (string_view v) {
+    static_assert(std::is_unsigned<T>::value && (sizeof(T) == 4 || sizeof(T) == 8), "hash type must be 32 or 64 bit unsigned");
+#ifdef PANDA_HASH_RANDOM_SEED
+    // default hashes are seeded at startup, a compile-time value would silently miss in find_hashed()
+    static_assert(sizeof(T) == 0, "chashXX() can't match default hashes with PANDA_HASH_RANDOM_SEED, use hashXX() at runtime");
+#endif
+    return sizeof(T) == 8 ? T(chash64(v)) : T(chash32(v));
+}
+
+}
+
+inline namespace literals {
+#ifdef PANDA_HASH_RANDOM_SEED
+    // default hashes are seeded at startup, so there is no compile-time equivalent, use hash::hashXX() at runtime
+    constexpr size_t operator"" _h (const char*, size_t) = delete;
+#else
+    // "key"_h == std::hash<panda::string>()("key") while hash::seed() is 0
+    constexpr size_t operator"" _h (const char* s, size_t len) { return hash::chashXX<size_t>(string_view(s, len)); }
+#endif
+}
+
+}
 
 #include "string_view.h"
@@ -0,0 +1,319 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace panda { namespace hash {
+
+struct uint128 {
+    uint64_t low;
+    uint64_t high;
+
+    constexpr bool operator== (const uint128& oth) const { return low == oth.low && high == oth.high; }
+    constexpr bool operator!= (const uint128& oth) const { return !operator==(oth); }
+};
+
+/*
+ * XXH3 (xxHash 0.8) 64 and 128 bit, results are identical to reference implementation.
+ * Everything here is constexpr so that the same code serves compile-time hashing and short inputs at runtime (byte-by-byte reads are
+ * merged into plain loads by optimizer). Inputs longer than MID_SIZE_MAX are hashed at runtime by vector kernels in hash.cc.
+ */
+namespace xxh3 {
+
+constexpr uint64_t PRIME32_1 = 0x9E3779B1U;
+constexpr uint64_t PRIME32_2 = 0x85EBCA77U;
+constexpr uint64_t PRIME32_3 = 0xC2B2AE3DU;
+constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+constexpr uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+constexpr uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+constexpr size_t STRIPE_LEN          = 64;
+constexpr size_t ACC_NB              = 8;
+constexpr size_t SECRET_SIZE         = 192;
+constexpr size_t SECRET_CONSUME_RATE = 8;
+constexpr size_t SECRET_MERGEACCS    = 11;
+constexpr size_t SECRET_LASTACC      = 7;
+constexpr size_t SECRET_SIZE_MIN     = 136;
+constexpr size_t MID_SIZE_MAX        = 240;
+constexpr size_t STRIPES_PER_BLOCK   = (SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE;
+constexpr size_t BLOCK_LEN           = STRIPE_LEN * STRIPES_PER_BLOCK;
+
+constexpr unsigned char default_secret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// little-endian reads, C is char or unsigned char
+template <class C> constexpr uint32_t read32 (const C* p) {
+    return uint32_t((unsigned char)p[0]) | uint32_t((unsigned char)p[1]) << 8 | uint32_t((unsigned char)p[2]) << 16 |
+           uint32_t((unsigned char)p[3]) << 24;
+}
+
+template <class C> constexpr uint64_t read64 (const C* p) { return uint64_t(read32(p)) | uint64_t(read32(p + 4)) << 32; }
+
+constexpr uint64_t swap64 (uint64_t x) {
+    return (x << 56) | ((x << 40) & 0x00ff000000000000ULL) | ((x << 24) & 0x0000ff0000000000ULL) | ((x << 8) & 0x000000ff00000000ULL) |
+           ((x >> 8) & 0x00000000ff000000ULL) | ((x >> 24) & 0x0000000000ff0000ULL) | ((x >> 40) & 0x000000000000ff00ULL) | (x >> 56);
+}
+
+constexpr uint32_t swap32 (uint32_t x) { return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | (x >> 24); }
+constexpr uint32_t rotl32 (uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+constexpr uint64_t rotl64 (uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+constexpr uint128 mul128 (uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    return {uint64_t(u128(a) * b), uint64_t((u128(a) * b) >> 64)};
+#else
+    uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+    uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+    uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+    uint64_t hi_hi = (a >> 32) * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    return {(cross << 32) | (lo_lo & 0xffffffff), (hi_lo >> 32) + (cross >> 32) + hi_hi};
+#endif
+}
+
+constexpr uint64_t fold64 (uint64_t a, uint64_t b) { return mul128(a, b).low ^ mul128(a, b).high; }
+
+constexpr uint64_t xxh64_avalanche (uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+constexpr uint64_t avalanche (uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+constexpr uint64_t rrmxmx (uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+constexpr uint64_t mix16 (const char* p, const unsigned char* s, uint64_t seed) {
+    return fold64(read64(p) ^ (read64(s) + seed), read64(p + 8) ^ (read64(s + 8) - seed));
+}
+
+constexpr uint128 mix32 (uint128 acc, const char* p1, const char* p2, const unsigned char* s, uint64_t seed) {
+    acc.low  += mix16(p1, s, seed);
+    acc.low  ^= read64(p2) + read64(p2 + 8);
+    acc.high += mix16(p2, s + 16, seed);
+    acc.high ^= read64(p1) + read64(p1 + 8);
+    return acc;
+}
+
+/* 64 bit */
+
+constexpr uint64_t hash64_0to16 (const char* p, size_t len, const unsigned char* s, uint64_t seed) {
+    if (len > 8) {
+        uint64_t lo  = read64(p) ^ ((read64(s + 24) ^ read64(s + 32)) + seed);
+        uint64_t hi  = read64(p + len - 8) ^ ((read64(s + 40) ^ read64(s + 48)) - seed);
+        return avalanche(len + swap64(lo) + hi + fold64(lo, hi));
+    }
+    if (len >= 4) {
+        seed ^= uint64_t(swap32(uint32_t(seed))) << 32;
+        uint64_t v = read32(p + len - 4) + (uint64_t(read32(p)) << 32);
+        return rrmxmx(v ^ ((read64(s + 8) ^ read64(s + 16)) - seed), len);
+    }
+    if (len) {
+        uint32_t combined = uint32_t((unsigned char)p[0]) << 16 | uint32_t((unsigned char)p[len >> 1]) << 24 |
+                            uint32_t((unsigned char)p[len - 1]) | uint32_t(len) << 8;
+        return xxh64_avalanche(combined ^ ((read32(s) ^ read32(s + 4)) + seed));
+    }
+    return xxh64_avalanche(seed ^ read64(s + 56) ^ read64(s + 64));
+}
+
+constexpr uint64_t hash64_17to128 (const char* p, size_t len, const unsigned char* s, uint64_t seed) {
+    uint64_t acc = len * PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16(p + 48, s + 96, seed);
+                acc += mix16(p + len - 64, s + 112, seed);
+            }
+            acc += mix16(p + 32, s + 64, seed);
+            acc += mix16(p + len - 48, s + 80, seed);
+        }
+        acc += mix16(p + 16, s + 32, seed);
+        acc += mix16(p + len - 32, s + 48, seed);
+    }
+    acc += mix16(p, s, seed);
+    acc += mix16(p + len - 16, s + 16, seed);
+    return avalanche(acc);
+}
+
+constexpr uint64_t hash64_129to240 (const char* p, size_t len, const unsigned char* s, uint64_t seed) {
+    uint64_t acc = len * PRIME64_1;
+    size_t i = 0;
+    for (; i < 8; ++i) acc += mix16(p + 16*i, s + 16*i, seed);
+    acc = avalanche(acc);
+    for (; i < len / 16; ++i) acc += mix16(p + 16*i, s + 16*(i-8) + 3, seed);
+    acc += mix16(p + len - 16, s + SECRET_SIZE_MIN - 17, seed);
+    return avalanche(acc);
+}
+
+// up to MID_SIZE_MAX bytes
+constexpr uint64_t hash64_short (const char* p, size_t len, uint64_t seed) {
+    return len <= 16  ? hash64_0to16(p, len, default_secret, seed) :
+           len <= 128 ? hash64_17to128(p, len, default_secret, seed) :
+                        hash64_129to240(p, len, default_secret, seed);
+}
+
+/* 128 bit */
+
+constexpr uint128 hash128_0to16 (const char* p, size_t len, const unsigned char* s, uint64_t seed) {
+    if (len > 8) {
+        uint64_t lo = read64(p);
+        uint64_t hi = read64(p + len - 8);
+        uint128  m  = mul128(lo ^ hi ^ ((read64(s + 32) ^ read64(s + 40)) - seed), PRIME64_1);
+        m.low  += uint64_t(len - 1) << 54;
+        hi     ^= (read64(s + 48) ^ read64(s + 56)) + seed;
+        m.high += hi + uint64_t(uint32_t(hi)) * (PRIME32_2 - 1);
+        m.low  ^= swap64(m.high);
+        uint128 r = mul128(m.low, PRIME64_2);
+        r.high += m.high * PRIME64_2;
+        return {avalanche(r.low), avalanche(r.high)};
+    }
+    if (len >= 4) {
+        seed ^= uint64_t(swap32(uint32_t(seed))) << 32;
+        uint64_t v = read32(p) + (uint64_t(read32(p + len - 4)) << 32);
+        uint128  m = mul128(v ^ ((read64(s + 16) ^ read64(s + 24)) + seed), PRIME64_1 + (len << 2));
+        m.high += m.low << 1;
+        m.low  ^= m.high >> 3;
+        m.low  ^= m.low >> 35;
+        m.low  *= PRIME_MX2;
+        m.low  ^= m.low >> 28;
+        return {m.low, avalanche(m.high)};
+    }
+    if (len) {
+        uint32_t lo = uint32_t((unsigned char)p[0]) << 16 | uint32_t((unsigned char)p[len >> 1]) << 24 |
+                      uint32_t((unsigned char)p[len - 1]) | uint32_t(len) << 8;
+        uint32_t hi = rotl32(swap32(lo), 13);
+        return {
+            xxh64_avalanche(lo ^ ((uint64_t(read32(s)) ^ read32(s + 4)) + seed)),
+            xxh64_avalanche(hi ^ ((uint64_t(read32(s + 8)) ^ read32(s + 12)) - seed))
+        };
+    }
+    return {xxh64_avalanche(seed ^ read64(s + 64) ^ read64(s + 72)), xxh64_avalanche(seed ^ read64(s + 80) ^ read64(s + 88))};
+}
+
+constexpr uint128 hash128_final (uint128 acc, size_t len, uint64_t seed) {
+    return {
+        avalanche(acc.low + acc.high),
+        0 - avalanche(acc.low * PRIME64_1 + acc.high * PRIME64_4 + (len - seed) * PRIME64_2)
+    };
+}
+
+constexpr uint128 hash128_17to128 (const char* p, size_t len, const unsigned char* s, uint64_t seed) {
+    uint128 acc = {len * PRIME64_1, 0};
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) acc = mix32(acc, p + 48, p + len - 64, s + 96, seed);
+            acc = mix32(acc, p + 32, p + len - 48, s + 64, seed);
+        }
+        acc = mix32(acc, p + 16, p + len - 32, s + 32, seed);
+    }
+    acc = mix32(acc, p, p + len - 16, s, seed);
+    return hash128_final(acc, len, seed);
+}
+
+constexpr uint128 hash128_129to240 (const char* p, size_t len, const unsigned char* s, uint64_t seed) {
+    uint128 acc = {len * PRIME64_1, 0};
+    size_t i = 0;
+    for (; i < 4; ++i) acc = mix32(acc, p + 32*i, p + 32*i + 16, s + 32*i, seed);
+    acc = {avalanche(acc.low), avalanche(acc.high)};
+    for (; i < len / 32; ++i) acc = mix32(acc, p + 32*i, p + 32*i + 16, s + 3 + 32*(i-4), seed);
+    acc = mix32(acc, p + len - 16, p + len - 32, s + SECRET_SIZE_MIN - 17 - 16, 0 - seed);
+    return hash128_final(acc, len, seed);
+}
+
+constexpr uint128 hash128_short (const char* p, size_t len, uint64_t seed) {
+    return len <= 16  ? hash128_0to16(p, len, default_secret, seed) :
+           len <= 128 ? hash128_17to128(p, len, default_secret, seed) :
+                        hash128_129to240(p, len, default_secret, seed);
+}
+
+/* long inputs, scalar code (runtime uses vector kernels from hash.cc) */
+
+struct Acc { uint64_t v[ACC_NB]; };
+
+constexpr Acc init_acc () { return {{PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1}}; }
+
+constexpr void accumulate512 (Acc& acc, const char* p, const unsigned char* s) {
+    for (size_t i = 0; i < ACC_NB; ++i) {
+        uint64_t data = read64(p + 8*i);
+        uint64_t key  = data ^ read64(s + 8*i);
+        acc.v[i ^ 1] += data;
+        acc.v[i]     += (key & 0xffffffff) * (key >> 32);
+    }
+}
+
+constexpr void scramble (Acc& acc, const unsigned char* s) {
+    for (size_t i = 0; i < ACC_NB; ++i) {
+        uint64_t a = acc.v[i];
+        a ^= a >> 47;
+        a ^= read64(s + 8*i);
+        acc.v[i] = a * PRIME32_1;
+    }
+}
+
+constexpr void accumulate (Acc& acc, const char* p, const unsigned char* s, size_t stripes) {
+    for (size_t i = 0; i < stripes; ++i) accumulate512(acc, p + STRIPE_LEN*i, s + SECRET_CONSUME_RATE*i);
+}
+
+constexpr Acc long_loop (const char* p, size_t len, const unsigned char* s) {
+    Acc acc = init_acc();
+    size_t blocks = (len - 1) / BLOCK_LEN;
+    for (size_t n = 0; n < blocks; ++n) {
+        accumulate(acc, p + n*BLOCK_LEN, s, STRIPES_PER_BLOCK);
+        scramble(acc, s + SECRET_SIZE - STRIPE_LEN);
+    }
+    accumulate(acc, p + blocks*BLOCK_LEN, s, ((len - 1) - blocks*BLOCK_LEN) / STRIPE_LEN);
+    accumulate512(acc, p + len - STRIPE_LEN, s + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC);
+    return acc;
+}
+
+constexpr uint64_t merge (const Acc& acc, const unsigned char* s, uint64_t start) {
+    for (size_t i = 0; i < 4; ++i) start += fold64(acc.v[2*i] ^ read64(s + 16*i), acc.v[2*i+1] ^ read64(s + 16*i + 8));
+    return avalanche(start);
+}
+
+constexpr uint64_t hash64_long (const Acc& acc, size_t len, const unsigned char* s) {
+    return merge(acc, s + SECRET_MERGEACCS, len * PRIME64_1);
+}
+
+constexpr uint128 hash128_long (const Acc& acc, size_t len, const unsigned char* s) {
+    return {merge(acc, s + SECRET_MERGEACCS, len * PRIME64_1), merge(acc, s + SECRET_SIZE - 64 - SECRET_MERGEACCS, ~(len * PRIME64_2))};
+}
+
+// compile-time versions for any length, seed 0
+constexpr uint64_t hash64 (const char* p, size_t len) {
+    return len <= MID_SIZE_MAX ? hash64_short(p, len, 0) : hash64_long(long_loop(p, len, default_secret), len, default_secret);
+}
+
+constexpr uint128 hash128 (const char* p, size_t len) {
+    return len <= MID_SIZE_MAX ? hash128_short(p, len, 0) : hash128_long(long_loop(p, len, default_secret), len, default_secret);
+}
+
+}}}
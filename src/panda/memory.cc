@@ -3,102 +3,694 @@
 #include <map>
 #include <mutex>
 #include <thread>
-#include <sstream>
+#include <ostream>
 #include <string.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef PANDA_MEMORY_DEBUG
+#  include <stdio.h>
+#  if defined(__has_feature)
+#    if __has_feature(address_sanitizer)
+#      define PANDA_ASAN 1
+#    endif
+#  elif defined(__SANITIZE_ADDRESS__)
+#    define PANDA_ASAN 1
+#  endif
+#  if defined(PANDA_ASAN)
+#    include <sanitizer/asan_interface.h>
+#    define PANDA_POISON(ptr, size)   ASAN_POISON_MEMORY_REGION(ptr, size)
+#    define PANDA_UNPOISON(ptr, size) ASAN_UNPOISON_MEMORY_REGION(ptr, size)
+#  elif defined(__has_include)
+#    if __has_include(<valgrind/memcheck.h>)
+#      include <valgrind/memcheck.h>
+#      define PANDA_POISON(ptr, size)   VALGRIND_MAKE_MEM_NOACCESS(ptr, size)
+#      define PANDA_UNPOISON(ptr, size) VALGRIND_MAKE_MEM_DEFINED(ptr, size)
+#    endif
+#  endif
+#endif
+#ifndef PANDA_POISON
+#  define PANDA_POISON(ptr, size)   ((void)(ptr), (void)(size))
+#  define PANDA_UNPOISON(ptr, size) ((void)(ptr), (void)(size))
+#endif
 
 namespace panda {
 
-static std::map<string, void*> global_ptrs;
+/*
+ * Global pointers are kept in a hash table with prepend-only bucket lists, so that lookups are lock-free and only insertions take the mutex.
+ * Thread-local pointers are needed only by their own thread, so they are kept in a thread-local list which is freed when thread exits.
+ * Entries keep copies of key names (keys may not outlive them) and compare them when hashes are equal.
+ */
+struct StoredKey {
+    uint64_t hash;
+    string   type;
+    string   name;
+
+    explicit StoredKey (const GlobalKey& key) : hash(key.hash), type(key.type->name()), name(key.name ? key.name : "") {}
+
+    bool operator== (const GlobalKey& key) const {
+        return hash == key.hash && type == key.type->name() && name == (key.name ? key.name : "");
+    }
+};
+
+struct GlobalPtr {
+    StoredKey  key;
+    void*      val;
+    GlobalPtr* next;
+};
+
+static const size_t GLOBAL_PTRS_BUCKETS = 256;
+
+static std::atomic<GlobalPtr*> global_ptrs[GLOBAL_PTRS_BUCKETS];
 static std::mutex              global_ptrs_mutex;
 
-static const int START_SIZE = 16;
+// set when thread-local pointers are released, thread_local objects destroyed after that must not register new ones
+static thread_local bool tls_released;
+
+struct TlsPtrs {
+    struct Row {
+        StoredKey key;
+        void*     val;
+        void      (*on_thread_exit)(void*);
+        void**    cache; // nulled on release, so that callers come back and see tls_released
+    };
+    std::vector<Row> list;
+
+    void* find (const GlobalKey& key) const {
+        for (auto& row : list) if (row.key == key) return row.val;
+        return NULL;
+    }
+
+    ~TlsPtrs () {
+        tls_released = true;
+        while (list.size()) {
+            auto row = list.back();
+            list.pop_back();
+            if (row.cache) *row.cache = NULL;
+            if (row.on_thread_exit) row.on_thread_exit(row.val);
+        }
+    }
+};
+
+static thread_local TlsPtrs tls_ptrs;
+
+// pools of exited threads waiting to be adopted, they are never deleted as somebody may still hold a pointer to them
+struct Orphanage {
+    std::mutex                      mutex;
+    std::vector<MemoryPool*>        pools;
+    std::vector<DynamicMemoryPool*> dynamic_pools;
+    std::vector<MemoryPool*>        detached_pools;
+};
+
+static Orphanage& orphanage () {
+    static Orphanage* ret = new Orphanage(); // immortal, threads may exit after static destruction
+    return *ret;
+}
+
+static const size_t MIN_SEGMENT_SIZE   = 4096;
+static const size_t MIN_SEGMENT_BLOCKS = 8;
+static const size_t MMAP_CHUNK_SIZE    = 1024*1024; // chunks of this size or bigger are mapped directly to be surely returned to the system
+
+std::atomic<uint32_t> MemoryPool::global_trim_epoch(0);
+
+struct PoolList {
+    std::mutex  mutex;
+    MemoryPool* first = NULL;
+};
+
+static PoolList& pool_list () {
+    static PoolList* list = new PoolList(); // immortal, pools may be destroyed after static destruction
+    return *list;
+}
 
 DynamicMemoryPool* DynamicMemoryPool::_global_instance = new DynamicMemoryPool();
 
-void* detail::__get_global_ptr (const std::type_info& ti, const char* name, void* val) {
-    string key(ti.name());
-    if (name) key += name;
+bool operator== (const GlobalKey& a, const GlobalKey& b) {
+    return a.hash == b.hash && !strcmp(a.type->name(), b.type->name()) && !strcmp(a.name ? a.name : "", b.name ? b.name : "");
+}
+
+GlobalKey detail::__global_key (const std::type_info& ti, const char* name) {
+    // not seeded, keys must not change if seed() does. Name is hashed with type as a seed, so that pairs like ("AB", "C") and ("A", "BC") differ
+    uint64_t hash = hash::hash_xxh3_64(name ? name : "", hash::hash_xxh3_64(ti.name()));
+    return GlobalKey{&ti, name, hash};
+}
+
+void* detail::__get_global_ptr (const GlobalKey& key, void* val) {
+    auto& bucket = global_ptrs[key.hash % GLOBAL_PTRS_BUCKETS];
+    for (auto node = bucket.load(std::memory_order_acquire); node; node = node->next) if (node->key == key) return node->val;
 
     std::lock_guard<std::mutex> guard(global_ptrs_mutex);
-    auto it = global_ptrs.find(key);
-    if (it != global_ptrs.end()) return it->second;
+    auto first = bucket.load(std::memory_order_relaxed);
+    for (auto node = first; node; node = node->next) if (node->key == key) return node->val; // someone could insert it before we locked
 
-    global_ptrs.emplace(key, val);
+    bucket.store(new GlobalPtr{StoredKey(key), val, first}, std::memory_order_release);
     return val;
 }
 
+void* detail::__get_global_tls_ptr (const GlobalKey& key, void* val, void (*on_thread_exit)(void*)) {
+    if (tls_released) return val;
+    if (auto ret = tls_ptrs.find(key)) return ret;
+    tls_ptrs.list.push_back({StoredKey(key), val, on_thread_exit, NULL});
+    return val;
+}
+
+void* detail::__get_global_ptr (const std::type_info& ti, const char* name, void* val) {
+    return __get_global_ptr(__global_key(ti, name), val);
+}
+
 void* detail::__get_global_tls_ptr (const std::type_info& ti, const char* name, void* val) {
-    string key(ti.name());
-    if (name) key += name;
+    return __get_global_tls_ptr(__global_key(ti, name), val);
+}
+
+static char* alloc_chunk (size_t size, size_t align) {
+    void* ret;
+    #ifdef _WIN32
+    ret = _aligned_malloc(size, align);
+    if (!ret) throw std::bad_alloc();
+    #else
+    if (size >= MMAP_CHUNK_SIZE) {
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        size_t extra = align > page ? align : 0; // map more to be able to align
+        char* map = (char*)mmap(NULL, size + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) throw std::bad_alloc();
+        char* start = (char*)(((uintptr_t)map + extra) & ~(uintptr_t)(align - 1));
+        if (start > map) munmap(map, start - map);
+        if (map + extra > start) munmap(start + size, map + extra - start);
+        return start;
+    }
+    if (posix_memalign(&ret, align, size)) throw std::bad_alloc();
+    #endif
+    return (char*)ret;
+}
 
-    std::ostringstream ss;
-    ss << "~~~" << std::this_thread::get_id();
-    auto tid_str = ss.str();
+static void* alloc_large (size_t size) {
+    #ifdef _WIN32
+    void* ret = malloc(size);
+    if (!ret) throw std::bad_alloc();
+    return ret;
+    #else
+    void* ret = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ret == MAP_FAILED) throw std::bad_alloc();
+    return ret;
+    #endif
+}
 
-    key += string(tid_str.data(), tid_str.length());
+static void free_large (void* ptr, size_t size) {
+    #ifdef _WIN32
+    (void)size;
+    free(ptr);
+    #else
+    munmap(ptr, size);
+    #endif
+}
 
-    std::lock_guard<std::mutex> guard(global_ptrs_mutex);
-    auto it = global_ptrs.find(key);
-    if (it != global_ptrs.end()) return it->second;
+static void free_chunk (char* list, size_t size) {
+    PANDA_UNPOISON(list, size);
+    #ifdef _WIN32
+    (void)size;
+    _aligned_free(list);
+    #else
+    if (size >= MMAP_CHUNK_SIZE) munmap(list, size);
+    else free(list);
+    #endif
+}
 
-    global_ptrs.emplace(key, val);
-    return val;
+MemoryPool::MemoryPool (size_t blocksize, size_t max_chunk_size, size_t align)
+    : first_free(NULL), remote_free(NULL), allocs(0), frees(0), remote_frees(0), chunks_cnt(0), reserved(0), prev_pool(NULL), detached(false)
+{
+    if (align & (align - 1)) throw std::invalid_argument("MemoryPool: alignment must be a power of two");
+    this->align     = align > sizeof(void*) ? align : sizeof(void*);
+    usable_size     = round_up(blocksize, this->align);
+    this->blocksize = block_stride(blocksize, this->align);
+    data_offset     = this->align > SEGMENT_HEADER ? this->align : SEGMENT_HEADER;
+    segment_size    = calc_segment_size(this->blocksize);
+    trim_epoch      = global_trim_epoch.load(std::memory_order_relaxed);
+    thread.store(std::hash<std::thread::id>()(std::this_thread::get_id()), std::memory_order_relaxed);
+    this->max_chunk_size(max_chunk_size);
+
+    auto& list = pool_list();
+    std::lock_guard<std::mutex> guard(list.mutex);
+    next_pool = list.first;
+    if (next_pool) next_pool->prev_pool = this;
+    list.first = this;
+}
+
+void MemoryPool::max_chunk_size (size_t size) {
+    max_chunk_segments = size / segment_size;
+    if (!max_chunk_segments) max_chunk_segments = 1;
+}
+
+size_t MemoryPool::calc_segment_size (size_t blocksize) {
+    // blocksize is already rounded up to a multiple of alignment, so the geometry depends only on blocksize
+    size_t need = (blocksize > SEGMENT_HEADER ? blocksize : SEGMENT_HEADER) + blocksize * MIN_SEGMENT_BLOCKS;
+    size_t ret  = MIN_SEGMENT_SIZE;
+    while (ret < need) ret <<= 1;
+    return ret;
 }
 
 void MemoryPool::grow () {
-    size_t pools_cnt = pools.size();
-    if (pools_cnt) {
-        pools.resize(pools_cnt+1);
-        pools[pools_cnt].size = pools[pools_cnt-1].size*2;
-    } else {
-        pools.resize(1);
-        pools[0].size = START_SIZE;
-    }
-    Pool* pool = &pools.back();
-    pool->len = pool->size * blocksize;
-    char* elem = pool->list = new char[pool->len];
-    char* end  = elem + pool->len;
-    while (elem < end) {
+    if (reclaim()) return;
+
+    Chunk* chunk = chunks.size() ? chunks.back() : NULL;
+    if (!chunk || chunk->used == chunk->size) { // all segments are in use, allocate twice bigger chunk
+        size_t size = chunk ? chunk->size * 2 : 1;
+        if (size > max_chunk_segments) size = max_chunk_segments;
+        chunks.reserve(chunks.size() + 1);
+        chunk = new Chunk{alloc_chunk(size * segment_size, segment_size), size, 0, 0};
+        chunks.push_back(chunk);
+        bump(chunks_cnt);
+        bump(reserved, size * segment_size);
+    }
+    split_segment(chunk);
+}
+
+void MemoryPool::allocate_bulk (size_t n, void** out) {
+    if (detached) {
+        for (size_t i = 0; i < n; ++i) out[i] = detached_allocate();
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (!first_free) grow();
+        out[i] = first_free;
+        #ifdef PANDA_MEMORY_DEBUG
+        debug_allocated(first_free);
+        #endif
+        first_free = *((void**)first_free);
+    }
+    bump(allocs, n);
+}
+
+void MemoryPool::deallocate_bulk (size_t n, void* const* elems) {
+    void*  head = first_free;
+    size_t cnt  = 0;
+    for (size_t i = n; i-- > 0;) { // link in reverse order, so that blocks are reused in the same order
+        void* elem = elems[i];
+        MemoryPool* owner = segment_owner(elem, segment_size);
+        if (owner != this) {
+            owner->remote_deallocate(elem);
+            continue;
+        }
+        #ifdef PANDA_MEMORY_DEBUG
+        if (!debug_freed(elem)) continue;
+        #endif
+        *((void**)elem) = head;
+        head = elem;
+        ++cnt;
+    }
+    first_free = head;
+    bump(frees, cnt);
+    if (trim_epoch != global_trim_epoch.load(std::memory_order_relaxed)) on_trim_request();
+}
+
+// takes all the blocks freed by other threads at once
+bool MemoryPool::reclaim () {
+    if (!remote_free.load(std::memory_order_relaxed)) return false;
+    void* list = remote_free.exchange(NULL, std::memory_order_acquire); // only owner takes the list, so it can't be empty here
+    if (first_free) {
+        void* last = list;
+        while (*((void**)last)) last = *((void**)last);
+        *((void**)last) = first_free;
+    }
+    first_free = list;
+    return true;
+}
+
+size_t MemoryPool::trim () {
+    if (detached) return 0;
+    trim_epoch = global_trim_epoch.load(std::memory_order_relaxed);
+    reclaim();
+    if (!chunks.size()) return 0;
+
+    auto segment_chunk = [this](void* elem) {
+        return ((Segment*)((uintptr_t)elem & ~(uintptr_t)(segment_size - 1)))->chunk;
+    };
+
+    // count free blocks per chunk instead of maintaining live counters in allocate/deallocate to keep them as fast as possible
+    for (auto chunk : chunks) chunk->free = 0;
+    for (void* elem = first_free; elem; elem = *((void**)elem)) ++segment_chunk(elem)->free;
+
+    const size_t blocks_per_segment = (segment_size - data_offset) / blocksize;
+    auto is_empty = [blocks_per_segment](Chunk* chunk) { return chunk->free == chunk->used * blocks_per_segment; };
+
+    bool has_empty = false;
+    for (auto chunk : chunks) if (is_empty(chunk)) { has_empty = true; break; }
+    if (!has_empty) return 0;
+
+    void** link = &first_free; // remove blocks of empty chunks from free list
+    for (void* elem = first_free; elem; elem = *((void**)elem)) {
+        if (is_empty(segment_chunk(elem))) continue;
+        *link = elem;
+        link = (void**)elem;
+    }
+    *link = NULL;
+
+    size_t released = 0;
+    size_t cnt = 0;
+    for (auto chunk : chunks) {
+        if (is_empty(chunk)) {
+            released += chunk->size * segment_size;
+            free_chunk(chunk->list, chunk->size * segment_size);
+            delete chunk;
+        }
+        else chunks[cnt++] = chunk;
+    }
+    chunks.resize(cnt);
+    bump(chunks_cnt, (ptrdiff_t)cnt - (ptrdiff_t)chunks_cnt.load(std::memory_order_relaxed));
+    bump(reserved, -(ptrdiff_t)released);
+
+    return released;
+}
+
+void MemoryPool::on_trim_request () {
+    trim();
+}
+
+void MemoryPool::request_trim_all () {
+    global_trim_epoch.fetch_add(1, std::memory_order_relaxed);
+    trim_orphans();
+    DynamicMemoryPool::trim_orphans();
+}
+
+MemoryPool* MemoryPool::thread_instance (const GlobalKey& key, size_t blocksize, size_t align, MemoryPool** cache) {
+    if (tls_released) return detached_instance(blocksize, align);
+    if (auto ret = tls_ptrs.find(key)) return (MemoryPool*)ret;
+    auto pool = acquire(blocksize, align);
+    tls_ptrs.list.push_back({StoredKey(key), pool, &release, (void**)cache});
+    return pool;
+}
+
+MemoryPool* MemoryPool::detached_instance (size_t blocksize, size_t align) {
+    if (align < sizeof(void*)) align = sizeof(void*);
+    blocksize = round_up(blocksize, align);
+    auto& o = orphanage();
+    std::lock_guard<std::mutex> guard(o.mutex);
+    for (auto pool : o.detached_pools) if (pool->usable_size == blocksize && pool->align == align) return pool;
+    auto pool = new MemoryPool(blocksize, DEFAULT_MAX_CHUNK_SIZE, align);
+    pool->detached = true;
+    o.detached_pools.push_back(pool);
+    return pool;
+}
+
+void* MemoryPool::detached_allocate () {
+    auto& o = orphanage();
+    std::lock_guard<std::mutex> guard(o.mutex);
+    // nobody adopts an orphan while the lock is held, so it may be used as if we owned it
+    for (auto it = o.pools.rbegin(); it != o.pools.rend(); ++it) {
+        if ((*it)->usable_size == usable_size && (*it)->align == align) return (*it)->allocate();
+    }
+    auto pool = new MemoryPool(usable_size, DEFAULT_MAX_CHUNK_SIZE, align);
+    o.pools.push_back(pool);
+    return pool->allocate();
+}
+
+MemoryPool* MemoryPool::acquire (size_t blocksize, size_t align) {
+    if (align < sizeof(void*)) align = sizeof(void*);
+    blocksize = round_up(blocksize, align);
+    MemoryPool* ret = NULL;
+    {
+        auto& o = orphanage();
+        std::lock_guard<std::mutex> guard(o.mutex);
+        for (auto it = o.pools.rbegin(); it != o.pools.rend(); ++it) {
+            if ((*it)->usable_size != blocksize || (*it)->align != align) continue;
+            ret = *it;
+            o.pools.erase(std::next(it).base());
+            break;
+        }
+    }
+    if (!ret) return new MemoryPool(blocksize, DEFAULT_MAX_CHUNK_SIZE, align);
+    ret->adopt();
+    return ret;
+}
+
+void MemoryPool::adopt () {
+    thread.store(std::hash<std::thread::id>()(std::this_thread::get_id()), std::memory_order_relaxed);
+    max_chunk_size(DEFAULT_MAX_CHUNK_SIZE);
+    trim_epoch = global_trim_epoch.load(std::memory_order_relaxed);
+    reclaim();
+}
+
+void MemoryPool::release (void* ptr) {
+    auto pool = (MemoryPool*)ptr;
+    pool->trim();
+    auto& o = orphanage();
+    std::lock_guard<std::mutex> guard(o.mutex);
+    o.pools.push_back(pool);
+}
+
+size_t MemoryPool::trim_orphans () {
+    size_t ret = 0;
+    auto& o = orphanage();
+    std::lock_guard<std::mutex> guard(o.mutex);
+    for (auto pool : o.pools) ret += pool->trim();
+    return ret;
+}
+
+void MemoryPool::split_segment (Chunk* chunk) {
+    char* seg = chunk->list + chunk->used++ * segment_size;
+    auto header = (Segment*)seg;
+    header->owner = this;
+    header->chunk = chunk;
+
+    char* elem = seg + data_offset;
+    char* last = elem + ((segment_size - data_offset) / blocksize - 1) * blocksize;
+    while (elem < last) {
         *((void**)elem) = elem + blocksize; // set next free for each free element
         elem += blocksize;
     }
-    *((void**)(elem-blocksize)) = NULL; // last element has no next free
-    first_free = pool->list;
+    *((void**)last) = first_free;
+    first_free = seg + data_offset;
+
+    #ifdef PANDA_MEMORY_DEBUG
+    for (elem = seg + data_offset; elem <= last; elem += blocksize) debug_split(elem);
+    #endif
+}
+
+#ifdef PANDA_MEMORY_DEBUG
+/*
+ * Each block is followed by a canary which tells whether the block is allocated or free. Free blocks are filled with POISON_BYTE except for
+ * the free list pointer and are made inaccessible for ASan/Valgrind; canaries are inaccessible always. Checks are done on allocate/deallocate.
+ */
+static const uint64_t CANARY_ALLOCATED = 0xA11CA7EDA11CA7EDULL;
+static const uint64_t CANARY_FREED     = 0xF4EEDF4EEDF4EEDFULL;
+static const unsigned char POISON_BYTE = 0xDD;
+
+static void default_debug_error_handler (const char* error, void* block) {
+    fprintf(stderr, "panda::MemoryPool: %s, block %p\n", error, block);
+    abort();
+}
+
+void (*MemoryPool::debug_error_handler)(const char*, void*) = &default_debug_error_handler;
+
+void MemoryPool::debug_split (char* elem) {
+    auto canary = (uint64_t*)(elem + blocksize - DEBUG_FOOTER);
+    *canary = CANARY_FREED;
+    memset(elem + sizeof(void*), POISON_BYTE, blocksize - DEBUG_FOOTER - sizeof(void*));
+    PANDA_POISON(elem + sizeof(void*), blocksize - sizeof(void*));
+}
+
+void MemoryPool::debug_allocated (void* ptr) {
+    auto elem   = (char*)ptr;
+    auto canary = (uint64_t*)(elem + blocksize - DEBUG_FOOTER);
+    PANDA_UNPOISON(elem, blocksize);
+    if (*canary != CANARY_FREED) debug_error_handler("canary of free block is overwritten, buffer overflow of previous block or use after free", ptr);
+    auto end = elem + blocksize - DEBUG_FOOTER;
+    for (auto p = elem + sizeof(void*); p < end; ++p) if ((unsigned char)*p != POISON_BYTE) {
+        debug_error_handler("free block has been modified, use after free", ptr);
+        break;
+    }
+    *canary = CANARY_ALLOCATED;
+    PANDA_POISON(canary, DEBUG_FOOTER);
 }
 
+bool MemoryPool::debug_freed (void* ptr) {
+    auto elem   = (char*)ptr;
+    auto canary = (uint64_t*)(elem + blocksize - DEBUG_FOOTER);
+    PANDA_UNPOISON(canary, DEBUG_FOOTER);
+    if (*canary != CANARY_ALLOCATED) {
+        debug_error_handler(*canary == CANARY_FREED ? "double free" : "canary is overwritten, buffer overflow", ptr);
+        PANDA_POISON(canary, DEBUG_FOOTER);
+        return false; // don't put it into free list again
+    }
+    *canary = CANARY_FREED;
+    memset(elem + sizeof(void*), POISON_BYTE, blocksize - DEBUG_FOOTER - sizeof(void*));
+    PANDA_POISON(elem + sizeof(void*), blocksize - sizeof(void*));
+    return true;
+}
+#endif
+
 bool MemoryPool::is_mine (void* elem) {
-    Pool* first = &pools.front();
-    Pool* pool  = &pools.back();
-    while (pool >= first) { // from last to first, because most possibility that elem is in latest pools
-        if (elem >= pool->list && elem < pool->list + pool->len) return true;
-        pool--;
+    for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) { // from last to first, because most possibility that elem is in latest chunks
+        auto chunk = *it;
+        if (elem >= chunk->list && elem < chunk->list + chunk->size * segment_size) return true;
     }
     return false;
 }
 
+MemoryPool::Stats MemoryPool::stats () const {
+    Stats ret;
+    ret.thread      = thread.load(std::memory_order_relaxed);
+    ret.blocksize   = usable_size;
+    ret.chunks      = chunks_cnt.load(std::memory_order_relaxed);
+    ret.reserved    = reserved.load(std::memory_order_relaxed);
+    ret.deallocated = frees.load(std::memory_order_relaxed) + remote_frees.load(std::memory_order_relaxed);
+    ret.allocated   = allocs.load(std::memory_order_relaxed);
+    return ret;
+}
+
+std::vector<MemoryPool::Stats> MemoryPool::all_stats () {
+    std::vector<Stats> ret;
+    auto& list = pool_list();
+    std::lock_guard<std::mutex> guard(list.mutex);
+    for (auto pool = list.first; pool; pool = pool->next_pool) ret.push_back(pool->stats());
+    return ret;
+}
+
+void MemoryPool::dump_stats (std::ostream& os) {
+    struct Total {
+        size_t pools, chunks, reserved, in_use, allocated, deallocated;
+        void add (const Stats& st) {
+            ++pools;
+            chunks      += st.chunks;
+            reserved    += st.reserved;
+            in_use      += st.in_use();
+            allocated   += st.allocated;
+            deallocated += st.deallocated;
+        }
+        void dump (std::ostream& os) const {
+            os << " pools=" << pools << " chunks=" << chunks << " reserved=" << reserved << " in_use=" << in_use
+               << " allocated=" << allocated << " deallocated=" << deallocated << "\n";
+        }
+    };
+
+    auto stats = all_stats();
+    std::map<size_t, Total> threads, sizes;
+    Total total = {};
+    for (auto& st : stats) {
+        os << "pool thread=" << st.thread << " blocksize=" << st.blocksize << " chunks=" << st.chunks << " reserved=" << st.reserved
+           << " in_use=" << st.in_use() << " allocated=" << st.allocated << " deallocated=" << st.deallocated << "\n";
+        threads[st.thread].add(st);
+        sizes[st.blocksize].add(st);
+        total.add(st);
+    }
+    for (auto& row : threads) { os << "thread thread=" << row.first; row.second.dump(os); }
+    for (auto& row : sizes)   { os << "blocksize blocksize=" << row.first; row.second.dump(os); }
+    os << "total"; total.dump(os);
+}
+
 MemoryPool::~MemoryPool () {
-    if (!pools.size()) return;
-    Pool* pool = &pools.front();
-    Pool* last = &pools.back();
-    while (pool <= last) {
-        delete[] pool->list;
-        pool++;
+    {
+        auto& list = pool_list();
+        std::lock_guard<std::mutex> guard(list.mutex);
+        if (prev_pool) prev_pool->next_pool = next_pool;
+        else           list.first = next_pool;
+        if (next_pool) next_pool->prev_pool = prev_pool;
+    }
+    for (auto chunk : chunks) {
+        free_chunk(chunk->list, chunk->size * segment_size);
+        delete chunk;
     }
 }
 
-DynamicMemoryPool::DynamicMemoryPool () {
-    memset(small_pools,  0, POOLS_CNT*sizeof(MemoryPool*));
-    memset(medium_pools, 0, POOLS_CNT*sizeof(MemoryPool*));
-    memset(big_pools,    0, POOLS_CNT*sizeof(MemoryPool*));
-    small_pools[0] = small_pools[1] = new MemoryPool(8); // min bytes = 8, make 4-byte and 8-byte requests shared
+DynamicMemoryPool::DynamicMemoryPool () : large_cache_cnt(0), large_cache_size(0), detached(false) {
+    memset(pools, 0, CLASSES_CNT*sizeof(MemoryPool*));
 }
 
-DynamicMemoryPool::~DynamicMemoryPool () {
-    for (int i = 0; i < POOLS_CNT; ++i) {
-        if (i) delete small_pools[i];
-        delete medium_pools[i];
-        delete big_pools[i];
+size_t DynamicMemoryPool::trim () {
+    size_t ret = 0;
+    for (auto pool : pools) if (pool) ret += pool->trim();
+    for (size_t i = 0; i < large_cache_cnt; ++i) free_large(large_cache[i].ptr, large_cache[i].size);
+    ret += large_cache_size;
+    large_cache_cnt = large_cache_size = 0;
+    return ret;
+}
+
+void* DynamicMemoryPool::allocate_large (size_t size) {
+    size = large_size(size);
+    if (detached) return alloc_large(size); // no cache, it is shared
+    for (size_t i = large_cache_cnt; i-- > 0;) {
+        if (large_cache[i].size != size) continue;
+        void* ret = large_cache[i].ptr;
+        memmove(large_cache + i, large_cache + i + 1, (--large_cache_cnt - i) * sizeof(Mapping));
+        large_cache_size -= size;
+        return ret;
+    }
+    return alloc_large(size);
+}
+
+void DynamicMemoryPool::deallocate_large (void* ptr, size_t size) {
+    size = large_size(size);
+    if (size > LARGE_CACHE_SIZE || detached) return free_large(ptr, size);
+    // evict the oldest mappings
+    size_t evict = 0;
+    while (evict < large_cache_cnt && (large_cache_cnt - evict == LARGE_CACHE_CNT || large_cache_size + size > LARGE_CACHE_SIZE)) {
+        free_large(large_cache[evict].ptr, large_cache[evict].size);
+        large_cache_size -= large_cache[evict].size;
+        ++evict;
+    }
+    if (evict) {
+        large_cache_cnt -= evict;
+        memmove(large_cache, large_cache + evict, large_cache_cnt * sizeof(Mapping));
+    }
+    large_cache[large_cache_cnt++] = Mapping{ptr, size};
+    large_cache_size += size;
+}
+
+DynamicMemoryPool* DynamicMemoryPool::thread_instance (DynamicMemoryPool** cache) {
+    static const auto key = global_key<DynamicMemoryPool>("instance");
+    if (tls_released) {
+        static DynamicMemoryPool* detached_pool = [] {
+            auto ret = new DynamicMemoryPool();
+            ret->detached = true;
+            return ret;
+        }();
+        return detached_pool;
     }
+    if (auto ret = tls_ptrs.find(key)) return (DynamicMemoryPool*)ret;
+
+    DynamicMemoryPool* pool = NULL;
+    {
+        auto& o = orphanage();
+        std::lock_guard<std::mutex> guard(o.mutex);
+        if (o.dynamic_pools.size()) {
+            pool = o.dynamic_pools.back();
+            o.dynamic_pools.pop_back();
+        }
+    }
+    if (pool) pool->adopt();
+    else      pool = new DynamicMemoryPool();
+
+    tls_ptrs.list.push_back({StoredKey(key), pool, &release, (void**)cache});
+    return pool;
+}
+
+void DynamicMemoryPool::adopt () {
+    for (auto pool : pools) if (pool) pool->adopt();
+}
+
+void DynamicMemoryPool::release (void* ptr) {
+    auto pool = (DynamicMemoryPool*)ptr;
+    pool->trim();
+    auto& o = orphanage();
+    std::lock_guard<std::mutex> guard(o.mutex);
+    o.dynamic_pools.push_back(pool);
+}
+
+size_t DynamicMemoryPool::trim_orphans () {
+    size_t ret = 0;
+    auto& o = orphanage();
+    std::lock_guard<std::mutex> guard(o.mutex);
+    for (auto pool : o.dynamic_pools) ret += pool->trim();
+    return ret;
+}
+
+DynamicMemoryPool::~DynamicMemoryPool () {
+    for (auto pool : pools) delete pool;
+    for (size_t i = 0; i < large_cache_cnt; ++i) free_large(large_cache[i].ptr, large_cache[i].size);
 }
 
 }
@@ -1,24 +1,59 @@
 #pragma once
+#include <atomic>
+#include <iosfwd>
 #include <vector>
 #include <memory>
 #include <assert.h>
+#include <stdint.h>
 #include <stdexcept>
+#include <typeinfo>
 
 namespace panda {
 
+/*
+ * Key for get_global_ptr/get_global_tls_ptr, calculate it once with global_key<CLASS>(name) and reuse. Entries are matched by type name and name,
+ * so that the same entry is found from any shared library, hash only speeds lookups up. 'name' must live as long as the key is used.
+ */
+struct GlobalKey {
+    const std::type_info* type;
+    const char*           name;
+    uint64_t              hash;
+};
+
+bool        operator== (const GlobalKey&, const GlobalKey&);
+inline bool operator!= (const GlobalKey& a, const GlobalKey& b) { return !(a == b); }
+
 namespace detail {
-    void* __get_global_ptr     (const std::type_info& ti, const char* name, void* val);
-    void* __get_global_tls_ptr (const std::type_info& ti, const char* name, void* val);
+    GlobalKey __global_key         (const std::type_info& ti, const char* name);
+    void*     __get_global_ptr     (const GlobalKey& key, void* val);
+    void*     __get_global_tls_ptr (const GlobalKey& key, void* val, void (*on_thread_exit)(void*) = NULL);
+    void*     __get_global_ptr     (const std::type_info& ti, const char* name, void* val);
+    void*     __get_global_tls_ptr (const std::type_info& ti, const char* name, void* val);
+}
+
+template <class CLASS>
+inline GlobalKey global_key (const char* name = NULL) {
+    return detail::__global_key(typeid(CLASS), name);
+}
+
+template <class T>
+inline T* get_global_ptr (const GlobalKey& key, T* val) {
+    return reinterpret_cast<T*>(detail::__get_global_ptr(key, reinterpret_cast<void*>(val)));
+}
+
+template <class T>
+inline T* get_global_tls_ptr (const GlobalKey& key, T* val) {
+    return reinterpret_cast<T*>(detail::__get_global_tls_ptr(key, reinterpret_cast<void*>(val)));
 }
 
 template <class CLASS, class T>
 inline T* get_global_ptr (T* val, const char* name = NULL) {
-    return reinterpret_cast<T*>(detail::__get_global_ptr(typeid(CLASS), name, reinterpret_cast<void*>(val)));
+    return get_global_ptr(global_key<CLASS>(name), val);
 }
 
 template <class CLASS, class T>
 inline T* get_global_tls_ptr (T* val, const char* name = NULL) {
-    return reinterpret_cast<T*>(detail::__get_global_tls_ptr(typeid(CLASS), name, reinterpret_cast<void*>(val)));
+    return get_global_tls_ptr(global_key<CLASS>(name), val);
 }
 
 #define PANDA_GLOBAL_MEMBER_PTR(CLASS, TYPE, accessor, defval)              \
@@ -48,74 +83,237 @@ inline T* get_global_tls_ptr (T* val, const char* name = NULL) {
         return ptr;                                                 \
     }
 
-#define PANDA_TLS_MEMBER_PTR(CLASS, TYPE, accessor, defval)                         \
-    static TYPE accessor () {                                                       \
-        static thread_local TYPE _ptr;                                              \
-        TYPE ptr = _ptr;                                                            \
-        if (!ptr) ptr = _ptr = panda::get_global_tls_ptr<CLASS>(defval, #accessor); \
-        return ptr;                                                                 \
-    }
-
-#define PANDA_TLS_MEMBER(CLASS, TYPE, accessor, defval)                     \
-    static TYPE& accessor () {                                              \
-        static thread_local TYPE* _ptr;                                     \
-        TYPE* ptr = _ptr;                                                   \
-        if (!ptr) {                                                         \
-            static thread_local TYPE val = defval;                          \
-            ptr = _ptr = panda::get_global_tls_ptr<CLASS>(&val, #accessor); \
-        }                                                                   \
-        return *ptr;                                                        \
-    }
-
-#define PANDA_TLS_MEMBER_AS_PTR(CLASS, TYPE, accessor, defval)              \
-    static TYPE* accessor () {                                              \
-        static thread_local TYPE* _ptr;                                     \
-        TYPE* ptr = _ptr;                                                   \
-        if (!ptr) {                                                         \
-            static thread_local TYPE val = defval;                          \
-            ptr = _ptr = panda::get_global_tls_ptr<CLASS>(&val, #accessor); \
-        }                                                                   \
-        return ptr;                                                         \
+#define PANDA_TLS_MEMBER_PTR(CLASS, TYPE, accessor, defval)                     \
+    static TYPE accessor () {                                                   \
+        static thread_local TYPE _ptr;                                          \
+        TYPE ptr = _ptr;                                                        \
+        if (!ptr) {                                                             \
+            static const auto key = panda::global_key<CLASS>(#accessor);        \
+            ptr = _ptr = panda::get_global_tls_ptr(key, defval);                \
+        }                                                                       \
+        return ptr;                                                             \
     }
 
-struct MemoryPool {
-    MemoryPool (size_t blocksize) : first_free(NULL) {
-        this->blocksize = round_up(blocksize);
+#define PANDA_TLS_MEMBER(CLASS, TYPE, accessor, defval)                         \
+    static TYPE& accessor () {                                                  \
+        static thread_local TYPE* _ptr;                                         \
+        TYPE* ptr = _ptr;                                                       \
+        if (!ptr) {                                                             \
+            static const auto key = panda::global_key<CLASS>(#accessor);        \
+            static thread_local TYPE val = defval;                              \
+            ptr = _ptr = panda::get_global_tls_ptr(key, &val);                  \
+        }                                                                       \
+        return *ptr;                                                            \
+    }
+
+#define PANDA_TLS_MEMBER_AS_PTR(CLASS, TYPE, accessor, defval)                  \
+    static TYPE* accessor () {                                                  \
+        static thread_local TYPE* _ptr;                                         \
+        TYPE* ptr = _ptr;                                                       \
+        if (!ptr) {                                                             \
+            static const auto key = panda::global_key<CLASS>(#accessor);        \
+            static thread_local TYPE val = defval;                              \
+            ptr = _ptr = panda::get_global_tls_ptr(key, &val);                  \
+        }                                                                       \
+        return ptr;                                                             \
     }
 
+struct MemoryPool {
+    static constexpr const size_t DEFAULT_MAX_CHUNK_SIZE = 4*1024*1024;
+
+    #ifdef PANDA_MEMORY_DEBUG
+    static constexpr const size_t DEBUG_FOOTER = sizeof(uint64_t); // canary after each block
+
+    // called when debug checks detect heap corruption. Default one prints the error and aborts
+    static void (*debug_error_handler)(const char* error, void* block);
+    #else
+    static constexpr const size_t DEBUG_FOOTER = 0;
+    #endif
+
+    struct Stats {
+        size_t thread;      // hash of the id of the thread which created the pool
+        size_t blocksize;
+        size_t chunks;
+        size_t reserved;    // bytes taken from the system
+        size_t allocated;   // number of allocated blocks
+        size_t deallocated; // number of deallocated blocks, including ones freed by other threads
+
+        size_t in_use () const { return allocated > deallocated ? (allocated - deallocated) * blocksize : 0; } // bytes
+    };
+
+    // blocks are aligned to 'align' (must be a power of two, 0 means pointer size); blocksize is rounded up to a multiple of it
+    MemoryPool (size_t blocksize, size_t max_chunk_size = DEFAULT_MAX_CHUNK_SIZE, size_t align = 0);
+
     void* allocate () {
-        if (!first_free) grow();
+        if (!first_free) {
+            if (detached) return detached_allocate();
+            grow();
+        }
         void* ret = first_free;
+        #ifdef PANDA_MEMORY_DEBUG
+        debug_allocated(ret);
+        #endif
         first_free = *((void**)ret);
+        bump(allocs);
         return ret;
     }
 
     void deallocate (void* elem) {
+        MemoryPool* owner = segment_owner(elem, segment_size);
+        if (owner != this) return owner->remote_deallocate(elem); // block was allocated by another thread's pool
         #ifdef TEST_FULL
         if(!is_mine(elem)) abort(); // protection for debugging, normally you MUST NEVER pass a pointer that wasn't created via current mempool
         #endif
+        #ifdef PANDA_MEMORY_DEBUG
+        if (!debug_freed(elem)) return;
+        #endif
         *((void**)elem) = first_free;
         first_free = elem;
+        bump(frees);
+        if (trim_epoch != global_trim_epoch.load(std::memory_order_relaxed)) on_trim_request();
+    }
+
+    // fills 'out' with n blocks, cheaper than n calls to allocate()
+    void allocate_bulk (size_t n, void** out);
+
+    // frees n blocks splicing them into the free list at once. Blocks of other pools are returned to their owners as by deallocate()
+    void deallocate_bulk (size_t n, void* const* elems);
+
+    // may be called from any thread. Block is returned to the owner's remote free list and will be reused on owner's next allocate()
+    void remote_deallocate (void* elem) {
+        #ifdef PANDA_MEMORY_DEBUG
+        if (!debug_freed(elem)) return;
+        #endif
+        void* head = remote_free.load(std::memory_order_relaxed);
+        do *((void**)elem) = head;
+        while (!remote_free.compare_exchange_weak(head, elem, std::memory_order_release, std::memory_order_relaxed));
+        remote_frees.fetch_add(1, std::memory_order_relaxed);
     }
 
+    // pool which has allocated the block, 'blocksize' must be the same as the one owner pool was created with
+    static MemoryPool* owner_of (void* elem, size_t blocksize, size_t align = 0) {
+        return segment_owner(elem, calc_segment_size(block_stride(blocksize, align)));
+    }
+
+    // chunks grow twice each time until they reach this size (in bytes), cannot be less than one segment
+    size_t max_chunk_size () const { return max_chunk_segments * segment_size; }
+    void   max_chunk_size (size_t);
+
+    // releases chunks that have no allocated blocks back to the system, returns number of released bytes. Must be called from the owner thread
+    size_t trim ();
+
+    // may be called from any thread. Every pool in the process will trim itself on its next deallocate(), pools of exited threads are trimmed immediately
+    static void request_trim_all ();
+
+    /*
+     * Pool for the current thread, shared by all callers with the same key. When thread exits, its pool is trimmed and put into orphanage,
+     * the next thread which asks for a pool of the same blocksize adopts it together with all blocks still allocated from it. Therefore threads
+     * which come and go reuse the memory instead of leaking it, and the number of pools is bounded by the peak number of threads.
+     * 'cache' (if any) is nulled on release. Thread_local destructors which run after release get a detached pool, see detached_instance().
+     */
+    static MemoryPool* thread_instance (const GlobalKey& key, size_t blocksize, size_t align = 0, MemoryPool** cache = NULL);
+
+    // releases unused chunks of orphaned pools, returns number of released bytes. May be called from any thread
+    static size_t trim_orphans ();
+
+    // counters are updated without locking and may be read from any thread at any time
+    Stats stats () const;
+
+    // stats of all pools alive in the process
+    static std::vector<Stats> all_stats ();
+
+    // writes stats of all pools followed by totals per thread and per blocksize, one record per line: "<kind> key=value key=value ..."
+    static void dump_stats (std::ostream&);
+
     ~MemoryPool ();
 
 private:
-    struct Pool {
+    /*
+     * Memory is requested from the system in chunks. Each chunk is divided into segments of the same size 'segment_size', which is a power
+     * of two depending only on blocksize, and every segment is aligned to its size. Segment starts with a header, which points to the owner pool,
+     * so that the owner of any block can be found by masking its address. Pools with equal blocksize have the same segment geometry, so any of them
+     * can find the owner of a foreign block.
+     */
+    struct Chunk {
         char*  list;
-        size_t size;
-        size_t len;
+        size_t size;  // in segments
+        size_t used;  // number of segments already split into blocks
+        size_t free;  // number of free blocks, valid only while trimming
     };
-    size_t            blocksize;
-    std::vector<Pool> pools;
-    void*             first_free;
 
-    void grow    ();
-    bool is_mine (void* elem);
+    struct Segment {
+        MemoryPool* owner;
+        Chunk*      chunk;
+    };
 
-    inline static size_t round_up (size_t size) {
+    static constexpr const size_t SEGMENT_HEADER = 16;
+    static_assert(sizeof(Segment) <= SEGMENT_HEADER, "Segment header does not fit");
+
+    size_t              blocksize;    // distance between blocks, including DEBUG_FOOTER
+    size_t              usable_size;
+    size_t              align;
+    size_t              data_offset;  // of the first block in segment, SEGMENT_HEADER or more for big alignments
+    size_t              segment_size;
+    std::vector<Chunk*> chunks;
+    size_t              max_chunk_segments;
+    void*               first_free;
+    std::atomic<void*>  remote_free;
+    uint32_t            trim_epoch;
+    std::atomic<size_t> thread;
+    std::atomic<size_t> allocs;
+    std::atomic<size_t> frees;
+    std::atomic<size_t> remote_frees;
+    std::atomic<size_t> chunks_cnt;
+    std::atomic<size_t> reserved;
+    MemoryPool*         prev_pool; // list of all alive pools
+    MemoryPool*         next_pool;
+    bool                detached;
+
+    static std::atomic<uint32_t> global_trim_epoch;
+
+    void grow            ();
+    bool reclaim         ();
+    void split_segment   (Chunk*);
+    bool is_mine         (void* elem);
+    void on_trim_request ();
+    void adopt           ();
+
+    #ifdef PANDA_MEMORY_DEBUG
+    void debug_allocated (void* elem);
+    bool debug_freed     (void* elem);
+    void debug_split     (char* elem);
+    #endif
+
+    static MemoryPool* acquire (size_t blocksize, size_t align);
+    static void        release (void* pool);
+
+    /*
+     * Shared pool for threads whose pools are already released (thread_local destructors at thread exit). It never owns blocks, so all frees
+     * go to owners by remote_deallocate(), and allocations take blocks from an orphaned pool while holding the orphanage lock.
+     */
+    static MemoryPool* detached_instance (size_t blocksize, size_t align);
+    void*              detached_allocate ();
+
+    friend struct DynamicMemoryPool;
+
+    static MemoryPool* segment_owner (void* elem, size_t segment_size) {
+        return ((Segment*)((uintptr_t)elem & ~(uintptr_t)(segment_size - 1)))->owner;
+    }
+
+    static size_t calc_segment_size (size_t blocksize);
+
+    // counters are written only by owner thread, so that atomic read-modify-write is not needed
+    static void bump (std::atomic<size_t>& cnt, ptrdiff_t val = 1) {
+        cnt.store(cnt.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+    }
+
+    static size_t block_stride (size_t blocksize, size_t align) {
+        return DEBUG_FOOTER ? round_up(round_up(blocksize, align) + DEBUG_FOOTER, align) : round_up(blocksize, align);
+    }
+
+    static size_t round_up (size_t size, size_t factor = 0) {
         assert(size > 0);
-        const size_t factor = sizeof(void*);
+        if (factor < sizeof(void*)) factor = sizeof(void*);
         if ((size & (factor-1)) == 0) return size;
         size += factor;
         size &= ~((size_t)(factor-1));
@@ -123,13 +321,25 @@ private:
     }
 };
 
-template <int BLOCKSIZE>
+template <int BLOCKSIZE, size_t ALIGN = 0>
 struct StaticMemoryPool {
-    PANDA_GLOBAL_MEMBER_PTR(StaticMemoryPool, MemoryPool*, global_instance, new MemoryPool(BLOCKSIZE));
-    PANDA_TLS_MEMBER_PTR   (StaticMemoryPool, MemoryPool*, instance,        new MemoryPool(BLOCKSIZE));
+    PANDA_GLOBAL_MEMBER_PTR(StaticMemoryPool, MemoryPool*, global_instance, new MemoryPool(BLOCKSIZE, MemoryPool::DEFAULT_MAX_CHUNK_SIZE, ALIGN));
+
+    static MemoryPool* instance () {
+        static thread_local MemoryPool* _ptr;
+        MemoryPool* ptr = _ptr;
+        if (!ptr) {
+            static const auto key = global_key<StaticMemoryPool>("instance");
+            ptr = _ptr = MemoryPool::thread_instance(key, BLOCKSIZE, ALIGN, &_ptr);
+        }
+        return ptr;
+    }
 
-    static void* allocate   ()        { return instance()->allocate(); }
-    static void  deallocate (void* p) { instance()->deallocate(p); }
+    static void*  allocate        ()                          { return instance()->allocate(); }
+    static void   deallocate      (void* p)                   { instance()->deallocate(p); }
+    static void   allocate_bulk   (size_t n, void** out)      { instance()->allocate_bulk(n, out); }
+    static void   deallocate_bulk (size_t n, void* const* ps) { instance()->deallocate_bulk(n, ps); }
+    static size_t trim            ()                          { return instance()->trim(); }
 };
 
 template <> struct StaticMemoryPool<7> : StaticMemoryPool<8> {};
@@ -144,62 +354,146 @@ template <> struct StaticMemoryPool<1> : StaticMemoryPool<8> {};
 struct DynamicMemoryPool {
     static DynamicMemoryPool* global_instance () { return _global_instance; }
 
-    PANDA_TLS_MEMBER_PTR(DynamicMemoryPool, DynamicMemoryPool*, instance, new DynamicMemoryPool());
+    // same as MemoryPool::thread_instance(): released when thread exits, adopted by new threads if it still has allocated blocks
+    static DynamicMemoryPool* instance () {
+        static thread_local DynamicMemoryPool* _ptr;
+        DynamicMemoryPool* ptr = _ptr;
+        if (!ptr) ptr = _ptr = thread_instance(&_ptr);
+        return ptr;
+    }
 
     DynamicMemoryPool ();
 
+    // blocks up to MAX_POOLED_SIZE are taken from per-size-class pools, bigger ones are mapped directly from the system
+    static constexpr const size_t MAX_POOLED_SIZE = 262144;
+
     void* allocate (size_t size) {
         if (size == 0) return NULL;
-        MemoryPool* pool;
-        if (size <= 1024) {
-            pool = small_pools[(size-1)>>2];
-            if (!pool) pool = small_pools[(size-1)>>2] = new MemoryPool((((size-1)>>2) + 1)<<2);
-        }
-        else if (size <= 16384) {
-            pool = medium_pools[(size-1)>>6];
-            if (!pool) pool = medium_pools[(size-1)>>6] = new MemoryPool((((size-1)>>6) + 1)<<6);
-        }
-        else if (size <= 262144) {
-            pool = big_pools[(size-1)>>10];
-            if (!pool) pool = big_pools[(size-1)>>10] = new MemoryPool((((size-1)>>10) + 1)<<10);
-        }
-        else throw std::invalid_argument("ObjectAllocator: object size cannot exceed 256k");
-
-        return pool->allocate();
+        if (size > MAX_POOLED_SIZE) return allocate_large(size);
+        return get_pool(size)->allocate();
     }
 
     void deallocate (void* ptr, size_t size) {
         if (ptr == NULL || size == 0) return;
-        MemoryPool* pool;
-        if      (size <= 1024)   pool = small_pools[(size-1)>>2];
-        else if (size <= 16384)  pool = medium_pools[(size-1)>>6];
-        else if (size <= 262144) pool = big_pools[(size-1)>>10];
-        else throw std::invalid_argument("ObjectAllocator: object size cannot exceed 256k");
-        pool->deallocate(ptr);
+        if (size > MAX_POOLED_SIZE) return deallocate_large(ptr, size);
+        get_pool(size)->deallocate(ptr); // pool may not exist yet if the block was allocated by another thread
+    }
+
+    // number of bytes actually reserved for a request of 'size' bytes
+    static size_t block_size (size_t size) {
+        if (size > MAX_POOLED_SIZE) return large_size(size);
+        return class_size(size_class(size));
     }
 
+    // also releases cached large mappings
+    size_t trim ();
+
+    // same as MemoryPool::trim_orphans() for orphaned DynamicMemoryPools
+    static size_t trim_orphans ();
+
     ~DynamicMemoryPool ();
 
 private:
-    static constexpr const int POOLS_CNT = 256;
+    #ifdef PANDA_MEMORY_GEOMETRIC_CLASSES
+    // 8-byte steps up to 64 bytes, then 4 classes per doubling: 80, 96, 112, 128, 160, ... Wastes at most 25% of a block
+    static constexpr const size_t CLASSES_CNT = 8 + 4 * 12;
+
+    static size_t size_class (size_t size) {
+        if (size <= 64) return (size-1) >> 3;
+        size_t log = ilog2(size-1);
+        return 8 + ((log - 6) << 2) + ((size-1) >> (log-2)) - 4;
+    }
+
+    static size_t class_size (size_t idx) {
+        if (idx < 8) return (idx+1) << 3;
+        idx -= 8;
+        size_t log = 6 + (idx >> 2);
+        return ((size_t)1 << log) + (((idx & 3) + 1) << (log-2));
+    }
+    #else
+    // 4-byte steps up to 1k, 64-byte steps up to 16k, 1k steps up to 256k
+    static constexpr const size_t CLASSES_CNT = 256 * 3;
+
+    static size_t size_class (size_t size) {
+        if (size < sizeof(void*)) size = sizeof(void*); // smaller blocks are rounded up by MemoryPool anyway, share one pool with them
+        if (size <= 1024)  return (size-1) >> 2;
+        if (size <= 16384) return 256 + ((size-1) >> 6);
+        return 512 + ((size-1) >> 10);
+    }
+
+    static size_t class_size (size_t idx) {
+        if (idx < 256) return (idx+1) << 2;
+        if (idx < 512) return (idx-255) << 6;
+        return (idx-511) << 10;
+    }
+    #endif
+
+    struct Mapping {
+        void*  ptr;
+        size_t size;
+    };
+
+    static constexpr const size_t LARGE_CACHE_CNT  = 8;
+    static constexpr const size_t LARGE_CACHE_SIZE = 32*1024*1024; // total size of cached mappings
+
     static DynamicMemoryPool* _global_instance;
-    MemoryPool* small_pools[POOLS_CNT];
-    MemoryPool* medium_pools[POOLS_CNT];
-    MemoryPool* big_pools[POOLS_CNT];
+    MemoryPool* pools[CLASSES_CNT];
+    Mapping     large_cache[LARGE_CACHE_CNT]; // recently freed mappings, the newest is the last
+    size_t      large_cache_cnt;
+    size_t      large_cache_size;
+    bool        detached; // shared by exited threads, see MemoryPool::detached_instance()
+
+    static DynamicMemoryPool* thread_instance (DynamicMemoryPool** cache);
+    static void               release         (void* pool);
+
+    void  adopt            ();
+    void* allocate_large   (size_t size);
+    void  deallocate_large (void* ptr, size_t size);
+
+    MemoryPool* get_pool (size_t size) {
+        auto idx = size_class(size);
+        MemoryPool* pool = pools[idx];
+        if (!pool) {
+            if (detached) return MemoryPool::detached_instance(class_size(idx), 0);
+            pool = pools[idx] = new MemoryPool(class_size(idx));
+        }
+        return pool;
+    }
+
+    // large blocks are rounded up to 4 classes per doubling to let cached mappings be reused for close sizes. Untouched pages cost nothing
+    static size_t large_size (size_t size) {
+        size_t step = (size_t)1 << (ilog2(size-1) - 2);
+        return (size + step - 1) & ~(step - 1);
+    }
 
+    static size_t ilog2 (size_t val) {
+        #if defined(__GNUC__) || defined(__clang__)
+        return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(val);
+        #else
+        size_t ret = 0;
+        while (val >>= 1) ++ret;
+        return ret;
+        #endif
+    }
 };
 
+namespace detail {
+    // over-aligned types get aligned pools
+    template <class T>
+    using object_pool = StaticMemoryPool<sizeof(T), (alignof(T) > sizeof(void*) ? alignof(T) : 0)>;
+}
+
 template <class TARGET, bool THREAD_SAFE = true>
 struct AllocatedObject {
     static void* operator new (size_t, void* p) { return p; }
 
     static void* operator new (size_t size) {
-        if (size == sizeof(TARGET)) return StaticMemoryPool<sizeof(TARGET)>::allocate();
+        if (size == sizeof(TARGET)) return detail::object_pool<TARGET>::allocate();
         else                        return DynamicMemoryPool::instance()->allocate(size);
     }
 
     static void operator delete (void* p, size_t size) {
-        if (size == sizeof(TARGET)) StaticMemoryPool<sizeof(TARGET)>::deallocate(p);
+        if (size == sizeof(TARGET)) detail::object_pool<TARGET>::deallocate(p);
         else                        DynamicMemoryPool::instance()->deallocate(p, size);
     }
 };
@@ -209,12 +503,12 @@ struct AllocatedObject<TARGET, false> {
     static void* operator new (size_t, void* p) { return p; }
 
     static void* operator new (size_t size) {
-        if (size == sizeof(TARGET)) return StaticMemoryPool<sizeof(TARGET)>::global_instance()->allocate();
+        if (size == sizeof(TARGET)) return detail::object_pool<TARGET>::global_instance()->allocate();
         else                        return DynamicMemoryPool::global_instance()->allocate(size);
     }
 
     static void operator delete (void* p, size_t size) {
-        if (size == sizeof(TARGET)) StaticMemoryPool<sizeof(TARGET)>::global_instance()->deallocate(p);
+        if (size == sizeof(TARGET)) detail::object_pool<TARGET>::global_instance()->deallocate(p);
         else                        DynamicMemoryPool::global_instance()->deallocate(p, size);
     }
 };
@@ -0,0 +1,238 @@
+#pragma once
+#include "hash.h"
+#include "string.h"
+#include <tuple>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+#include <initializer_list>
+
+namespace panda {
+
+/*
+ * Minimal perfect hashing (PTHash-like) for sets of keys fixed at creation.
+ *
+ * Keys are split into buckets by hash, every bucket gets a pilot, chosen so that all keys of all buckets go to distinct slots of a table
+ * of exactly n slots. Buckets are placed largest first, while the table is still empty, so pilots are found in a few tries on average.
+ * Lookup is one hash of the key, one pilot load and one key compare, no probing.
+ *
+ * static_string_map<T> is built at runtime (e.g. at startup) from a list of pairs, static_string_table<T,N> is built by compiler from a
+ * literal list with make_static_table(). Both are immutable, keys are looked up by string_view. Duplicate keys throw std::invalid_argument
+ * (compilation error for constexpr tables). Keys are hashed with hash_xxh3_64() without seed, chash64() at compile time.
+ */
+namespace perfect_hash {
+    static constexpr const size_t npos = size_t(-1);
+
+    constexpr size_t bucket_count (size_t n) { return n / 2 + 1; }
+
+    constexpr uint64_t mix (uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // multiply-shift instead of modulo, n must fit 32 bits
+    constexpr size_t bucket (uint64_t h, size_t nbuckets)   { return size_t(((h >> 32) * nbuckets) >> 32); }
+    constexpr size_t slot   (uint64_t h, uint64_t pilot, size_t n) { return size_t(((mix(h ^ pilot) >> 32) * n) >> 32); }
+
+    constexpr size_t find (uint64_t h, const uint64_t* pilots, size_t n) { return slot(h, pilots[bucket(h, bucket_count(n))], n); }
+
+    /*
+     * Finds pilots for n key hashes, so that slot_key[slot] = index of key in hashes. pilots must have room for bucket_count(n) elements,
+     * work for n + bucket_count(n) + 1. Returns false if some hashes are equal (duplicate keys).
+     * It is constexpr, so that the same code builds tables at compile time.
+     */
+    constexpr bool build (const uint64_t* hashes, size_t n, uint64_t* pilots, size_t* slot_key, size_t* work) {
+        size_t  nb    = bucket_count(n);
+        size_t* start = work;          // bucket b owns keys[start[b]..start[b+1])
+        size_t* keys  = work + nb + 1;
+
+        for (size_t b = 0; b <= nb; ++b) start[b] = 0;
+        for (size_t i = 0; i < n; ++i) ++start[bucket(hashes[i], nb) + 1];
+        size_t max_size = 0;
+        for (size_t b = 0; b < nb; ++b) {
+            if (start[b+1] > max_size) max_size = start[b+1];
+            start[b+1] += start[b];
+        }
+        for (size_t b = 0; b < nb; ++b) pilots[b] = start[b]; // as insert positions for now
+        for (size_t i = 0; i < n; ++i) keys[pilots[bucket(hashes[i], nb)]++] = i;
+        for (size_t b = 0; b < nb; ++b) pilots[b] = 0;
+        for (size_t s = 0; s < n; ++s) slot_key[s] = npos;
+
+        for (size_t size = max_size; size; --size) for (size_t b = 0; b < nb; ++b) {
+            if (start[b+1] - start[b] != size) continue;
+            const size_t* bkeys = keys + start[b];
+            for (size_t i = 0; i < size; ++i) for (size_t j = 0; j < i; ++j) if (hashes[bkeys[i]] == hashes[bkeys[j]]) return false;
+
+            for (uint64_t p = 0;; ++p) {
+                uint64_t pilot = p * 0x9e3779b97f4a7c15ULL;
+                size_t i = 0;
+                for (; i < size; ++i) {
+                    size_t s = slot(hashes[bkeys[i]], pilot, n);
+                    if (slot_key[s] != npos) break;
+                    slot_key[s] = bkeys[i];
+                }
+                if (i == size) {
+                    pilots[b] = pilot;
+                    break;
+                }
+                while (i--) slot_key[slot(hashes[bkeys[i]], pilot, n)] = npos;
+            }
+        }
+        return true;
+    }
+
+    // length is checked first, so that most of misses don't touch key bytes
+    inline bool equal (string_view a, string_view b) { return a.length() == b.length() && !memcmp(a.data(), b.data(), a.length()); }
+
+    constexpr bool cequal (string_view a, string_view b) {
+        if (a.length() != b.length()) return false;
+        for (size_t i = 0; i < a.length(); ++i) if (a[i] != b[i]) return false;
+        return true;
+    }
+}
+
+template <class T>
+class static_string_map {
+public:
+    using key_type       = string;
+    using mapped_type    = T;
+    using value_type     = std::pair<const string, T>;
+    using size_type      = size_t;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator       = const_iterator;
+
+    static_string_map () {}
+
+    // elements are pairs of anything convertible to string_view and T
+    template <class InputIt>
+    static_string_map (InputIt first, InputIt last) {
+        std::vector<std::pair<string_view, T>> list;
+        for (; first != last; ++first) list.emplace_back(first->first, first->second);
+        _build(list);
+    }
+
+    static_string_map (std::initializer_list<std::pair<string_view, T>> list) : static_string_map(list.begin(), list.end()) {}
+
+    const value_type* find (string_view key) const {
+        if (_entries.empty()) return nullptr;
+        auto& e = _entries[perfect_hash::find(hash::hash_xxh3_64(key), _pilots.data(), _entries.size())];
+        return perfect_hash::equal(e.first, key) ? &e : nullptr;
+    }
+
+    // position of key in [0, size()), the same as in iteration order, or npos
+    size_t index (string_view key) const {
+        auto e = find(key);
+        return e ? size_t(e - _entries.data()) : perfect_hash::npos;
+    }
+
+    const T& at (string_view key) const {
+        auto e = find(key);
+        if (!e) throw std::out_of_range("static_string_map::at");
+        return e->second;
+    }
+
+    size_type count    (string_view key) const { return find(key) ? 1 : 0; }
+    bool      contains (string_view key) const { return find(key); }
+
+    const_iterator begin () const { return _entries.begin(); }
+    const_iterator end   () const { return _entries.end(); }
+    size_type      size  () const { return _entries.size(); }
+    bool           empty () const { return _entries.empty(); }
+
+    static constexpr const size_t npos = perfect_hash::npos;
+
+private:
+    std::vector<value_type> _entries; // in slot order
+    std::vector<uint64_t>   _pilots;
+
+    void _build (std::vector<std::pair<string_view, T>>& list) {
+        size_t n = list.size();
+        if (!n) return;
+        if (n > UINT32_MAX) throw std::length_error("static_string_map: too many keys");
+        std::vector<uint64_t> hashes(n);
+        for (size_t i = 0; i < n; ++i) hashes[i] = hash::hash_xxh3_64(list[i].first);
+        std::vector<size_t> slot_key(n), work(n + perfect_hash::bucket_count(n) + 1);
+        _pilots.resize(perfect_hash::bucket_count(n));
+        if (!perfect_hash::build(hashes.data(), n, _pilots.data(), slot_key.data(), work.data())) {
+            throw std::invalid_argument("static_string_map: duplicate key");
+        }
+        // keys are copied, not referenced, so that short ones are stored inside entries (SSO) and compared without indirection
+        _entries.reserve(n);
+        for (auto i : slot_key) _entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(list[i].first.data(), list[i].first.length()),
+                                                      std::forward_as_tuple(std::move(list[i].second)));
+    }
+};
+
+template <class T>
+struct static_entry {
+    string_view key;
+    T           value = T();
+};
+
+// T must be a literal type to make constexpr tables
+template <class T, size_t N>
+class static_string_table {
+    static_assert(N > 0, "static_string_table must not be empty");
+public:
+    using value_type     = static_entry<T>;
+    using size_type      = size_t;
+    using const_iterator = const value_type*;
+    using iterator       = const_iterator;
+
+    constexpr static_string_table (const value_type (&list)[N]) : _entries(), _pilots() {
+        uint64_t hashes[N]   = {};
+        size_t   slot_key[N] = {};
+        size_t   work[N + perfect_hash::bucket_count(N) + 1] = {};
+        for (size_t i = 0; i < N; ++i) hashes[i] = hash::chash64(list[i].key);
+        if (!perfect_hash::build(hashes, N, _pilots, slot_key, work)) throw std::invalid_argument("static_string_table: duplicate key");
+        for (size_t s = 0; s < N; ++s) _entries[s] = list[slot_key[s]];
+    }
+
+    const value_type* find (string_view key) const {
+        auto& e = _entries[perfect_hash::find(hash::hash_xxh3_64(key), _pilots, N)];
+        return perfect_hash::equal(e.key, key) ? &e : nullptr;
+    }
+
+    // compile-time lookup, much slower than find() at runtime
+    constexpr const value_type* cfind (string_view key) const {
+        auto& e = _entries[perfect_hash::find(hash::chash64(key), _pilots, N)];
+        return perfect_hash::cequal(e.key, key) ? &e : nullptr;
+    }
+
+    // position of key in [0, size()), the same as in iteration order, or npos
+    size_t index (string_view key) const {
+        auto e = find(key);
+        return e ? size_t(e - _entries) : perfect_hash::npos;
+    }
+
+    const T& at (string_view key) const {
+        auto e = find(key);
+        if (!e) throw std::out_of_range("static_string_table::at");
+        return e->value;
+    }
+
+    size_type count    (string_view key) const { return find(key) ? 1 : 0; }
+    bool      contains (string_view key) const { return find(key); }
+
+    constexpr const_iterator begin () const { return _entries; }
+    constexpr const_iterator end   () const { return _entries + N; }
+    constexpr size_type      size  () const { return N; }
+    constexpr bool           empty () const { return false; }
+
+    static constexpr const size_t npos = perfect_hash::npos;
+
+private:
+    value_type _entries[N]; // in slot order
+    uint64_t   _pilots[perfect_hash::bucket_count(N)];
+};
+
+// constexpr auto table = make_static_table<int>({{"GET", 1}, {"POST", 2}});
+template <class T, size_t N>
+constexpr static_string_table<T, N> make_static_table (const static_entry<T> (&list)[N]) { return static_string_table<T, N>(list); }
+
+}
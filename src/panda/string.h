@@ -7,6 +7,9 @@ namespace panda {
     typedef basic_string<char16_t> u16string;
     typedef basic_string<char32_t> u32string;
 
+    // string with atomic refcounter, copies of the same buffer may be owned by different threads
+    typedef basic_string<char, std::char_traits<char>, SharedStaticAllocator<char>> shared_string;
+
     namespace {
         template <typename T>
         inline T _stox (const string& str, std::size_t* pos = 0, int base = 10) {
@@ -35,4 +38,24 @@ namespace panda {
     inline string to_string (unsigned value)           { return string::from_number(value); }
     inline string to_string (unsigned long value)      { return string::from_number(value); }
     inline string to_string (unsigned long long value) { return string::from_number(value); }
+    inline string to_string (float value)              { return string::from_number(value); }
+    inline string to_string (double value)             { return string::from_number(value); }
+
+    inline float stof (const string& str, std::size_t* pos = 0) {
+        float val;
+        auto res = str.to_number(val);
+        if (pos) *pos = res.ptr - str.data();
+        if (res.ec == std::errc::invalid_argument) throw std::invalid_argument("stof");
+        if (res.ec == std::errc::result_out_of_range) throw std::out_of_range("stof");
+        return val;
+    }
+
+    inline double stod (const string& str, std::size_t* pos = 0) {
+        double val;
+        auto res = str.to_number(val);
+        if (pos) *pos = res.ptr - str.data();
+        if (res.ec == std::errc::invalid_argument) throw std::invalid_argument("stod");
+        if (res.ec == std::errc::result_out_of_range) throw std::out_of_range("stod");
+        return val;
+    }
 }
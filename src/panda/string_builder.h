@@ -0,0 +1,135 @@
+#pragma once
+#include "string.h"
+#include <vector>
+
+namespace panda {
+
+/*
+ * Collects string fragments without copying them: strings are kept by reference (COW copies, only refcounters are bumped), so that
+ * substrings of request buffers, literals and externals cost nothing to add. Small pieces which can't be referenced (views, chars) are
+ * coalesced into a fragment owned by builder.
+ * Result is either flattened once into an exact-size buffer by str() or exported as iovec list by to_iovec() for writev().
+ */
+template <class CharT, class Traits = std::char_traits<CharT>, class Alloc = DefaultStaticAllocator<CharT>>
+struct basic_string_builder {
+    using string_type = basic_string<CharT, Traits, Alloc>;
+    using view_type   = basic_string_view<CharT, Traits>;
+    using size_type   = typename string_type::size_type;
+
+    basic_string_builder () : _length(0), _own_tail(false) {}
+
+    basic_string_builder& append (const string_type& str) {
+        if (!str.length()) return *this;
+        _fragments.push_back(str);
+        _length += str.length();
+        _own_tail = false;
+        return *this;
+    }
+
+    basic_string_builder& append (string_type&& str) {
+        if (!str.length()) return *this;
+        _length += str.length();
+        _fragments.push_back(std::move(str));
+        _own_tail = false;
+        return *this;
+    }
+
+    // content is copied
+    basic_string_builder& append (view_type sv) {
+        if (!sv.length()) return *this;
+        if (_own_tail) _fragments.back().append(sv);
+        else {
+            _fragments.push_back(string_type(sv));
+            _own_tail = true;
+        }
+        _length += sv.length();
+        return *this;
+    }
+
+    basic_string_builder& append (const CharT* s, size_type len) { return append(view_type(s, len)); }
+    basic_string_builder& append (CharT ch)                       { return append(view_type(&ch, 1)); }
+
+    template <class _CharT, typename = typename std::enable_if<std::is_same<_CharT, CharT>::value>::type>
+    basic_string_builder& append (const _CharT* const& s) { return append(view_type(s)); }
+
+    // literal is referenced
+    template <size_type SIZE>
+    basic_string_builder& append (const CharT (&s)[SIZE]) { return append(string_type(s)); }
+
+    // non-const array is a buffer, not a literal: copied up to the terminating zero
+    template <size_type SIZE>
+    basic_string_builder& append (CharT (&s)[SIZE]) { return append(view_type(s, Traits::length(s))); }
+
+    template <class T>
+    basic_string_builder& operator+= (T&& val) { return append(std::forward<T>(val)); }
+
+    template <class T>
+    basic_string_builder& operator<< (T&& val) { return append(std::forward<T>(val)); }
+
+    size_type length () const { return _length; }
+    size_type size   () const { return _length; }
+    bool      empty  () const { return !_length; }
+
+    const std::vector<string_type>& fragments () const { return _fragments; }
+
+    // single fragment is returned as is, otherwise it is one allocation of exact size
+    string_type str () const {
+        if (_fragments.size() == 1) return _fragments.front();
+        string_type ret(_length);
+        auto buf = const_cast<CharT*>(ret.data()); // avoid checks for detach
+        for (auto& f : _fragments) {
+            Traits::copy(buf, f.data(), f.length());
+            buf += f.length();
+        }
+        ret.length(_length);
+        return ret;
+    }
+
+    /*
+     * Fills up to `cnt` elements of iov (struct iovec or anything with iov_base and iov_len fields) starting from byte `offset`,
+     * returns number of elements filled. Builder must not be changed while iov is in use.
+     */
+    template <class IOV>
+    size_t to_iovec (IOV* iov, size_t cnt, size_type offset = 0) const {
+        size_t n = 0;
+        for (auto& f : _fragments) {
+            if (n == cnt) break;
+            if (offset >= f.length()) {
+                offset -= f.length();
+                continue;
+            }
+            iov[n].iov_base = (void*)(f.data() + offset);
+            iov[n].iov_len  = (f.length() - offset) * sizeof(CharT);
+            offset = 0;
+            ++n;
+        }
+        return n;
+    }
+
+    // drops `len` chars from the beginning, e.g. what was written by writev()
+    void consume (size_type len) {
+        if (len >= _length) return clear();
+        _length -= len;
+        size_t i = 0;
+        for (; len >= _fragments[i].length(); ++i) len -= _fragments[i].length();
+        if (len) _fragments[i] = _fragments[i].substr(len);
+        _fragments.erase(_fragments.begin(), _fragments.begin() + i);
+    }
+
+    void clear () {
+        _fragments.clear();
+        _length   = 0;
+        _own_tail = false;
+    }
+
+    void reserve (size_t fragments) { _fragments.reserve(fragments); }
+
+private:
+    std::vector<string_type> _fragments;
+    size_type                _length;
+    bool                     _own_tail; // last fragment was created by builder and may be appended to
+};
+
+using string_builder = basic_string_builder<char>;
+
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "string.h"
+#include <deque>
+#include <vector>
+#include <iterator>
+
+#ifdef _WIN32
+namespace panda {
+    struct iovec {
+        void*  iov_base;
+        size_t iov_len;
+    };
+}
+#else
+#  include <sys/uio.h>
+#endif
+
+namespace panda {
+
+/*
+ * Scatter-gather I/O with strings without concatenating or copying them.
+ *
+ * Output: basic_string_iovec keeps copies of strings (COW ones just bump refcounters, SSO ones are copied into stored objects, which never
+ * move) together with iovec array pointing to data of stored copies, so strings stay alive until write completes even if caller's ones
+ * are changed or destroyed. After partial writev() call consume().
+ *
+ * Input: adopt_iovec() makes EXTERNAL strings from buffers filled by readv() and slice() cuts a string into COW substrings, so that
+ * parsers may keep pieces of received data without copying.
+ */
+template <class String>
+struct basic_string_iovec {
+    using string_type = String;
+    using size_type   = typename String::size_type;
+
+    basic_string_iovec () : _pos(0), _length(0) {}
+
+    template <class It>
+    basic_string_iovec (It begin, It end) : basic_string_iovec() {
+        _iov.reserve(std::distance(begin, end));
+        for (; begin != end; ++begin) add(*begin);
+    }
+
+    basic_string_iovec (std::initializer_list<String> list) : basic_string_iovec(list.begin(), list.end()) {}
+
+    // copies of SSO strings have their own buffers, so iovecs are rebased onto them
+    basic_string_iovec (const basic_string_iovec& oth) : _strings(oth._strings), _iov(oth._iov), _pos(oth._pos), _length(oth._length) {
+        for (size_t i = _pos; i < _iov.size(); ++i) {
+            auto offset = (const char*)oth._iov[i].iov_base - (const char*)oth._strings[i].data();
+            _iov[i].iov_base = (char*)_strings[i].data() + offset;
+        }
+    }
+
+    basic_string_iovec (basic_string_iovec&&) = default;
+
+    basic_string_iovec& operator= (const basic_string_iovec& oth) {
+        if (this != &oth) *this = basic_string_iovec(oth);
+        return *this;
+    }
+
+    basic_string_iovec& operator= (basic_string_iovec&&) = default;
+
+    void add (const String& str) {
+        if (!str.length()) return;
+        _strings.push_back(str);
+        _length += str.length();
+        _iov.push_back(iovec{(void*)_strings.back().data(), str.length() * sizeof(typename String::value_type)});
+    }
+
+    // pointers stay valid until object is changed or destroyed
+    const iovec* data   () const { return _iov.data() + _pos; }
+    size_t       size   () const { return _iov.size() - _pos; }
+    bool         empty  () const { return _pos == _iov.size(); }
+    size_type    length () const { return _length; } // chars left
+
+    // marks `bytes` as written, strings which are fully written are released
+    void consume (size_t bytes) {
+        const size_t csize = sizeof(typename String::value_type);
+        _length -= std::min<size_t>(bytes / csize, _length);
+        while (bytes && _pos < _iov.size()) {
+            auto& v = _iov[_pos];
+            if (bytes < v.iov_len) {
+                v.iov_base = (char*)v.iov_base + bytes;
+                v.iov_len -= bytes;
+                return;
+            }
+            bytes -= v.iov_len;
+            _strings[_pos] = String();
+            ++_pos;
+        }
+        if (_pos == _iov.size()) clear();
+    }
+
+    void clear () {
+        _strings.clear();
+        _iov.clear();
+        _pos    = 0;
+        _length = 0;
+    }
+
+private:
+    std::deque<String>  _strings; // elements never move, so iovecs may point into SSO buffers
+    std::vector<iovec>  _iov;
+    size_t              _pos;
+    size_type           _length;
+};
+
+using string_iovec = basic_string_iovec<string>;
+
+// fills up to `cnt` iovecs with data of strings from range, strings must stay alive and unchanged while iovecs are in use
+template <class It>
+size_t to_iovec (It begin, It end, iovec* iov, size_t cnt) {
+    size_t n = 0;
+    for (; begin != end && n < cnt; ++begin) {
+        auto& str = *begin;
+        if (!str.length()) continue;
+        iov[n].iov_base = (void*)str.data();
+        iov[n].iov_len  = str.length() * sizeof(*str.data());
+        ++n;
+    }
+    return n;
+}
+
+/*
+ * Makes strings from buffers after readv() returned `bytes`: each buffer which got data becomes EXTERNAL string owning it
+ * and freed by dtor(ptr, capacity) when last COW copy dies, buffers without data are freed right away.
+ */
+template <class String = string>
+std::vector<String> adopt_iovec (const iovec* iov, size_t cnt, size_t bytes, void (*dtor)(typename String::value_type*, size_t)) {
+    using CharT = typename String::value_type;
+    std::vector<String> ret;
+    ret.reserve(cnt);
+    for (size_t i = 0; i < cnt; ++i) {
+        auto capacity = iov[i].iov_len / sizeof(CharT);
+        auto len      = std::min(bytes, iov[i].iov_len) / sizeof(CharT);
+        bytes -= len * sizeof(CharT);
+        if (len) ret.push_back(String((CharT*)iov[i].iov_base, len, capacity, dtor));
+        else     dtor((CharT*)iov[i].iov_base, capacity);
+    }
+    return ret;
+}
+
+// cuts string into pieces of given lengths without copying, the rest (if any) is the last piece
+template <class String, class Lengths>
+std::vector<String> slice (const String& str, const Lengths& lengths) {
+    std::vector<String> ret;
+    typename String::size_type pos = 0;
+    for (auto len : lengths) {
+        if (pos >= str.length()) return ret;
+        ret.push_back(str.substr(pos, len));
+        pos += ret.back().length();
+    }
+    if (pos < str.length()) ret.push_back(str.substr(pos));
+    return ret;
+}
+
+template <class String>
+std::vector<String> slice (const String& str, std::initializer_list<typename String::size_type> lengths) {
+    return slice<String, std::initializer_list<typename String::size_type>>(str, lengths);
+}
+
+}
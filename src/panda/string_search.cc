@@ -0,0 +1,342 @@
+#include "string_search.h"
+#include <string.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define PANDA_SEARCH_X86 1
+#  include <immintrin.h>
+#  define PANDA_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace panda { namespace string_search {
+
+namespace {
+
+struct Bitmap {
+    uint64_t bits[4];
+
+    Bitmap (const char* set, size_t len) : bits() {
+        for (size_t i = 0; i < len; ++i) {
+            unsigned char c = set[i];
+            bits[c >> 6] |= uint64_t(1) << (c & 63);
+        }
+    }
+
+    bool has (unsigned char c) const { return (bits[c >> 6] >> (c & 63)) & 1; }
+};
+
+size_t scalar_find (const char* s, size_t len, const char* needle, size_t nlen) {
+    if (nlen > len) return npos;
+    const char* end = s + len - nlen + 1; // after the last possible start
+    for (const char* p = s; p < end; ++p) {
+        p = (const char*)memchr(p, needle[0], end - p);
+        if (!p) return npos;
+        if (memcmp(p + 1, needle + 1, nlen - 1) == 0) return p - s;
+    }
+    return npos;
+}
+
+size_t scalar_rfind (const char* s, size_t len, const char* needle, size_t nlen) {
+    if (nlen > len) return npos;
+    for (const char* p = s + len - nlen;; --p) {
+        if (*p == needle[0] && memcmp(p + 1, needle + 1, nlen - 1) == 0) return p - s;
+        if (p == s) return npos;
+    }
+}
+
+size_t scalar_rfind_char (const char* s, size_t len, char ch) {
+    for (const char* p = s + len; p-- > s;) if (*p == ch) return p - s;
+    return npos;
+}
+
+size_t scalar_find_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    if (setlen == 1) {
+        for (size_t i = 0; i < len; ++i) if ((s[i] == set[0]) != negate) return i;
+        return npos;
+    }
+    Bitmap bm(set, setlen);
+    for (size_t i = 0; i < len; ++i) if (bm.has(s[i]) != negate) return i;
+    return npos;
+}
+
+size_t scalar_rfind_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    if (setlen == 1) {
+        for (size_t i = len; i-- > 0;) if ((s[i] == set[0]) != negate) return i;
+        return npos;
+    }
+    Bitmap bm(set, setlen);
+    for (size_t i = len; i-- > 0;) if (bm.has(s[i]) != negate) return i;
+    return npos;
+}
+
+inline size_t shifted (size_t ret, size_t offset) { return ret == npos ? npos : ret + offset; }
+
+#ifdef PANDA_SEARCH_X86
+
+inline unsigned lowest_bit  (uint32_t mask) { return __builtin_ctz(mask); }
+inline unsigned highest_bit (uint32_t mask) { return 31 - __builtin_clz(mask); }
+
+/* SSE2 */
+
+PANDA_TARGET("sse2")
+size_t sse2_rfind_char (const char* s, size_t len, char ch) {
+    const __m128i c = _mm_set1_epi8(ch);
+    for (; len >= 16; len -= 16) {
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + len - 16)), c));
+        if (mask) return len - 16 + highest_bit(mask);
+    }
+    return scalar_rfind_char(s, len, ch);
+}
+
+PANDA_TARGET("sse2")
+size_t sse2_find (const char* s, size_t len, const char* needle, size_t nlen) {
+    if (nlen > len) return npos;
+    if (nlen == 1) {
+        auto p = (const char*)memchr(s, needle[0], len);
+        return p ? p - s : npos;
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last  = _mm_set1_epi8(needle[nlen-1]);
+    const size_t  cnt   = len - nlen + 1; // number of possible starts
+    size_t i = 0;
+    for (; i + 16 <= cnt; i += 16) {
+        __m128i bf = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + i)), first);
+        __m128i bl = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + i + nlen - 1)), last);
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(bf, bl));
+        for (; mask; mask &= mask - 1) {
+            size_t pos = i + lowest_bit(mask);
+            if (memcmp(s + pos + 1, needle + 1, nlen - 2) == 0) return pos;
+        }
+    }
+    return shifted(scalar_find(s + i, len - i, needle, nlen), i);
+}
+
+PANDA_TARGET("sse2")
+size_t sse2_rfind (const char* s, size_t len, const char* needle, size_t nlen) {
+    if (nlen > len) return npos;
+    if (nlen == 1) return sse2_rfind_char(s, len, needle[0]);
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last  = _mm_set1_epi8(needle[nlen-1]);
+    size_t cnt = len - nlen + 1; // starts [0, cnt) are not checked yet
+    for (; cnt >= 16; cnt -= 16) {
+        size_t i = cnt - 16;
+        __m128i bf = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + i)), first);
+        __m128i bl = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(s + i + nlen - 1)), last);
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(bf, bl));
+        while (mask) {
+            unsigned bit = highest_bit(mask);
+            if (memcmp(s + i + bit + 1, needle + 1, nlen - 2) == 0) return i + bit;
+            mask &= ~(uint32_t(1) << bit);
+        }
+    }
+    return scalar_rfind(s, cnt + nlen - 1, needle, nlen);
+}
+
+// small sets are compared char by char, bigger ones fall back to bitmap
+static constexpr const size_t SSE2_MAX_SET = 16;
+
+PANDA_TARGET("sse2")
+inline uint32_t sse2_set_mask (__m128i block, const __m128i* set, size_t setlen, bool negate) {
+    __m128i m = _mm_cmpeq_epi8(block, set[0]);
+    for (size_t j = 1; j < setlen; ++j) m = _mm_or_si128(m, _mm_cmpeq_epi8(block, set[j]));
+    uint32_t mask = _mm_movemask_epi8(m);
+    return negate ? ~mask & 0xFFFF : mask;
+}
+
+PANDA_TARGET("sse2")
+size_t sse2_find_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    if (setlen > SSE2_MAX_SET) return scalar_find_of(s, len, set, setlen, negate);
+    __m128i vset[SSE2_MAX_SET];
+    for (size_t j = 0; j < setlen; ++j) vset[j] = _mm_set1_epi8(set[j]);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint32_t mask = sse2_set_mask(_mm_loadu_si128((const __m128i*)(s + i)), vset, setlen, negate);
+        if (mask) return i + lowest_bit(mask);
+    }
+    return shifted(scalar_find_of(s + i, len - i, set, setlen, negate), i);
+}
+
+PANDA_TARGET("sse2")
+size_t sse2_rfind_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    if (setlen > SSE2_MAX_SET) return scalar_rfind_of(s, len, set, setlen, negate);
+    __m128i vset[SSE2_MAX_SET];
+    for (size_t j = 0; j < setlen; ++j) vset[j] = _mm_set1_epi8(set[j]);
+    for (; len >= 16; len -= 16) {
+        uint32_t mask = sse2_set_mask(_mm_loadu_si128((const __m128i*)(s + len - 16)), vset, setlen, negate);
+        if (mask) return len - 16 + highest_bit(mask);
+    }
+    return scalar_rfind_of(s, len, set, setlen, negate);
+}
+
+/* AVX2 */
+
+PANDA_TARGET("avx2")
+size_t avx2_rfind_char (const char* s, size_t len, char ch) {
+    const __m256i c = _mm256_set1_epi8(ch);
+    for (; len >= 32; len -= 32) {
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + len - 32)), c));
+        if (mask) return len - 32 + highest_bit(mask);
+    }
+    return sse2_rfind_char(s, len, ch);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_find (const char* s, size_t len, const char* needle, size_t nlen) {
+    if (nlen > len) return npos;
+    if (nlen == 1) {
+        auto p = (const char*)memchr(s, needle[0], len);
+        return p ? p - s : npos;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last  = _mm256_set1_epi8(needle[nlen-1]);
+    const size_t  cnt   = len - nlen + 1;
+    size_t i = 0;
+    for (; i + 32 <= cnt; i += 32) {
+        __m256i bf = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + i)), first);
+        __m256i bl = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + i + nlen - 1)), last);
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(bf, bl));
+        for (; mask; mask &= mask - 1) {
+            size_t pos = i + lowest_bit(mask);
+            if (memcmp(s + pos + 1, needle + 1, nlen - 2) == 0) return pos;
+        }
+    }
+    return shifted(sse2_find(s + i, len - i, needle, nlen), i);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_rfind (const char* s, size_t len, const char* needle, size_t nlen) {
+    if (nlen > len) return npos;
+    if (nlen == 1) return avx2_rfind_char(s, len, needle[0]);
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last  = _mm256_set1_epi8(needle[nlen-1]);
+    size_t cnt = len - nlen + 1;
+    for (; cnt >= 32; cnt -= 32) {
+        size_t i = cnt - 32;
+        __m256i bf = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + i)), first);
+        __m256i bl = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + i + nlen - 1)), last);
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(bf, bl));
+        while (mask) {
+            unsigned bit = highest_bit(mask);
+            if (memcmp(s + i + bit + 1, needle + 1, nlen - 2) == 0) return i + bit;
+            mask &= ~(uint32_t(1) << bit);
+        }
+    }
+    return sse2_rfind(s, cnt + nlen - 1, needle, nlen);
+}
+
+/*
+ * Set of any size as two 16x8 bit tables indexed by low nibble of char, bit N means that char with high nibble N (or N+8 for hi table) is in set.
+ * Both tables and the bit for high nibble are fetched with vpshufb, so one block of 32 chars costs a few instructions regardless of set size.
+ */
+struct NibbleSet {
+    __m256i lo_tbl;
+    __m256i hi_tbl;
+
+    PANDA_TARGET("avx2")
+    NibbleSet (const char* set, size_t setlen) {
+        uint8_t lo[16] = {}, hi[16] = {};
+        for (size_t j = 0; j < setlen; ++j) {
+            unsigned char c = set[j];
+            if (c < 128) lo[c & 15] |= 1 << (c >> 4);
+            else         hi[c & 15] |= 1 << ((c >> 4) - 8);
+        }
+        lo_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)lo));
+        hi_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)hi));
+    }
+
+    // bit is set for every char not in set
+    PANDA_TARGET("avx2")
+    uint32_t missing (__m256i block) const {
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i lo_bit = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i hi_bit = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128);
+        __m256i lo = _mm256_and_si256(block, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+        __m256i m  = _mm256_or_si256(
+            _mm256_and_si256(_mm256_shuffle_epi8(lo_tbl, lo), _mm256_shuffle_epi8(lo_bit, hi)),
+            _mm256_and_si256(_mm256_shuffle_epi8(hi_tbl, lo), _mm256_shuffle_epi8(hi_bit, hi))
+        );
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(m, _mm256_setzero_si256()));
+    }
+};
+
+PANDA_TARGET("avx2")
+size_t avx2_find_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    if (len < 32) return sse2_find_of(s, len, set, setlen, negate);
+    NibbleSet ns(set, setlen);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint32_t mask = ns.missing(_mm256_loadu_si256((const __m256i*)(s + i)));
+        if (!negate) mask = ~mask;
+        if (mask) return i + lowest_bit(mask);
+    }
+    return shifted(scalar_find_of(s + i, len - i, set, setlen, negate), i);
+}
+
+PANDA_TARGET("avx2")
+size_t avx2_rfind_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    if (len < 32) return sse2_rfind_of(s, len, set, setlen, negate);
+    NibbleSet ns(set, setlen);
+    for (; len >= 32; len -= 32) {
+        uint32_t mask = ns.missing(_mm256_loadu_si256((const __m256i*)(s + len - 32)));
+        if (!negate) mask = ~mask;
+        if (mask) return len - 32 + highest_bit(mask);
+    }
+    return scalar_rfind_of(s, len, set, setlen, negate);
+}
+
+#endif
+
+struct Kernels {
+    Level  level;
+    size_t (*find)       (const char*, size_t, const char*, size_t);
+    size_t (*rfind)      (const char*, size_t, const char*, size_t);
+    size_t (*rfind_char) (const char*, size_t, char);
+    size_t (*find_of)    (const char*, size_t, const char*, size_t, bool);
+    size_t (*rfind_of)   (const char*, size_t, const char*, size_t, bool);
+};
+
+Kernels make_kernels (Level level) {
+    if (level > max_level()) level = max_level();
+    switch (level) {
+        #ifdef PANDA_SEARCH_X86
+        case Level::AVX2: return {level, avx2_find, avx2_rfind, avx2_rfind_char, avx2_find_of, avx2_rfind_of};
+        case Level::SSE2: return {level, sse2_find, sse2_rfind, sse2_rfind_char, sse2_find_of, sse2_rfind_of};
+        #endif
+        default: return {Level::SCALAR, scalar_find, scalar_rfind, scalar_rfind_char, scalar_find_of, scalar_rfind_of};
+    }
+}
+
+Kernels& kernels () {
+    static Kernels ret = make_kernels(max_level());
+    return ret;
+}
+
+}
+
+size_t find (const char* s, size_t len, const char* needle, size_t nlen) { return kernels().find(s, len, needle, nlen); }
+size_t rfind (const char* s, size_t len, const char* needle, size_t nlen) { return kernels().rfind(s, len, needle, nlen); }
+size_t rfind_char (const char* s, size_t len, char ch) { return kernels().rfind_char(s, len, ch); }
+
+size_t find_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    return kernels().find_of(s, len, set, setlen, negate);
+}
+
+size_t rfind_of (const char* s, size_t len, const char* set, size_t setlen, bool negate) {
+    return kernels().rfind_of(s, len, set, setlen, negate);
+}
+
+Level level () { return kernels().level; }
+
+Level max_level () {
+    #ifdef PANDA_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+    #endif
+    return Level::SCALAR;
+}
+
+void set_level (Level level) { kernels() = make_kernels(level); }
+
+}}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <type_traits>
+
+namespace panda { namespace string_search {
+
+/*
+ * Search kernels for 1-byte strings, used by basic_string and basic_string_view with standard char traits.
+ * Implementation is chosen on first use by CPU features: AVX2, SSE2 or portable code.
+ * Substring search compares first and last chars of needle against a whole vector of positions and only checks the middle for candidates;
+ * find_of/rfind_of look chars up in a 256-bit set instead of scanning the set for every char.
+ * All functions return offset from `s` or npos.
+ */
+
+static constexpr const size_t npos = size_t(-1);
+
+enum class Level { SCALAR, SSE2, AVX2 };
+
+size_t find       (const char* s, size_t len, const char* needle, size_t nlen); // nlen > 0
+size_t rfind      (const char* s, size_t len, const char* needle, size_t nlen); // nlen > 0, last occurence which fits in [s, s+len)
+size_t rfind_char (const char* s, size_t len, char ch);
+
+// first/last char which is in set (or is not in set if `negate`)
+size_t find_of  (const char* s, size_t len, const char* set, size_t setlen, bool negate = false);
+size_t rfind_of (const char* s, size_t len, const char* set, size_t setlen, bool negate = false);
+
+Level level     (); // implementation in use
+Level max_level (); // best one supported by CPU
+void  set_level (Level); // for tests and benchmarks, not thread-safe. Levels above max_level() are lowered.
+
+// whether basic_string<CharT, Traits> and basic_string_view<CharT, Traits> may use kernels
+template <class CharT, class Traits>
+struct enabled : std::integral_constant<bool, sizeof(CharT) == 1 && std::is_same<Traits, std::char_traits<CharT>>::value> {};
+
+}}
@@ -0,0 +1,56 @@
+#include "../basic_string.h"
+#include <system_error>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace panda { namespace string_detail {
+
+char* mmap_file (basic_string_view<char> path, size_t& size, int advice) {
+    std::string p(path.data(), path.length());
+    int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK); // FIFO would block in open() until a writer comes
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + p);
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat " + p);
+    }
+
+    // devices, pipes, etc report no or fake size and can't be mapped
+    if (!S_ISREG(st.st_mode)) {
+        ::close(fd);
+        throw std::system_error(S_ISDIR(st.st_mode) ? EISDIR : ENODEV, std::generic_category(), "mmap " + p + ": not a regular file");
+    }
+
+    size = st.st_size;
+    if (!size) {
+        // pseudo files (/proc, /sys) are regular but report zero size while having content
+        char c;
+        auto got = ::read(fd, &c, 1);
+        ::close(fd);
+        if (got > 0) throw std::system_error(ENODEV, std::generic_category(), "mmap " + p + ": file size is unknown");
+        return NULL;
+    }
+
+    // private writable mapping: string may be modified in place (COW pages), file never changes
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd); // mapping keeps file referenced
+    if (ptr == MAP_FAILED) throw std::system_error(err, std::generic_category(), "mmap " + p);
+
+    if (advice & basic_string<char>::MMAP_SEQUENTIAL) madvise(ptr, size, MADV_SEQUENTIAL);
+    if (advice & basic_string<char>::MMAP_RANDOM)     madvise(ptr, size, MADV_RANDOM);
+    if (advice & basic_string<char>::MMAP_WILLNEED)   madvise(ptr, size, MADV_WILLNEED);
+
+    return (char*)ptr;
+}
+
+void munmap_file (char* ptr, size_t size) {
+    munmap(ptr, size);
+}
+
+}}
@@ -2,6 +2,7 @@
 #include "string.h"
 #include "string_view.h"
 #include <memory>
+#include <assert.h>
 #include <functional>
 #include <unordered_map>
 
@@ -31,6 +32,18 @@ namespace panda {
             tmp.length(key.length());
             return tmp;
         }
+
+        // all of libstdc++, libc++ and MSVC map hash to bucket like this (prime modulo or power of 2 mask, which is the same)
+        // debug builds check it (and that caller passed hash of the container's hasher) with the usual lookup
+        template <class Self>
+        static auto _find_hashed (Self& self, const Key& key, size_t hash) -> decltype(&*self.begin(0)) {
+            if (self.empty()) return nullptr;
+            auto n = hash % self.bucket_count();
+            assert(self.bucket(key) == n && "find_hashed: wrong hash or bucket isn't hash % bucket_count()");
+            auto eq = self.key_eq();
+            for (auto it = self.begin(n), end = self.end(n); it != end; ++it) if (eq(it->first, key)) return &*it;
+            return nullptr;
+        }
     public:
         using typename Base::key_type;
         using typename Base::mapped_type;
@@ -80,6 +93,19 @@ namespace panda {
         template <class X, typename = typename std::enable_if<std::is_same<X,SVKey>::value>::type>
         std::pair<const_iterator,const_iterator> equal_range (X key) const { return equal_range(_key_from_sv(key)); }
 
+        /*
+         * Lookup with hash calculated in advance, it must be equal to hash_function()(key), i.e. for default hasher it is
+         * hash::hashXX<size_t>(key) or compile-time "key"_h. Returns pointer to element (any of equal ones) or nullptr.
+         */
+        value_type*       find_hashed (const Key& key, size_t hash)       { return _find_hashed(*this, key, hash); }
+        const value_type* find_hashed (const Key& key, size_t hash) const { return _find_hashed(*this, key, hash); }
+
+        template <class X, typename = typename std::enable_if<std::is_same<X,SVKey>::value>::type>
+        value_type* find_hashed (X key, size_t hash) { return _find_hashed(*this, _key_from_sv(key), hash); }
+
+        template <class X, typename = typename std::enable_if<std::is_same<X,SVKey>::value>::type>
+        const value_type* find_hashed (X key, size_t hash) const { return _find_hashed(*this, _key_from_sv(key), hash); }
+
     };
 
     template <class Key, class T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
@@ -101,6 +127,18 @@ namespace panda {
             tmp.length(key.length());
             return tmp;
         }
+
+        // all of libstdc++, libc++ and MSVC map hash to bucket like this (prime modulo or power of 2 mask, which is the same)
+        // debug builds check it (and that caller passed hash of the container's hasher) with the usual lookup
+        template <class Self>
+        static auto _find_hashed (Self& self, const Key& key, size_t hash) -> decltype(&*self.begin(0)) {
+            if (self.empty()) return nullptr;
+            auto n = hash % self.bucket_count();
+            assert(self.bucket(key) == n && "find_hashed: wrong hash or bucket isn't hash % bucket_count()");
+            auto eq = self.key_eq();
+            for (auto it = self.begin(n), end = self.end(n); it != end; ++it) if (eq(it->first, key)) return &*it;
+            return nullptr;
+        }
     public:
         using typename Base::key_type;
         using typename Base::mapped_type;
@@ -143,6 +181,19 @@ namespace panda {
         template <class X, typename = typename std::enable_if<std::is_same<X,SVKey>::value>::type>
         std::pair<const_iterator,const_iterator> equal_range (X key) const { return equal_range(_key_from_sv(key)); }
 
+        /*
+         * Lookup with hash calculated in advance, it must be equal to hash_function()(key), i.e. for default hasher it is
+         * hash::hashXX<size_t>(key) or compile-time "key"_h. Returns pointer to element (any of equal ones) or nullptr.
+         */
+        value_type*       find_hashed (const Key& key, size_t hash)       { return _find_hashed(*this, key, hash); }
+        const value_type* find_hashed (const Key& key, size_t hash) const { return _find_hashed(*this, key, hash); }
+
+        template <class X, typename = typename std::enable_if<std::is_same<X,SVKey>::value>::type>
+        value_type* find_hashed (X key, size_t hash) { return _find_hashed(*this, _key_from_sv(key), hash); }
+
+        template <class X, typename = typename std::enable_if<std::is_same<X,SVKey>::value>::type>
+        const value_type* find_hashed (X key, size_t hash) const { return _find_hashed(*this, _key_from_sv(key), hash); }
+
     };
 
 }
@@ -0,0 +1,64 @@
+#include "../basic_string.h"
+#include <system_error>
+#include <windows.h>
+
+namespace panda { namespace string_detail {
+
+static std::system_error last_error (const std::string& what) {
+    return std::system_error(GetLastError(), std::system_category(), what);
+}
+
+char* mmap_file (basic_string_view<char> path, size_t& size, int advice) {
+    std::string p(path.data(), path.length());
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (advice & basic_string<char>::MMAP_SEQUENTIAL) flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    if (advice & basic_string<char>::MMAP_RANDOM)     flags |= FILE_FLAG_RANDOM_ACCESS;
+
+    HANDLE file = CreateFileA(p.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, flags, NULL);
+    if (file == INVALID_HANDLE_VALUE) throw last_error("open " + p);
+
+    if (GetFileType(file) != FILE_TYPE_DISK) {
+        CloseHandle(file);
+        throw std::system_error(ERROR_BAD_FILE_TYPE, std::system_category(), "mmap " + p + ": not a regular file");
+    }
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(file, &fsize)) {
+        auto err = last_error("stat " + p);
+        CloseHandle(file);
+        throw err;
+    }
+
+    size = (size_t)fsize.QuadPart;
+    if (!size) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    // copy-on-write view: string may be modified in place, file never changes
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!mapping) {
+        auto err = last_error("mmap " + p);
+        CloseHandle(file);
+        throw err;
+    }
+
+    void* ptr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, size);
+    auto err = last_error("mmap " + p);
+    CloseHandle(mapping); // view keeps mapping and file referenced
+    CloseHandle(file);
+    if (!ptr) throw err;
+
+    if (advice & basic_string<char>::MMAP_WILLNEED) {
+        WIN32_MEMORY_RANGE_ENTRY range{ptr, size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+
+    return (char*)ptr;
+}
+
+void munmap_file (char* ptr, size_t) {
+    UnmapViewOfFile(ptr);
+}
+
+}}
@@ -0,0 +1,135 @@
+#include "test.h"
+#include <panda/arena.h>
+#include <vector>
+
+TEST_PREFIX("arena: ", "[arena]");
+
+using arena_string = panda::basic_string<char, std::char_traits<char>, ArenaStaticAllocator<char>>;
+
+namespace {
+    struct Obj : ArenaAllocatedObject<Obj> {
+        uint64_t a = 1;
+        uint64_t b = 2;
+    };
+
+    struct alignas(64) Aligned : ArenaAllocatedObject<Aligned> {
+        char c;
+    };
+}
+
+TEST("allocate") {
+    Arena arena(128);
+    auto p1 = (char*)arena.allocate(10);
+    auto p2 = (char*)arena.allocate(10);
+    CHECK(p2 == p1 + 16); // aligned to pointer size
+    CHECK((uintptr_t)arena.allocate(1, 64) % 64 == 0);
+
+    auto big = arena.allocate(100000); // bigger than chunk
+    memset(big, 1, 100000);
+    CHECK(arena.reserved() >= 100000);
+}
+
+TEST("deallocate/reallocate last") {
+    Arena arena;
+    auto p1 = arena.allocate(10);
+    auto p2 = arena.allocate(16);
+    arena.deallocate(p2, 16);
+    CHECK(arena.allocate(16) == p2);
+    arena.deallocate(p1, 16); // not the last one
+    CHECK(arena.allocate(8) != p1);
+
+    auto p3 = (char*)arena.allocate(8);
+    memcpy(p3, "abcdefgh", 8);
+    CHECK(arena.reallocate(p3, 100, 8) == p3);
+    auto p4 = (char*)arena.reallocate(p3, 100000, 100);
+    CHECK(p4 != p3);
+    CHECK(string_view(p4, 8) == "abcdefgh");
+}
+
+TEST("mark/rewind/reset") {
+    Arena arena(256);
+    arena.allocate(100);
+    auto reserved = arena.reserved();
+    auto mark = arena.mark();
+    auto p = arena.allocate(16);
+    for (int i = 0; i < 1000; ++i) arena.allocate(100);
+    CHECK(arena.reserved() > reserved);
+
+    arena.rewind(mark);
+    CHECK(arena.reserved() == reserved);
+    CHECK(arena.allocate(16) == p);
+
+    for (int i = 0; i < 1000; ++i) arena.allocate(100);
+    arena.reset();
+    CHECK(arena.reserved() <= Arena::MAX_CHUNK_SIZE); // last chunk is kept
+    CHECK(arena.reserved() > 0);
+
+    arena.clear();
+    CHECK(arena.reserved() == 0);
+    CHECK(arena.allocate(10));
+}
+
+TEST("string allocator") {
+    Arena arena;
+    Arena::Scope scope(arena);
+    arena_string s(50, 'x');
+    auto reserved = arena.reserved();
+    CHECK(reserved > 0);
+    for (int i = 0; i < 100; ++i) s += "more";
+    CHECK(s.length() == 450);
+    CHECK(s.substr(446) == "more");
+
+    string copy = s; // default allocator shares arena buffer without copying
+    CHECK(copy.data() == s.data());
+}
+
+TEST("string allocator without arena") {
+    CHECK(Arena::current() == nullptr);
+    CHECK_THROWS_AS(arena_string(100, 'x'), std::logic_error);
+}
+
+TEST("scopes are nested") {
+    Arena a1, a2;
+    {
+        Arena::Scope s1(a1);
+        {
+            Arena::Scope s2(a2);
+            CHECK(Arena::current() == &a2);
+        }
+        CHECK(Arena::current() == &a1);
+    }
+    CHECK(Arena::current() == nullptr);
+}
+
+TEST("ArenaAllocatedObject") {
+    Arena arena;
+    Obj* obj = new (arena) Obj();
+    CHECK(obj->b == 2);
+    {
+        Arena::Scope scope(arena);
+        auto obj2 = new Obj();
+        CHECK(obj2 == obj + 1);
+        delete obj2;
+        auto al = new Aligned();
+        CHECK((uintptr_t)al % 64 == 0);
+    }
+}
+
+TEST("std allocator") {
+    Arena arena;
+    std::vector<int, ArenaAllocator<int>> v{ArenaAllocator<int>(arena)};
+    for (int i = 0; i < 10000; ++i) v.push_back(i);
+    CHECK(v[9999] == 9999);
+    CHECK(arena.reserved() >= 10000 * sizeof(int));
+}
+
+#ifdef PANDA_ARENA_HAS_PMR
+TEST("pmr resource") {
+    Arena arena;
+    ArenaResource res(arena);
+    std::pmr::vector<int> v(&res);
+    for (int i = 0; i < 10000; ++i) v.push_back(i);
+    CHECK(v[9999] == 9999);
+    CHECK(arena.reserved() >= 10000 * sizeof(int));
+}
+#endif
@@ -1,5 +1,8 @@
 #include "test.h"
 #include <panda/hash.h>
+#include <panda/flat_string_map.h>
+#include <panda/static_string_map.h>
+#include <panda/unordered_string_map.h>
 #include <catch2/benchmark/catch_benchmark.hpp>
 
 TEST_PREFIX("bench: ", "[.]");
@@ -163,4 +166,61 @@ TEST("hash") {
         BENCHMARK("50")   { return hash::hash_jenkins_one_at_a_time(str50); };
         BENCHMARK("1000") { return hash::hash_jenkins_one_at_a_time(str1000); };
     }
+    SECTION("xxh3_64") {
+        BENCHMARK("5")      { return hash::hash_xxh3_64(str5); };
+        BENCHMARK("10")     { return hash::hash_xxh3_64(str10); };
+        BENCHMARK("20")     { return hash::hash_xxh3_64(str20); };
+        BENCHMARK("50")     { return hash::hash_xxh3_64(str50); };
+        BENCHMARK("1000")   { return hash::hash_xxh3_64(str1000); };
+        BENCHMARK("1000ua") { return hash::hash_xxh3_64(str1000ua); };
+    }
+    SECTION("xxh3_128") {
+        BENCHMARK("5")      { return hash::hash_xxh3_128(str5); };
+        BENCHMARK("10")     { return hash::hash_xxh3_128(str10); };
+        BENCHMARK("20")     { return hash::hash_xxh3_128(str20); };
+        BENCHMARK("50")     { return hash::hash_xxh3_128(str50); };
+        BENCHMARK("1000")   { return hash::hash_xxh3_128(str1000); };
+        BENCHMARK("1000ua") { return hash::hash_xxh3_128(str1000ua); };
+    }
+    SECTION("xxh3_64 levels") {
+        auto initial = hash::level();
+        hash::set_level(hash::Level::SCALAR);
+        BENCHMARK("1000 scalar") { return hash::hash_xxh3_64(str1000); };
+        hash::set_level(hash::Level::SSE2);
+        BENCHMARK("1000 sse2")   { return hash::hash_xxh3_64(str1000); };
+        hash::set_level(hash::Level::AVX2);
+        BENCHMARK("1000 avx2")   { return hash::hash_xxh3_64(str1000); };
+        hash::set_level(initial);
+    }
+}
+
+TEST("string map lookup") {
+    std::vector<string> keys;
+    for (int i = 0; i < 10000; ++i) keys.push_back(string("header-name-") + to_string(i * 7919));
+    flat_string_map<string, int>      flat;
+    unordered_string_map<string, int> node;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        flat.emplace(keys[i], i);
+        node.emplace(keys[i], i);
+    }
+    size_t i = 0;
+    BENCHMARK("flat_string_map")      { return flat.find(string_view(keys[++i % keys.size()]))->second; };
+    BENCHMARK("unordered_string_map") { return node.find(string_view(keys[++i % keys.size()]))->second; };
+    BENCHMARK("flat_string_map miss") { return flat.find(string_view("header-name-x")) == flat.end(); };
+}
+
+TEST("static string map lookup") {
+    std::vector<std::pair<string, int>> list;
+    for (auto name : {"host", "content-length", "content-type", "accept", "accept-encoding", "user-agent", "connection", "cookie", "date",
+                      "server", "cache-control", "etag", "expires", "location", "transfer-encoding", "upgrade", "vary", "authorization"})
+    {
+        list.emplace_back(name, list.size());
+    }
+    static_string_map<int>            perfect(list.begin(), list.end());
+    flat_string_map<string, int>      flat(list.begin(), list.end());
+    unordered_string_map<string, int> node(list.begin(), list.end());
+    size_t i = 0;
+    BENCHMARK("static_string_map")    { return perfect.find(list[++i % list.size()].first)->second; };
+    BENCHMARK("flat_string_map")      { return flat.find(string_view(list[++i % list.size()].first))->second; };
+    BENCHMARK("unordered_string_map") { return node.find(string_view(list[++i % list.size()].first))->second; };
 }
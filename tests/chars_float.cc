@@ -0,0 +1,171 @@
+#include "test.h"
+#include <panda/string.h>
+#include <panda/from_chars.h>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+TEST_PREFIX("chars_float: ", "[chars_float]");
+
+namespace {
+    template <class T>
+    string tc (T value, chars_format fmt = chars_format::general) {
+        char buf[400];
+        auto res = panda::to_chars(buf, buf + sizeof(buf), value, fmt);
+        REQUIRE(!res.ec);
+        return string(buf, res.ptr - buf);
+    }
+
+    string tcp (double value, chars_format fmt, int precision) {
+        char buf[400];
+        auto res = panda::to_chars(buf, buf + sizeof(buf), value, fmt, precision);
+        REQUIRE(!res.ec);
+        return string(buf, res.ptr - buf);
+    }
+
+    template <class T>
+    T fc (string_view s, chars_format fmt = chars_format::general, std::errc err = std::errc()) {
+        T val = 42;
+        auto res = panda::from_chars(s.data(), s.data() + s.length(), val, fmt);
+        CHECK(res.ec == err);
+        return val;
+    }
+
+    // the shortest representation which round-trips, found by brute force
+    template <class T>
+    size_t shortest_digits (T value) {
+        char buf[64];
+        for (int prec = 1; prec <= 17; ++prec) {
+            snprintf(buf, sizeof(buf), "%.*e", prec - 1, (double)value);
+            if ((T)strtod(buf, nullptr) == value && (sizeof(T) == 8 || strtof(buf, nullptr) == value)) return prec;
+        }
+        return 17;
+    }
+
+    // significant digits, i.e. from first to last non-zero one
+    size_t digits_count (const string& s) {
+        auto mant  = s.substr(0, s.find('e'));
+        auto first = mant.find_first_of("123456789");
+        auto last  = mant.find_last_of("123456789");
+        if (first == string::npos) return 1;
+        auto dot = mant.find('.');
+        return last - first + 1 - (dot != string::npos && dot > first && dot < last);
+    }
+}
+
+TEST("to_chars shortest") {
+    CHECK(tc(0.0) == "0");
+    CHECK(tc(-0.0) == "-0");
+    CHECK(tc(1.0) == "1");
+    CHECK(tc(0.1) == "0.1");
+    CHECK(tc(0.3) == "0.3");
+    CHECK(tc(-1.5) == "-1.5");
+    CHECK(tc(123456.789) == "123456.789");
+    CHECK(tc(1e21) == "1e+21");
+    CHECK(tc(100.0) == "100");
+    CHECK(tc(1e-7) == "1e-07");
+    CHECK(tc(0.001) == "0.001");
+    CHECK(tc(DBL_MAX) == "1.7976931348623157e+308");
+    CHECK(tc(DBL_MIN) == "2.2250738585072014e-308");
+    CHECK(tc(5e-324) == "5e-324");
+    CHECK(tc(0.1f) == "0.1");
+    CHECK(tc(FLT_MAX) == "3.4028235e+38");
+    CHECK(tc(1.0/3) == "0.3333333333333333");
+    CHECK(tc(INFINITY) == "inf");
+    CHECK(tc(-INFINITY) == "-inf");
+    CHECK(tc(NAN) == "nan");
+}
+
+TEST("to_chars formats") {
+    CHECK(tc(1e21, chars_format::fixed) == "1000000000000000000000");
+    CHECK(tc(0.001, chars_format::scientific) == "1e-03");
+    CHECK(tc(123.25, chars_format::scientific) == "1.2325e+02");
+    CHECK(tc(1e-7, chars_format::fixed) == "0.0000001");
+    CHECK(tc(DBL_MAX, chars_format::fixed).length() == 309);
+    CHECK(tcp(3.14159, chars_format::fixed, 2) == "3.14");
+    CHECK(tcp(3.14159, chars_format::scientific, 3) == "3.142e+00");
+    CHECK(tcp(3.14159, chars_format::general, 3) == "3.14");
+    CHECK(tcp(1.0, chars_format::hex, -1) == "1p+0");
+    CHECK(tcp(DBL_MAX, chars_format::fixed, 2).length() == 312);
+
+    char buf[3];
+    auto res = panda::to_chars(buf, buf + sizeof(buf), 1.25);
+    CHECK(res.ec == std::errc::value_too_large);
+}
+
+TEST("from_chars") {
+    CHECK(fc<double>("1.5") == 1.5);
+    CHECK(fc<double>("-0.1") == -0.1);
+    CHECK(fc<double>("  12e3") == 12000);
+    CHECK(fc<double>("\t\n\v\f\r 1.5") == 1.5);
+    CHECK(fc<double>("1E-2") == 0.01);
+    CHECK(fc<double>("0.000000000000000000000000001") == 1e-27);
+    CHECK(fc<double>("123456789012345678901234567890") == 123456789012345678901234567890.0);
+    CHECK(fc<double>("2.2250738585072014e-308") == DBL_MIN);
+    CHECK(fc<double>("4.9e-324") == 5e-324);
+    CHECK(fc<double>("inf") == INFINITY);
+    CHECK(fc<double>("-Infinity") == -INFINITY);
+    CHECK(std::isnan(fc<double>("nan(123)")));
+    CHECK(fc<float>("0.1") == 0.1f);
+    CHECK(fc<float>("3.4028235e+38") == FLT_MAX);
+    CHECK(fc<double>("1p4", chars_format::hex) == 16);
+    CHECK(fc<double>("1e5", chars_format::fixed) == 1);
+    CHECK(fc<double>("15", chars_format::scientific, std::errc::invalid_argument) == 42);
+    CHECK(fc<double>("abc", chars_format::general, std::errc::invalid_argument) == 42);
+    CHECK(fc<double>(".", chars_format::general, std::errc::invalid_argument) == 42);
+    CHECK(fc<double>("1e999", chars_format::general, std::errc::result_out_of_range) == 42);
+    CHECK(fc<double>("1e-999", chars_format::general, std::errc::result_out_of_range) == 42);
+    CHECK(fc<double>("0e999") == 0);
+
+    string_view s = "3.5e+x";
+    double val;
+    auto res = panda::from_chars(s.data(), s.data() + s.length(), val);
+    CHECK(val == 3.5);
+    CHECK(res.ptr == s.data() + 3);
+}
+
+TEST("round trip and shortness") {
+    std::mt19937_64 gen(1);
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t bits = gen();
+        double d;
+        memcpy(&d, &bits, 8);
+        if (!std::isfinite(d)) continue;
+        auto s = tc(d);
+        CAPTURE(s);
+        REQUIRE(fc<double>(s) == d);
+        if (i % 16 == 0) CHECK(digits_count(s) <= shortest_digits(d));
+
+        uint32_t fbits = uint32_t(bits);
+        float f;
+        memcpy(&f, &fbits, 4);
+        if (!std::isfinite(f)) continue;
+        auto fs = tc(f);
+        CAPTURE(fs);
+        REQUIRE(fc<float>(fs) == f);
+        if (i % 16 == 0) CHECK(digits_count(fs) <= shortest_digits(f));
+    }
+}
+
+TEST("shortest where grisu is unsure") {
+    CHECK(tc(2.2448710335019179e+279) == "2.244871033501918e+279");
+    CHECK(tc(5e-324) == "5e-324");
+    CHECK(tc(1.7976931348623157e308) == "1.7976931348623157e+308");
+    CHECK(tc(9007199254740993.0) == "9007199254740992");
+    CHECK(tc(1e23) == "1e+23");
+    CHECK(tc(8.41e21) == "8.41e+21");
+    CHECK(tc(2.0e-7f) == "2e-07");
+}
+
+TEST("string") {
+    CHECK(string::from_number(0.25) == "0.25");
+    CHECK(string::from_number(1e100) == "1e+100");
+    CHECK(string::from_number(2.5f) == "2.5");
+    CHECK(string::from_number(1.0/3, chars_format::fixed, 3) == "0.333");
+    CHECK(panda::to_string(-1.75) == "-1.75");
+    double d;
+    CHECK(!string("6.02e23").to_number(d).ec);
+    CHECK(d == 6.02e23);
+    CHECK(panda::stod("1.5") == 1.5);
+    CHECK_THROWS_AS(panda::stod("x"), std::invalid_argument);
+}
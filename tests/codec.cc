@@ -0,0 +1,227 @@
+#include "test.h"
+#include <panda/codec.h>
+#include <random>
+
+TEST_PREFIX("codec: ", "[codec]");
+
+using panda::codec::Level;
+
+namespace {
+    struct LevelGuard {
+        Level prev = panda::codec::level();
+        ~LevelGuard () { panda::codec::set_level(prev); }
+    };
+
+    std::vector<Level> levels () {
+        std::vector<Level> ret;
+        for (auto lvl : {Level::SCALAR, Level::SSSE3, Level::AVX2}) if (lvl <= panda::codec::max_level()) ret.push_back(lvl);
+        return ret;
+    }
+
+    string random_bytes (std::mt19937& gen, size_t len) {
+        string ret;
+        for (size_t i = 0; i < len; ++i) ret += char(gen());
+        return ret;
+    }
+
+    // reference implementations
+    string ref_hex (const string& s) {
+        string ret;
+        char buf[3];
+        for (auto c : s) {
+            snprintf(buf, sizeof(buf), "%02x", (unsigned char)c);
+            ret += buf;
+        }
+        return ret;
+    }
+
+    string ref_base64 (const string& s) {
+        static const char abc[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        string ret;
+        uint32_t acc = 0;
+        int bits = 0;
+        for (auto c : s) {
+            acc = acc << 8 | (unsigned char)c;
+            bits += 8;
+            while (bits >= 6) ret += abc[(acc >> (bits -= 6)) & 63];
+        }
+        if (bits) ret += abc[(acc << (6 - bits)) & 63];
+        while (ret.length() % 4) ret += '=';
+        return ret;
+    }
+
+    string ref_percent (const string& s) {
+        string ret;
+        char buf[4];
+        for (auto c : s) {
+            if (isalnum((unsigned char)c) || (c && strchr("-._~", c))) ret += c;
+            else {
+                snprintf(buf, sizeof(buf), "%%%02X", (unsigned char)c);
+                ret += buf;
+            }
+        }
+        return ret;
+    }
+}
+
+TEST("hex") {
+    CHECK(encode_hex("") == "");
+    CHECK(encode_hex("\x01\xab\xff") == "01abff");
+    CHECK(encode_hex("\x01\xab\xff", true) == "01ABFF");
+    CHECK(decode_hex("01aBfF") == "\x01\xab\xff");
+    CHECK_THROWS_AS(decode_hex("abc"), std::invalid_argument);
+    CHECK_THROWS_AS(decode_hex("0g"), std::invalid_argument);
+
+    string out = "x";
+    CHECK(!decode_hex("zz", out));
+    CHECK(out == "x");
+    CHECK(decode_hex("7a", out));
+    CHECK(out == "xz");
+}
+
+TEST("base64") {
+    CHECK(encode_base64("") == "");
+    CHECK(encode_base64("f") == "Zg==");
+    CHECK(encode_base64("fo") == "Zm8=");
+    CHECK(encode_base64("foo") == "Zm9v");
+    CHECK(encode_base64("foob", false, false) == "Zm9vYg");
+    CHECK(encode_base64("\xfb\xff", true) == "-_8=");
+    CHECK(encode_base64("\xfb\xff") == "+/8=");
+    CHECK(decode_base64("Zm9vYg==") == "foob");
+    CHECK(decode_base64("Zm9vYmE") == "fooba");
+    CHECK(decode_base64("-_8") == "\xfb\xff");
+    CHECK(decode_base64("+/8=") == "\xfb\xff");
+    for (auto bad : {"Z", "Zm9vY", "Zm=v", "Zg=", "====", "Zm9v\n", "Zm 9"}) {
+        CAPTURE(bad);
+        CHECK_THROWS_AS(decode_base64(bad), std::invalid_argument);
+    }
+}
+
+TEST("percent") {
+    CHECK(encode_percent("AZaz09-._~") == "AZaz09-._~");
+    CHECK(encode_percent("a b/c?d=\xd0\xbf") == "a%20b%2Fc%3Fd%3D%D0%BF");
+    CHECK(encode_percent("a b+c", true) == "a+b%2Bc");
+    CHECK(decode_percent("a%20b%2fc") == "a b/c");
+    CHECK(decode_percent("a+b%2B") == "a+b+");
+    CHECK(decode_percent("a+b%2B", true) == "a b+");
+    CHECK(decode_percent("100%") == "100%");
+    CHECK(decode_percent("%zz%4") == "%zz%4");
+    CHECK(decode_percent("%%41") == "%A");
+}
+
+TEST("all implementations give the same results") {
+    LevelGuard guard;
+    std::mt19937 gen(1);
+    for (auto lvl : levels()) {
+        panda::codec::set_level(lvl);
+        CHECK(panda::codec::level() == lvl);
+        for (size_t len = 0; len < 300; len += (len < 70 ? 1 : 37)) {
+            auto s = random_bytes(gen, len);
+            CAPTURE(lvl, len);
+
+            auto hex = encode_hex(s);
+            CHECK(hex == ref_hex(s));
+            CHECK(decode_hex(hex) == s);
+            auto uhex = encode_hex(s, true);
+            CHECK(decode_hex(uhex) == s);
+
+            auto b64 = encode_base64(s);
+            CHECK(b64 == ref_base64(s));
+            CHECK(decode_base64(b64) == s);
+            auto url = encode_base64(s, true, false);
+            CHECK(url.find_first_of("+/=") == string::npos);
+            CHECK(decode_base64(url) == s);
+
+            auto pct = encode_percent(s);
+            CHECK(pct == ref_percent(s));
+            CHECK(decode_percent(pct) == s);
+            CHECK(decode_percent(encode_percent(s, true), true) == s);
+
+            if (len) { // error in any position is detected
+                auto pos = gen() % len;
+                auto bad = hex;
+                bad[pos * 2] = 'x';
+                CHECK_THROWS_AS(decode_hex(bad), std::invalid_argument);
+                bad = b64;
+                bad[gen() % (b64.find('=') == string::npos ? b64.length() : b64.find('='))] = '*';
+                CHECK_THROWS_AS(decode_base64(bad), std::invalid_argument);
+            }
+        }
+
+        string text;
+        for (int i = 0; i < 20; ++i) text += "key=some value&path=/a/b-c_d.e~f;";
+        CHECK(encode_percent(text) == ref_percent(text));
+        CHECK(decode_percent(encode_percent(text)) == text);
+    }
+}
+
+TEST("streaming") {
+    std::mt19937 gen(2);
+    for (int i = 0; i < 200; ++i) {
+        auto s = random_bytes(gen, gen() % 200);
+        auto b64 = encode_base64(s);
+        auto hex = encode_hex(s);
+        auto pct = encode_percent(s, true) + "%zz%4+%%41%%%4g%";
+
+        panda::base64_encoder enc;
+        panda::base64_decoder dec;
+        panda::hex_decoder    hdec;
+        panda::percent_decoder pdec(true);
+        string enc_out, dec_out, hdec_out, pdec_out;
+        size_t pos = 0;
+        while (pos < s.length()) {
+            auto len = gen() % 7;
+            enc.update(string_view(s).substr(pos, len), enc_out);
+            pos += len;
+        }
+        enc.finish(enc_out);
+        CHECK(enc_out == b64);
+
+        for (pos = 0; pos < b64.length();) {
+            auto len = gen() % 7;
+            REQUIRE(dec.update(string_view(b64).substr(pos, len), dec_out));
+            pos += len;
+        }
+        CHECK(dec.finish(dec_out));
+        CHECK(dec_out == s);
+
+        for (pos = 0; pos < hex.length(); pos += 3) REQUIRE(hdec.update(string_view(hex).substr(pos, 3), hdec_out));
+        CHECK(hdec.finish(hdec_out));
+        CHECK(hdec_out == s);
+
+        for (pos = 0; pos < pct.length(); pos += 2) pdec.update(string_view(pct).substr(pos, 2), pdec_out);
+        pdec.finish(pdec_out);
+        CHECK(pdec_out == decode_percent(pct, true));
+
+        panda::percent_decoder rdec(true); // random chunks, including 1 char
+        string rdec_out;
+        for (pos = 0; pos < pct.length();) {
+            auto len = gen() % 4 + 1;
+            rdec.update(string_view(pct).substr(pos, len), rdec_out);
+            pos += len;
+        }
+        rdec.finish(rdec_out);
+        CHECK(rdec_out == decode_percent(pct, true));
+    }
+
+    panda::percent_decoder pdec;
+    string pout;
+    pdec.update("a%", pout);
+    pdec.update("%", pout);
+    pdec.update("41", pout);
+    pdec.finish(pout);
+    CHECK(pout == "a%A");
+
+    panda::base64_decoder dec;
+    string out;
+    CHECK(dec.update("Zg", out));
+    CHECK(dec.update("==", out));
+    CHECK(!dec.update("Zg", out));
+    dec.reset();
+    out.clear();
+    CHECK(dec.update("Zm9", out));
+    CHECK(dec.finish(out));
+    CHECK(out == "fo");
+    CHECK(dec.update("Z", out));
+    CHECK(!dec.finish(out));
+}
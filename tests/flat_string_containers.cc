@@ -0,0 +1,300 @@
+#include "test.h"
+#include <panda/flat_string_map.h>
+#include <panda/flat_string_set.h>
+#include <map>
+#include <set>
+
+TEST_PREFIX("flat_string_containers: ", "[flat_string_containers]");
+
+using String = panda::basic_string<char, std::char_traits<char>, Allocator<char>>;
+
+static const string_view key1  = "key1key1key1key1key1key1key1key1key1key1key1key1key1key1key1key1key1key1key1key1";
+static const string_view key2  = "key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2key2";
+static const string val1  = "1111111111111111111111111111111111111111";
+static const string val2  = "22222222222222222222222222222222222222222222222222";
+static const string_view nokey = "nokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokeynokey";
+
+TEST("flat_string_map") {
+    flat_string_map<String, string> c;
+    REQUIRE(c.find(key1) == c.end());
+    c.emplace(String(key1), val1);
+    c.emplace(String(key2), val2);
+    REQUIRE(c.size() == 2);
+    get_allocs();
+
+    SECTION("find") {
+        REQUIRE(c.find(key1)->second == val1);
+        REQUIRE(c.find(key2)->second == val2);
+        REQUIRE(c.find(nokey) == c.end());
+        REQUIRE(c.find(String(key1))->second == val1);
+        get_allocs();
+        REQUIRE(c.find(string(key2))->second == val2);
+        REQUIRE(get_allocs().is_empty());
+    }
+
+    SECTION("find_hashed") {
+        REQUIRE(c.find_hashed(key1, hash::hashXX<size_t>(key1))->second == val1);
+        REQUIRE(c.find_hashed(nokey, hash::hashXX<size_t>(nokey)) == c.end());
+        const auto& cc = c;
+        REQUIRE(cc.find_hashed(key2, cc.hash_function()(key2))->second == val2);
+        REQUIRE(get_allocs().is_empty());
+    }
+
+    SECTION("at") {
+        REQUIRE(c.at(key1) == val1);
+        REQUIRE(c.at(key2) == val2);
+        REQUIRE_THROWS_AS(c.at(nokey), std::out_of_range);
+        REQUIRE(get_allocs().is_empty());
+    }
+
+    SECTION("count/contains") {
+        REQUIRE(c.count(key1) == 1);
+        REQUIRE(c.count(nokey) == 0);
+        REQUIRE(c.contains(key2));
+        REQUIRE(!c.contains(nokey));
+        REQUIRE(get_allocs().is_empty());
+    }
+
+    SECTION("equal_range") {
+        auto p = c.equal_range(key1);
+        auto it = p.first;
+        REQUIRE((it++)->second == val1);
+        REQUIRE(it == p.second);
+        p = c.equal_range(nokey);
+        REQUIRE(p.first == p.second);
+    }
+
+    SECTION("try_emplace creates key only when inserting") {
+        auto res = c.try_emplace(key1, "x");
+        REQUIRE(!res.second);
+        REQUIRE(res.first->second == val1);
+        REQUIRE(get_allocs().is_empty());
+        res = c.try_emplace(nokey, "x");
+        REQUIRE(res.second);
+        REQUIRE(res.first->second == "x");
+        REQUIRE(get_allocs().allocated_cnt == 1);
+        REQUIRE(c.size() == 3);
+    }
+
+    SECTION("operator[]") {
+        REQUIRE(c[key1] == val1);
+        REQUIRE(get_allocs().is_empty());
+        c[nokey] = "x";
+        REQUIRE(c.at(nokey) == "x");
+        REQUIRE(c.size() == 3);
+    }
+
+    SECTION("insert/insert_or_assign") {
+        REQUIRE(!c.insert({String(key1), "x"}).second);
+        REQUIRE(c.at(key1) == val1);
+        REQUIRE(!c.insert_or_assign(key1, "x").second);
+        REQUIRE(c.at(key1) == "x");
+        REQUIRE(c.insert(std::make_pair(String(nokey), string("y"))).second);
+        REQUIRE(c.at(nokey) == "y");
+    }
+
+    SECTION("erase") {
+        REQUIRE(c.erase(nokey) == 0);
+        REQUIRE(get_allocs().is_empty());
+        REQUIRE(c.erase(key1) == 1);
+        REQUIRE(c.find(key1) == c.end());
+        REQUIRE(c.at(key2) == val2);
+        REQUIRE(c.erase(key1) == 0);
+        auto it = c.erase(c.find(key2));
+        REQUIRE(it == c.end());
+        REQUIRE(c.empty());
+    }
+
+    SECTION("copy/move/compare") {
+        auto c2 = c;
+        REQUIRE(c2 == c);
+        c2[key1] = "x";
+        REQUIRE(c2 != c);
+        auto c3 = std::move(c2);
+        REQUIRE(c2.empty());
+        REQUIRE(c3.at(key1) == "x");
+        c3 = c;
+        REQUIRE(c3 == c);
+        c.clear();
+        REQUIRE(c.empty());
+        REQUIRE(c.begin() == c.end());
+        REQUIRE(c3.size() == 2);
+    }
+}
+
+TEST("flat_string_set") {
+    flat_string_set<String> c = {String(key1), String(key2)};
+    get_allocs();
+
+    SECTION("find") {
+        REQUIRE(*c.find(key1) == key1);
+        REQUIRE(c.find(nokey) == c.end());
+        REQUIRE(c.count(key2) == 1);
+        REQUIRE(c.find_hashed(key2, hash::hashXX<size_t>(key2)) != c.end());
+        REQUIRE(get_allocs().is_empty());
+    }
+
+    SECTION("insert creates key only when inserting") {
+        REQUIRE(!c.insert(key1).second);
+        REQUIRE(get_allocs().is_empty());
+        REQUIRE(c.insert(nokey).second);
+        REQUIRE(get_allocs().allocated_cnt == 1);
+        REQUIRE(c.contains(nokey));
+        REQUIRE(c.size() == 3);
+    }
+
+    SECTION("erase") {
+        REQUIRE(c.erase(nokey) == 0);
+        REQUIRE(c.erase(key1) == 1);
+        REQUIRE(!c.contains(key1));
+        REQUIRE(c.size() == 1);
+    }
+}
+
+template <class M>
+static void random_ops (M& m) {
+    std::map<string, int> expected;
+    srand(0);
+    for (int i = 0; i < 30000; ++i) {
+        auto key = to_string(rand() % 3000);
+        switch (rand() % 4) {
+            case 0: case 1: {
+                auto res = m.try_emplace(string_view(key), i);
+                REQUIRE(res.second == expected.emplace(key, i).second);
+                break;
+            }
+            case 2:
+                REQUIRE(m.erase(string_view(key)) == expected.erase(key));
+                break;
+            case 3: {
+                auto it = m.find(key);
+                auto eit = expected.find(key);
+                REQUIRE((it == m.end()) == (eit == expected.end()));
+                if (it != m.end()) REQUIRE(it->second == eit->second);
+                break;
+            }
+        }
+        REQUIRE(m.size() == expected.size());
+        if (i % 5000 == 0) {
+            std::map<string, int> content(m.begin(), m.end());
+            REQUIRE(content == expected);
+        }
+        if (i == 20000) m.rehash(0); // shrinks
+    }
+    std::map<string, int> content(m.begin(), m.end());
+    REQUIRE(content == expected);
+}
+
+TEST("random operations") {
+    SECTION("default") {
+        flat_string_map<string, int> m;
+        random_ops(m);
+    }
+    SECTION("stored hash") {
+        flat_string_map<string, int, hash::default_hasher, std::equal_to<>, true> m;
+        random_ops(m);
+    }
+    SECTION("reserve") {
+        flat_string_map<string, int> m(5000);
+        auto cap = m.capacity();
+        REQUIRE(cap * m.max_load_factor() >= 5000);
+        random_ops(m);
+    }
+    SECTION("bad hash") {
+        struct bad_hasher { size_t operator() (string_view s) const { return s.length(); } };
+        flat_string_map<string, int, bad_hasher> m;
+        random_ops(m);
+    }
+}
+
+namespace {
+    struct CopyOnly {
+        static int copies_left;
+        int val;
+        CopyOnly (int val) : val(val) {}
+        CopyOnly (const CopyOnly& oth) : val(oth.val) {
+            if (!copies_left--) throw std::bad_alloc();
+        }
+    };
+    int CopyOnly::copies_left = -1;
+}
+
+TEST("exception while rehashing") {
+    flat_string_map<string, CopyOnly> m;
+    m.reserve(100);
+    auto cap = m.capacity();
+    int n = 0;
+    while (m.size() < cap * m.max_load_factor()) {
+        m.try_emplace(to_string(n), n);
+        ++n;
+    }
+    CopyOnly::copies_left = 10;
+    REQUIRE_THROWS_AS(m.try_emplace(to_string(n), n), std::bad_alloc);
+    CopyOnly::copies_left = -1;
+    CHECK(m.capacity() == cap);
+    CHECK(m.size() == size_t(n));
+    for (int i = 0; i < n; ++i) CHECK(m.at(to_string(i)).val == i);
+    m.try_emplace(to_string(n), n);
+    CHECK(m.size() == size_t(n + 1));
+    CHECK(m.capacity() > cap);
+}
+
+TEST("find_hashed through rehashes") {
+    flat_string_set<string> s;
+    REQUIRE(s.find_hashed(string_view("a"), hash::hashXX<size_t>("a")) == s.end());
+    for (int i = 0; i < 2000; ++i) {
+        s.insert(to_string(i));
+        for (int j = 0; j <= i; j += 97) {
+            auto key = to_string(j);
+            REQUIRE(*s.find_hashed(key, hash::hashXX<size_t>(key)) == key);
+        }
+    }
+    s.insert("content-length");
+#ifndef PANDA_HASH_RANDOM_SEED // "key"_h is deleted there
+    REQUIRE(s.find_hashed(string_view("content-length"), "content-length"_h) != s.end());
+    REQUIRE(s.find_hashed(string_view("content-type"), "content-type"_h) == s.end());
+#endif
+}
+
+static_assert(std::is_nothrow_move_constructible<flat_string_map<string, int>>::value, "");
+static_assert(std::is_nothrow_move_assignable<flat_string_set<string>>::value, "");
+
+namespace {
+    struct CountingHasher {
+        static int defaults;
+        CountingHasher () { ++defaults; }
+        explicit CountingHasher (int) {}
+        size_t operator() (string_view s) const { return hash::hashXX<size_t>(s); }
+    };
+    int CountingHasher::defaults = 0;
+
+    struct NoDefaultHasher {
+        explicit NoDefaultHasher (uint64_t seed) : seed(seed) {}
+        size_t operator() (string_view s) const { return size_t(hash::hash_xxh3_64(s, seed)); }
+        uint64_t seed;
+    };
+}
+
+TEST("hasher is copied, not default-constructed") {
+    CountingHasher::defaults = 0;
+    flat_string_map<string, int, CountingHasher> m(0, CountingHasher(1));
+    for (int i = 0; i < 1000; ++i) m[to_string(i)] = i;
+    auto m2 = m;
+    auto m3 = std::move(m2);
+    m3 = m;
+    CHECK(CountingHasher::defaults == 0);
+    CHECK(m3.at("999") == 999);
+
+    flat_string_set<string, NoDefaultHasher> s(0, NoDefaultHasher(42));
+    for (int i = 0; i < 1000; ++i) s.insert(to_string(i));
+    auto s2 = s;
+    CHECK(s2.size() == 1000);
+    CHECK(s2.contains("500"));
+    CHECK(s2.hash_function().seed == 42);
+
+    std::vector<flat_string_map<string, int>> v(1);
+    v[0]["a"] = 1;
+    auto data = v[0].find("a").operator->();
+    v.resize(100); // maps are moved on reallocation
+    CHECK(v[0].find("a").operator->() == data);
+}
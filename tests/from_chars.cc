@@ -1,6 +1,7 @@
 #include "test.h"
 #include <panda/string.h>
 #include <panda/from_chars.h>
+#include <random>
 
 TEST_PREFIX("from_chars: ", "[from_chars]");
 
@@ -232,3 +233,76 @@ TEST("uint8_t")  { from_chars_test<uint8_t>(); }
 TEST("uint16_t") { from_chars_test<uint16_t>(); }
 TEST("uint32_t") { from_chars_test<uint32_t>(); }
 TEST("uint64_t") { from_chars_test<uint64_t>(); }
+
+TEST("base 10 of all lengths") {
+    // digits are processed in blocks of 8 and 16, so check every length and position of terminator
+    std::mt19937_64 gen(1);
+    for (int i = 0; i < 20000; ++i) {
+        string s;
+        auto len = gen() % 25 + 1;
+        for (size_t j = 0; j < len; ++j) s += char('0' + gen() % 10);
+        if (gen() % 2) s += "!0123456789012345678"; // digits after terminator must not be taken
+        CAPTURE(s);
+
+        errno = 0;
+        char* eptr;
+        auto expected = strtoull(s.c_str(), &eptr, 10);
+        bool erange = errno == ERANGE;
+
+        uint64_t u64;
+        auto res = panda::from_chars(s.data(), s.data() + s.length(), u64);
+        CHECK(res.ptr == eptr);
+        CHECK(bool(res.ec) == erange);
+        if (!erange) CHECK(u64 == expected);
+
+        uint32_t u32;
+        res = panda::from_chars(s.data(), s.data() + s.length(), u32);
+        CHECK(res.ptr == eptr);
+        CHECK(bool(res.ec) == (erange || expected > UINT32_MAX));
+        if (!res.ec) CHECK(u32 == expected);
+
+        auto neg = "-" + s;
+        int64_t i64;
+        res = panda::from_chars(neg.data(), neg.data() + neg.length(), i64);
+        bool ok = !erange && expected <= uint64_t(INT64_MAX) + 1;
+        CHECK(bool(res.ec) == !ok);
+        if (ok) CHECK(i64 == int64_t(0 - expected));
+    }
+}
+
+TEST("base 10 boundaries") {
+    unsigned pos = 0;
+    CHECK(fci<uint64_t>("00000000000000000000000018446744073709551615", pos) == UINT64_MAX);
+    pos = 0;
+    CHECK_THROWS_AS(fci<uint64_t>("99999999999999999999", pos), Exc);
+    pos = 0;
+    CHECK_THROWS_AS(fci<uint64_t>("18446744073709551620", pos), Exc);
+    pos = 0;
+    CHECK(fci<uint64_t>("9999999999999999999", pos) == 9999999999999999999ULL);
+    pos = 0;
+    CHECK(fci<uint64_t>("1234567890123456", pos) == 1234567890123456ULL);
+    pos = 0;
+    CHECK(fci<uint64_t>("12345678901234567:", pos) == 12345678901234567ULL);
+    CHECK(pos == 17);
+    pos = 0;
+    CHECK_THROWS_AS(fci<int32_t>("\x80\x80", pos), Exc); // high bytes are not digits
+}
+
+TEST("strict") {
+    int val = 42;
+    string_view s = " 12";
+    auto res = panda::from_chars_strict(s.data(), s.data() + s.length(), val);
+    CHECK(res.ec == std::errc::invalid_argument);
+    CHECK(res.ptr == s.data());
+    CHECK(val == 42);
+
+    s = "-12 ";
+    res = panda::from_chars_strict(s.data(), s.data() + s.length(), val);
+    CHECK(!res.ec);
+    CHECK(val == -12);
+
+    s = "\t\n\v\f\r 7";
+    res = panda::from_chars(s.data(), s.data() + s.length(), val);
+    CHECK(!res.ec);
+    CHECK(val == 7);
+}
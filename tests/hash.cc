@@ -0,0 +1,224 @@
+#include "test.h"
+#include <panda/hash.h>
+#include <panda/unordered_string_map.h>
+
+TEST_PREFIX("hash: ", "[hash]");
+
+using namespace panda::hash;
+
+static string test_data (size_t len) {
+    string ret;
+    for (size_t i = 0; i < len; ++i) ret += char((i * 2654435761U) >> 13);
+    return ret;
+}
+
+static const Level levels[] = {Level::SCALAR, Level::SSE2, Level::AVX2};
+
+TEST("xxh3 reference values") {
+    struct { string_view str; uint64_t h64; uint64_t h64s; uint128 h128; } vectors[] = {
+        {"",               0x2d06800538d394c2, 0xb029411ff43d84d2, {0x6001c324468d497f, 0x99aa06d3014798d8}},
+        {"a",              0xe6c632b61e964e1f, 0x4c437dd47f0716f4, {0xe6c632b61e964e1f, 0xa96faf705af16834}},
+        {"abcd",           0x6497a96f53a89890, 0xd71d944fa0388c5a, {0x1be79eecd1b1353d, 0x8d6b60383dfa90c2}},
+        {"content-length", 0x0b66ad157fc33b7a, 0xe25d1865524eb672, {0xffdc3ae1a0879504, 0x68585920462b7f90}},
+    };
+    for (auto& row : vectors) {
+        CHECK(hash_xxh3_64(row.str) == row.h64);
+        CHECK(hash_xxh3_64(row.str, 42) == row.h64s);
+        CHECK(hash_xxh3_128(row.str) == row.h128);
+    }
+
+    string x50(50, 'x'), x200(200, 'x'), x1000(1000, 'x');
+    auto initial = level();
+    for (auto l : levels) {
+        set_level(l);
+        CHECK(hash_xxh3_64(x50) == 0x8b44109c1def7e61);
+        CHECK(hash_xxh3_64(x200) == 0x50ef124fb1e4de53);
+        CHECK(hash_xxh3_64(x1000) == 0xc0a4877b962cba82);
+        CHECK(hash_xxh3_64(x1000, 42) == 0xcb10f5998c4773ff);
+        CHECK(hash_xxh3_128(x1000) == (uint128{0xc0a4877b962cba82, 0x50a1af5a5f2dcf01}));
+    }
+    set_level(initial);
+}
+
+TEST("vector code gives the same values") {
+    auto data = test_data(5000);
+    auto initial = level();
+    for (size_t len = 241; len <= 5000; len += 7) {
+        string_view v(data.data() + 1, len - 1);
+        set_level(Level::SCALAR);
+        auto h64  = hash_xxh3_64(v, len);
+        auto h128 = hash_xxh3_128(v);
+        for (auto l : levels) {
+            set_level(l);
+            CHECK(hash_xxh3_64(v, len) == h64);
+            CHECK(hash_xxh3_128(v) == h128);
+        }
+    }
+    set_level(initial);
+}
+
+TEST("defaults") {
+    auto data = test_data(300);
+    for (size_t len = 0; len < 300; len += 13) {
+        string_view v(data.data(), len);
+        CHECK(hash64(v) == hash_xxh3_64(v, seed()));
+        CHECK(hash32(v) == uint32_t(hash_xxh3_64(v, seed())));
+        CHECK(hashXX<uint64_t>(v) == hash64(v));
+        CHECK(hashXX<unsigned>(v) == hash32(v));
+        CHECK(hashXX<uint128>(v) == hash_xxh3_128(v, seed()));
+    }
+}
+
+TEST("constexpr versions give the same values") {
+    auto initial = seed();
+    set_seed(0);
+    auto data = test_data(1100);
+    for (size_t len = 0; len <= 1100; len += (len < 300 ? 1 : 50)) {
+        string_view v(data.data(), len);
+        CHECK(chash64(v) == hash64(v));
+        CHECK(chash32(v) == hash32(v));
+        CHECK(chash128(v) == hash128(v));
+#ifndef PANDA_HASH_RANDOM_SEED
+        CHECK(chashXX<unsigned>(v) == hashXX<unsigned>(v));
+        CHECK(chashXX<size_t>(v) == hashXX<size_t>(v));
+#endif
+    }
+    set_seed(initial);
+}
+
+TEST("compile-time") {
+    constexpr uint64_t h64  = chash64("content-length");
+    constexpr uint32_t h32  = chash32("content-length");
+    constexpr uint128  h128 = chash128("content-length");
+    static_assert(h64 == 0x0b66ad157fc33b7a, "");
+    static_assert(h128 == (uint128{0xffdc3ae1a0879504, 0x68585920462b7f90}), "");
+    auto initial = seed();
+    set_seed(0); // in case of PANDA_HASH_RANDOM_SEED
+    CHECK(h64 == hash64("content-length"));
+    CHECK(h32 == hash32("content-length"));
+#ifndef PANDA_HASH_RANDOM_SEED
+    constexpr size_t h = "content-length"_h;
+    CHECK(h == std::hash<string>()("content-length"));
+    CHECK(h == std::hash<string_view>()("content-length"));
+#endif
+    set_seed(initial);
+}
+
+TEST("siphash reference values") {
+    uint128 key = {0x0706050403020100, 0x0f0e0d0c0b0a0908};
+    struct { size_t len; uint64_t h24; uint64_t h13; } vectors[] = {
+        {0,   0x726fdb47dd0e0e31, 0xabac0158050fc4dc},
+        {1,   0x74f839c593dc67fd, 0xc9f49bf37d57ca93},
+        {7,   0xab0200f58b01d137, 0xd3927d989bb11140},
+        {8,   0x93f5f5799a932462, 0x369095118d299a8e},
+        {15,  0xa129ca6149be45e5, 0xd320d86d2a519956},
+        {16,  0x3f2acc7f57c29bdb, 0xcc4fdd1a7d908b66},
+        {63,  0x958a324ceb064572, 0x9d199062b7bbb3a8},
+        {64,  0xacd2c40b8502cad8, 0xf17997ec4b4a6065},
+        {100, 0x096f3fec85c52a7e, 0x3bee41c20cac3a3b},
+    };
+    string msg;
+    for (int i = 0; i < 100; ++i) msg += char(i);
+    for (auto& row : vectors) {
+        CHECK(hash_siphash24(string_view(msg.data(), row.len), key) == row.h24);
+        CHECK(hash_siphash13(string_view(msg.data(), row.len), key) == row.h13);
+    }
+}
+
+TEST("seed") {
+    string_view key = "content-length";
+    auto initial = seed();
+    CHECK(random_seed() != random_seed());
+
+    set_seed(12345);
+    CHECK(hash64(key) == hash_xxh3_64(key, 12345));
+    CHECK(hash32(key) == uint32_t(hash_xxh3_64(key, 12345)));
+    CHECK(hash128(key) == hash_xxh3_128(key, 12345));
+    CHECK(std::hash<string_view>()(key) == hashXX<size_t>(key));
+    CHECK(std::hash<string_view>()(key) != chash64(key));
+
+#ifndef PANDA_HASH_RANDOM_SEED
+    set_seed(0);
+    CHECK(std::hash<string_view>()(key) == "content-length"_h);
+#endif
+    set_seed(initial);
+}
+
+TEST("seeded hashers") {
+    string_view key = "content-length";
+    CHECK(seeded_hasher(1)(key) == size_t(hash_xxh3_64(key, 1)));
+    CHECK(seeded_hasher(1)(string(key)) == seeded_hasher(1)(key));
+    CHECK(seeded_hasher(1)(key) != seeded_hasher(2)(key));
+    CHECK(seeded_hasher()(key) != seeded_hasher()(key));
+    CHECK(sip_hasher(uint128{1, 2})(key) == size_t(hash_siphash13(key, {1, 2})));
+    CHECK(sip_hasher()(key) != sip_hasher()(key));
+
+    unordered_string_map<string, int, seeded_hasher> m1;
+    unordered_string_map<string, int, sip_hasher>    m2;
+    for (int i = 0; i < 1000; ++i) {
+        m1.emplace(to_string(i), i);
+        m2.emplace(to_string(i), i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto k = to_string(i);
+        CHECK(m1.at(string_view(k)) == i);
+        CHECK(m2.at(string_view(k)) == i);
+        CHECK(m1.find_hashed(k, m1.hash_function()(k))->second == i);
+    }
+}
+
+TEST("hasher") {
+    auto data = test_data(5000);
+    auto initial = level();
+    SECTION("chunks") {
+        for (auto l : levels) {
+            set_level(l);
+            for (size_t len : {0, 1, 3, 16, 17, 128, 129, 240, 241, 255, 256, 257, 320, 321, 1024, 1025, 1088, 2048, 2049, 4999}) {
+                string_view v(data.data(), len);
+                for (size_t chunk : {1, 7, 63, 64, 65, 255, 256, 257, 1000, 5000}) {
+                    hasher h;
+                    for (size_t pos = 0; pos < len; pos += chunk) h.update(v.substr(pos, chunk));
+                    CHECK(h.length() == len);
+                    CHECK(h.finalize() == hash64(v));
+                    CHECK(h.finalize128() == hash128(v));
+                }
+            }
+        }
+    }
+    SECTION("random chunks and seed") {
+        srand(0);
+        for (int i = 0; i < 200; ++i) {
+            size_t len = rand() % data.length();
+            string_view v(data.data(), len);
+            hasher h(i);
+            for (size_t pos = 0; pos < len;) {
+                size_t chunk = rand() % 700;
+                h.update(v.substr(pos, chunk));
+                pos += chunk;
+            }
+            CHECK(h.finalize() == hash_xxh3_64(v, i));
+            CHECK(h.finalize128() == hash_xxh3_128(v, i));
+        }
+    }
+    SECTION("update after finalize, reset") {
+        string_view v(data.data(), 3000);
+        hasher h;
+        h.update(v.substr(0, 1000));
+        CHECK(h.finalize() == hash64(v.substr(0, 1000)));
+        h.update(v.substr(1000));
+        CHECK(h.finalize() == hash64(v));
+        h.reset();
+        CHECK(h.finalize() == hash64(""));
+    }
+    set_level(initial);
+}
+
+TEST("hash of range") {
+    std::vector<string> parts = {"content", "-", "length", "", string(1000, 'x')};
+    string all;
+    for (auto& s : parts) all += s;
+    CHECK(hash64_range(parts) == hash64(all));
+    CHECK(hash128_range(parts) == hash128(all));
+    std::vector<string_view> views(parts.begin(), parts.end());
+    CHECK(hash64_range(views) == hash64(all));
+}
@@ -0,0 +1,500 @@
+#include "test.h"
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fstream>
+
+TEST_PREFIX("memory: ", "[memory]");
+
+namespace {
+    struct Obj : AllocatedObject<Obj> {
+        uint64_t a;
+        uint64_t b;
+        uint64_t c;
+    };
+}
+
+TEST("owner_of") {
+    MemoryPool pool(24);
+    void* p = pool.allocate();
+    CHECK(MemoryPool::owner_of(p, 24) == &pool);
+    CHECK(MemoryPool::owner_of(p, 20) == &pool); // same rounded up blocksize
+    pool.deallocate(p);
+}
+
+TEST("aligned pool") {
+    MemoryPool pool(40, MemoryPool::DEFAULT_MAX_CHUNK_SIZE, 64);
+    CHECK(pool.stats().blocksize == 64);
+    std::vector<void*> ptrs;
+    bool aligned = true;
+    for (int i = 0; i < 1000; ++i) {
+        ptrs.push_back(pool.allocate());
+        if ((uintptr_t)ptrs.back() % 64) aligned = false;
+    }
+    CHECK(aligned);
+    CHECK(MemoryPool::owner_of(ptrs[0], 40, 64) == &pool);
+    for (auto p : ptrs) pool.deallocate(p);
+
+    auto p = StaticMemoryPool<32, 256>::allocate();
+    CHECK((uintptr_t)p % 256 == 0);
+    StaticMemoryPool<32, 256>::deallocate(p);
+
+    CHECK_THROWS_AS(MemoryPool(16, MemoryPool::DEFAULT_MAX_CHUNK_SIZE, 24), std::invalid_argument);
+}
+
+TEST("AllocatedObject of over-aligned type") {
+    struct alignas(64) Padded : AllocatedObject<Padded> {
+        std::atomic<uint64_t> cnt;
+    };
+    std::vector<Padded*> objs;
+    bool aligned = true;
+    for (int i = 0; i < 100; ++i) {
+        objs.push_back(new Padded());
+        if ((uintptr_t)objs.back() % 64) aligned = false;
+    }
+    CHECK(aligned);
+    for (auto obj : objs) delete obj;
+}
+
+TEST("bulk") {
+    MemoryPool pool(24);
+    std::vector<void*> ptrs(1000);
+    pool.allocate_bulk(ptrs.size(), ptrs.data());
+    std::set<void*> uniq(ptrs.begin(), ptrs.end());
+    CHECK(uniq.size() == ptrs.size());
+    for (auto p : ptrs) memset(p, 0, 24);
+    CHECK(pool.stats().allocated == 1000);
+
+    pool.deallocate_bulk(ptrs.size(), ptrs.data());
+    CHECK(pool.stats().deallocated == 1000);
+    std::vector<void*> again(1000);
+    pool.allocate_bulk(again.size(), again.data());
+    CHECK(again == ptrs); // reused in the same order
+
+    SECTION("foreign blocks go to their owner") {
+        MemoryPool other(24);
+        std::vector<void*> mixed(again.begin(), again.begin() + 10);
+        mixed.push_back(other.allocate());
+        other.deallocate_bulk(mixed.size(), mixed.data());
+        CHECK(other.allocate() == mixed.back());
+        CHECK(pool.stats().deallocated == 1010);
+    }
+}
+
+#ifdef PANDA_MEMORY_DEBUG
+namespace {
+    struct DebugErrors {
+        static std::vector<std::string> list;
+        DebugErrors ()  { list.clear(); MemoryPool::debug_error_handler = &handler; }
+        ~DebugErrors () { MemoryPool::debug_error_handler = prev; }
+        static void handler (const char* error, void*) { list.push_back(error); }
+        void (*prev)(const char*, void*) = MemoryPool::debug_error_handler;
+    };
+    std::vector<std::string> DebugErrors::list;
+}
+
+TEST("debug: double free") {
+    DebugErrors errors;
+    MemoryPool pool(32);
+    auto p = pool.allocate();
+    pool.deallocate(p);
+    pool.deallocate(p);
+    REQUIRE(errors.list.size() == 1);
+    CHECK(errors.list[0] == "double free");
+    CHECK(pool.allocate() == p);
+    CHECK(pool.allocate() != p); // was not put into free list twice
+}
+
+#ifndef __SANITIZE_ADDRESS__ // ASan reports these before the pool does
+TEST("debug: use after free") {
+    DebugErrors errors;
+    MemoryPool pool(32);
+    auto p = (char*)pool.allocate();
+    pool.deallocate(p);
+    p[20] = 1;
+    pool.allocate();
+    REQUIRE(errors.list.size() == 1);
+    CHECK(errors.list[0].find("use after free") != std::string::npos);
+}
+
+TEST("debug: overflow") {
+    DebugErrors errors;
+    MemoryPool pool(32);
+    auto p = (char*)pool.allocate();
+    memset(p, 0, 40);
+    pool.deallocate(p);
+    REQUIRE(errors.list.size() == 1);
+    CHECK(errors.list[0].find("overflow") != std::string::npos);
+}
+#endif
+#endif
+
+TEST("remote free returns block to the owner") {
+    MemoryPool pool(16);
+    void* p = pool.allocate();
+
+    std::thread([p]{
+        MemoryPool other(16);
+        other.deallocate(p);
+        void* mine = other.allocate();
+        CHECK(mine != p);
+        other.deallocate(mine);
+    }).join();
+
+    bool found = false;
+    for (int i = 0; i < 10000 && !found; ++i) found = pool.allocate() == p;
+    CHECK(found);
+}
+
+TEST("AllocatedObject deleted in another thread") {
+    std::vector<Obj*> objs;
+    for (int i = 0; i < 1000; ++i) objs.push_back(new Obj());
+
+    std::thread([&objs]{
+        for (auto obj : objs) delete obj;
+    }).join();
+
+    std::set<void*> freed(objs.begin(), objs.end());
+    size_t reused = 0;
+    std::vector<Obj*> again;
+    for (int i = 0; i < 2000; ++i) {
+        again.push_back(new Obj());
+        if (freed.count(again.back())) ++reused;
+    }
+    CHECK(reused == objs.size());
+    for (auto obj : again) delete obj;
+}
+
+TEST("DynamicMemoryPool remote free of unknown size class") {
+    auto p = DynamicMemoryPool::instance()->allocate(12345);
+    std::thread([p]{
+        DynamicMemoryPool::instance()->deallocate(p, 12345); // this thread has never allocated such size
+    }).join();
+    CHECK(MemoryPool::owner_of(p, DynamicMemoryPool::block_size(12345)) != nullptr);
+}
+
+TEST("DynamicMemoryPool size classes") {
+    bool fits = true, monotonic = true;
+    size_t prev = 0;
+    for (size_t size = 1; size <= DynamicMemoryPool::MAX_POOLED_SIZE * 4; ++size) {
+        auto bs = DynamicMemoryPool::block_size(size);
+        if (bs < size) fits = false;
+        if (bs < prev) monotonic = false;
+        prev = bs;
+        #ifdef PANDA_MEMORY_GEOMETRIC_CLASSES
+        if (size > 64 && bs > size + size / 4) fits = false;
+        #endif
+    }
+    CHECK(fits);
+    CHECK(monotonic);
+}
+
+TEST("DynamicMemoryPool shares one pool for blocks up to pointer size") {
+    auto pool = DynamicMemoryPool::instance();
+    auto p1 = pool->allocate(1);
+    auto p4 = pool->allocate(4);
+    auto p8 = pool->allocate(sizeof(void*));
+    CHECK(DynamicMemoryPool::block_size(1) == sizeof(void*));
+    CHECK(DynamicMemoryPool::block_size(4) == sizeof(void*));
+    auto owner = MemoryPool::owner_of(p8, sizeof(void*));
+    CHECK(MemoryPool::owner_of(p1, sizeof(void*)) == owner);
+    CHECK(MemoryPool::owner_of(p4, sizeof(void*)) == owner);
+    pool->deallocate(p1, 1);
+    pool->deallocate(p4, 4);
+    pool->deallocate(p8, sizeof(void*));
+}
+
+TEST("DynamicMemoryPool large blocks") {
+    auto pool = DynamicMemoryPool::instance();
+    pool->trim();
+    const size_t size = 1000000;
+    auto p = (char*)pool->allocate(size);
+    memset(p, 1, size);
+    pool->deallocate(p, size);
+    CHECK(pool->allocate(size + 1000) == p); // same rounded size, taken from cache
+    pool->deallocate(p, size + 1000);
+    CHECK(pool->trim() >= size);
+
+    std::vector<uint64_t, DynamicInstanceAllocator<uint64_t>> v;
+    for (uint64_t i = 0; i < 1000000; ++i) v.push_back(i);
+    CHECK(v[999999] == 999999);
+}
+
+TEST("concurrent remote frees") {
+    MemoryPool pool(32);
+    const int cnt = 10000;
+    std::vector<void*> ptrs;
+    for (int i = 0; i < cnt * 4; ++i) ptrs.push_back(pool.allocate());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.emplace_back([&ptrs, t]{
+        MemoryPool other(32);
+        for (int i = t * cnt; i < (t+1) * cnt; ++i) other.deallocate(ptrs[i]);
+    });
+    for (auto& t : threads) t.join();
+
+    std::set<void*> freed(ptrs.begin(), ptrs.end());
+    size_t reused = 0;
+    for (int i = 0; i < cnt * 8; ++i) if (freed.erase(pool.allocate())) ++reused;
+    CHECK(reused == ptrs.size());
+}
+
+TEST("trim") {
+    MemoryPool pool(16);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 100000; ++i) ptrs.push_back(pool.allocate());
+
+    SECTION("releases everything after spike") {
+        for (auto p : ptrs) pool.deallocate(p);
+        CHECK(pool.trim() >= ptrs.size() * 16);
+        CHECK(pool.trim() == 0);
+        auto p = pool.allocate();
+        CHECK(MemoryPool::owner_of(p, 16) == &pool);
+        pool.deallocate(p);
+    }
+
+    SECTION("keeps chunks with live blocks") {
+        auto first = ptrs.front();
+        auto last  = ptrs.back();
+        for (auto p : ptrs) if (p != first && p != last) pool.deallocate(p);
+        CHECK(pool.trim() > 0);
+        memset(first, 1, 16);
+        memset(last, 1, 16);
+        CHECK(MemoryPool::owner_of(first, 16) == &pool);
+        CHECK(MemoryPool::owner_of(last, 16) == &pool);
+        pool.deallocate(first);
+        pool.deallocate(last);
+        CHECK(pool.trim() > 0);
+    }
+
+    SECTION("counts remote frees") {
+        std::thread([&ptrs]{
+            MemoryPool other(16);
+            for (auto p : ptrs) other.deallocate(p);
+        }).join();
+        CHECK(pool.trim() >= ptrs.size() * 16);
+    }
+
+    SECTION("on request") {
+        for (size_t i = 1; i < ptrs.size(); ++i) pool.deallocate(ptrs[i]);
+        MemoryPool::request_trim_all();
+        pool.deallocate(ptrs[0]); // trims here
+        CHECK(pool.trim() == 0);
+    }
+}
+
+TEST("max_chunk_size") {
+    MemoryPool pool(16, 4096);
+    CHECK(pool.max_chunk_size() == 4096);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 10000; ++i) ptrs.push_back(pool.allocate());
+    auto last = ptrs.back();
+    ptrs.pop_back();
+    for (auto p : ptrs) pool.deallocate(p);
+    CHECK(pool.trim() >= 10000 * 16 - 4096); // each chunk is one segment, only the last one is kept
+    pool.deallocate(last);
+
+    pool.max_chunk_size(1);
+    CHECK(pool.max_chunk_size() == 4096);
+}
+
+TEST("stats") {
+    MemoryPool pool(40);
+    auto st = pool.stats();
+    CHECK(st.blocksize == 40);
+    CHECK(st.chunks == 0);
+    CHECK(st.reserved == 0);
+    CHECK(st.in_use() == 0);
+
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 1000; ++i) ptrs.push_back(pool.allocate());
+    pool.deallocate(ptrs.back());
+    ptrs.pop_back();
+
+    std::thread([&ptrs]{
+        MemoryPool other(40);
+        other.deallocate(ptrs.back());
+    }).join();
+    ptrs.pop_back();
+
+    st = pool.stats();
+    CHECK(st.allocated == 1000);
+    CHECK(st.deallocated == 2);
+    CHECK(st.in_use() == 998 * 40);
+    CHECK(st.chunks > 0);
+    CHECK(st.reserved >= st.in_use());
+
+    SECTION("all_stats") {
+        auto all = MemoryPool::all_stats();
+        bool found = false;
+        for (auto& row : all) if (row.blocksize == 40 && row.allocated == 1000 && row.thread == st.thread) found = true;
+        CHECK(found);
+    }
+
+    SECTION("dump") {
+        std::ostringstream os;
+        MemoryPool::dump_stats(os);
+        auto res = os.str();
+        CHECK(res.find("pool thread=") != std::string::npos);
+        CHECK(res.find("blocksize blocksize=40 ") != std::string::npos);
+        CHECK(res.find("\ntotal pools=") != std::string::npos);
+    }
+
+    SECTION("trim") {
+        for (auto p : ptrs) pool.deallocate(p);
+        pool.trim();
+        st = pool.stats();
+        CHECK(st.chunks == 0);
+        CHECK(st.reserved == 0);
+        CHECK(st.in_use() == 0);
+    }
+}
+
+TEST("pool of exited thread is adopted") {
+    Obj* obj = nullptr;
+    std::thread([&]{ obj = new Obj(); }).join();
+
+    std::thread([&]{
+        auto pool = StaticMemoryPool<sizeof(Obj)>::instance();
+        CHECK(MemoryPool::owner_of(obj, sizeof(Obj)) == pool);
+        delete obj; // local free now
+        auto st = pool->stats();
+        CHECK(st.thread == std::hash<std::thread::id>()(std::this_thread::get_id()));
+    }).join();
+}
+
+namespace {
+    struct LateUser {
+        Obj*  obj  = nullptr;
+        bool* done = nullptr;
+
+        // runs after thread's pools are released: tls_ptrs is constructed after this object
+        ~LateUser () {
+            delete obj;
+            delete new Obj();
+            auto dyn = DynamicMemoryPool::instance();
+            dyn->deallocate(dyn->allocate(100), 100);
+            dyn->deallocate(dyn->allocate(1000000), 1000000);
+            *done = true;
+        }
+    };
+}
+
+TEST("pools used from thread_local destructors") {
+    bool done[8] = {};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) threads.emplace_back([&done, t]{
+        static thread_local LateUser user;
+        user.done = &done[t];
+        user.obj  = new Obj();
+        std::vector<Obj*> objs; // these threads adopt pools of exited ones while others are still freeing into them
+        for (int i = 0; i < 1000; ++i) objs.push_back(new Obj());
+        for (auto p : objs) delete p;
+    });
+    for (auto& t : threads) t.join();
+    for (auto d : done) CHECK(d);
+}
+
+#if defined(__linux__) && !defined(__SANITIZE_ADDRESS__) // ASan keeps freed memory in quarantine
+static size_t rss () {
+    std::ifstream f("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    f >> size >> resident;
+    return resident * 4096;
+}
+
+TEST("memory is steady when threads come and go") {
+    auto run = [](int cnt) {
+        for (int i = 0; i < cnt; i += 8) {
+            std::vector<void*> blocks[8];
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 8; ++t) threads.emplace_back([&blocks, t]{
+                std::vector<Obj*> objs;
+                for (int j = 0; j < 2000; ++j) objs.push_back(new Obj());
+                for (int j = 0; j < 200; ++j) blocks[t].push_back(DynamicMemoryPool::instance()->allocate(1000));
+                for (size_t j = 10; j < objs.size(); ++j) delete objs[j]; // first ones stay alive in the orphaned pool
+            });
+            for (auto& t : threads) t.join();
+            for (auto& list : blocks) for (auto p : list) DynamicMemoryPool::instance()->deallocate(p, 1000); // remote frees
+        }
+    };
+
+    run(200); // warm up
+    auto start = rss();
+    run(3000);
+    CHECK(rss() < start + 4 * 1024 * 1024);
+}
+#endif
+
+namespace {
+    int* thread_int () {
+        static thread_local int val = 20; // not allocated, so that threads don't leak it
+        return &val;
+    }
+
+    struct GlobalOwner {
+        PANDA_GLOBAL_MEMBER_PTR(GlobalOwner, int*, gptr, new int(10));
+        PANDA_TLS_MEMBER_PTR(GlobalOwner, int*, tptr, thread_int());
+        PANDA_TLS_MEMBER(GlobalOwner, int, tval, 30);
+    };
+}
+
+TEST("global ptrs") {
+    int a = 1, b = 2;
+    CHECK(get_global_ptr<GlobalOwner>(&a, "x") == &a);
+    CHECK(get_global_ptr<GlobalOwner>(&b, "x") == &a);
+    CHECK(get_global_ptr<GlobalOwner>(&b, "y") == &b);
+    CHECK(get_global_ptr<Obj>(&b, "x") == &b);
+    CHECK(get_global_ptr(global_key<GlobalOwner>("x"), &b) == &a);
+    CHECK(global_key<GlobalOwner>("x") != global_key<GlobalOwner>("y"));
+    CHECK(global_key<GlobalOwner>("x") == global_key<GlobalOwner>(string("x").c_str()));
+    CHECK(*GlobalOwner::gptr() == 10);
+
+    int* other_gptr = nullptr;
+    std::thread([&]{ other_gptr = GlobalOwner::gptr(); }).join();
+    CHECK(other_gptr == GlobalOwner::gptr());
+}
+
+TEST("global ptrs with equal hashes") {
+    int a = 1, b = 2, c = 3;
+    auto key = global_key<GlobalOwner>("hash-x");
+    auto other_name = key, other_type = key;
+    other_name.name = "hash-y";
+    other_type.type = &typeid(Obj);
+    CHECK(key != other_name);
+    CHECK(key != other_type);
+
+    CHECK(get_global_ptr(key, &a) == &a);
+    CHECK(get_global_ptr(other_name, &b) == &b);
+    CHECK(get_global_ptr(other_type, &c) == &c);
+    CHECK(get_global_ptr(key, &c) == &a);
+    CHECK(get_global_ptr(other_name, &c) == &b);
+
+    CHECK(get_global_tls_ptr(key, &a) == &a);
+    CHECK(get_global_tls_ptr(other_name, &b) == &b);
+    CHECK(get_global_tls_ptr(other_name, &c) == &b);
+}
+
+TEST("global tls ptrs") {
+    int a = 1, b = 2;
+    CHECK(get_global_tls_ptr<GlobalOwner>(&a, "x") == &a);
+    CHECK(get_global_tls_ptr<GlobalOwner>(&b, "x") == &a);
+
+    int* other = nullptr;
+    std::thread([&]{ other = get_global_tls_ptr<GlobalOwner>(&b, "x"); }).join();
+    CHECK(other == &b);
+
+    GlobalOwner::tval() = 31;
+    int* other_tptr = nullptr;
+    int  other_tval = 0;
+    std::thread([&]{
+        other_tptr = GlobalOwner::tptr();
+        other_tval = GlobalOwner::tval();
+        CHECK(*other_tptr == 20);
+    }).join();
+    CHECK(other_tptr != GlobalOwner::tptr());
+    CHECK(*GlobalOwner::tptr() == 20);
+    CHECK(other_tval == 30);
+    CHECK(GlobalOwner::tval() == 31);
+}
@@ -0,0 +1,67 @@
+#include "test.h"
+#include <panda/static_string_map.h>
+#include <set>
+
+TEST_PREFIX("static_string_map: ", "[static_string_map]");
+
+static constexpr auto methods = make_static_table<int>({{"GET", 1}, {"HEAD", 2}, {"POST", 3}, {"PUT", 4}, {"DELETE", 5}, {"OPTIONS", 6}});
+static_assert(methods.cfind("POST")->value == 3, "");
+static_assert(!methods.cfind("PATCH"), "");
+static_assert(methods.size() == 6, "");
+
+TEST("static_string_map") {
+    static_string_map<string> m = {{"content-length", "1"}, {"content-type", "2"}, {"host", "3"}, {"", "4"}};
+    get_allocs();
+    CHECK(m.size() == 4);
+    CHECK(m.at("content-length") == "1");
+    CHECK(m.at(string("content-type")) == "2");
+    CHECK(m.find("host")->second == "3");
+    CHECK(m.at("") == "4");
+    CHECK(m.find("content") == nullptr);
+    CHECK(m.count("hos") == 0);
+    CHECK(!m.contains("hostt"));
+    CHECK_THROWS_AS(m.at("nokey"), std::out_of_range);
+    CHECK(get_allocs().is_empty());
+
+    std::set<size_t> indexes;
+    for (auto& row : m) indexes.insert(m.index(row.first));
+    CHECK(indexes == std::set<size_t>{0, 1, 2, 3});
+    CHECK(m.index("nokey") == m.npos);
+}
+
+TEST("empty") {
+    static_string_map<int> m;
+    CHECK(m.empty());
+    CHECK(m.find("") == nullptr);
+    CHECK(m.begin() == m.end());
+}
+
+TEST("duplicate keys") {
+    CHECK_THROWS_AS((static_string_map<int>{{"a", 1}, {"b", 2}, {"a", 3}}), std::invalid_argument);
+}
+
+TEST("sizes") {
+    for (size_t n : {1, 2, 3, 5, 16, 100, 1000, 20000}) {
+        std::vector<std::pair<string, size_t>> list;
+        for (size_t i = 0; i < n; ++i) list.emplace_back(string("key-") + to_string(i * 31), i);
+        static_string_map<size_t> m(list.begin(), list.end());
+        REQUIRE(m.size() == n);
+        for (auto& row : list) REQUIRE(m.at(row.first) == row.second);
+        for (size_t i = 0; i < n; ++i) REQUIRE(!m.find(string("key-") + to_string(i * 31 + 1)));
+    }
+}
+
+TEST("constexpr table") {
+    CHECK(methods.at("GET") == 1);
+    CHECK(methods.at("OPTIONS") == 6);
+    CHECK(methods.find("get") == nullptr);
+    CHECK(methods.find("") == nullptr);
+    CHECK(methods.index("PATCH") == methods.npos);
+    int sum = 0;
+    for (auto& row : methods) {
+        CHECK(methods.find(row.key) == &row);
+        CHECK(methods.cfind(row.key) == &row);
+        sum += row.value;
+    }
+    CHECK(sum == 21);
+}
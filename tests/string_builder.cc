@@ -0,0 +1,76 @@
+#include "test.h"
+#include <panda/string_builder.h>
+#include <sys/uio.h>
+
+TEST_PREFIX("string_builder: ", "[string_builder]");
+
+TEST("fragments are referenced") {
+    string big(100, 'x');
+    string_builder b;
+    b << big << big.substr(10, 20) << "literal";
+    CHECK(b.length() == 127);
+    CHECK(b.fragments().size() == 3);
+    CHECK(b.fragments()[0].data() == big.data());
+    CHECK(b.fragments()[1].data() == big.data() + 10);
+    CHECK(big.use_count() == 3);
+}
+
+TEST("small pieces are coalesced") {
+    string_builder b;
+    string_view v = "abc";
+    b << v << 'd' << v;
+    const char* p = "xyz";
+    b.append(p);
+    CHECK(b.fragments().size() == 1);
+    CHECK(b.str() == "abcdabcxyz");
+    b << string(50, 'z') << v;
+    CHECK(b.fragments().size() == 3);
+}
+
+TEST("char buffers are copied") {
+    string_builder b;
+    {
+        char buf[16];
+        strcpy(buf, "hello");
+        b.append(buf);
+        strcpy(buf, "world");
+        b << buf;
+        memset(buf, 'x', sizeof(buf));
+    }
+    CHECK(b.length() == 10);
+    CHECK(b.fragments().size() == 1);
+    CHECK(b.str() == "helloworld");
+}
+
+TEST("str") {
+    string_builder b;
+    CHECK(b.str() == "");
+    string big(100, 'x');
+    b << big;
+    CHECK(b.str().data() == big.data()); // single fragment is not copied
+    b << "end";
+    auto res = b.str();
+    CHECK(res == big + "end");
+    CHECK(res.capacity() == 103);
+}
+
+TEST("iovec") {
+    string_builder b;
+    b << "hello" << string(" ") << string(100, 'w');
+    iovec iov[3];
+    CHECK(b.to_iovec(iov, 3) == 3);
+    CHECK(iov[0].iov_len == 5);
+    CHECK(iov[2].iov_len == 100);
+    CHECK(b.to_iovec(iov, 2) == 2);
+    CHECK(b.to_iovec(iov, 3, 6) == 1);
+    CHECK(iov[0].iov_len == 100);
+
+    b.consume(3);
+    CHECK(b.length() == 103);
+    CHECK(b.str() == "lo " + string(100, 'w'));
+    b.consume(10);
+    CHECK(b.fragments().size() == 1);
+    CHECK(b.length() == 93);
+    b.consume(1000);
+    CHECK(b.empty());
+}
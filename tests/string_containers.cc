@@ -149,6 +149,15 @@ TEST("unordered_string_map") {
         REQUIRE(c.find(nokey) == c.end());
     }
 
+    SECTION("find_hashed") {
+        REQUIRE(c.find_hashed(key1, hash::hashXX<size_t>(key1))->second == val1);
+        REQUIRE(c.find_hashed(key2, hash::hashXX<size_t>(key2))->second == val2);
+        REQUIRE(c.find_hashed(nokey, hash::hashXX<size_t>(nokey)) == nullptr);
+        REQUIRE(get_allocs().is_empty());
+        const auto& cc = c;
+        REQUIRE(cc.find_hashed(skey1, hash::hashXX<size_t>(key1))->second == val1);
+    }
+
     SECTION("at") {
         REQUIRE(c.at(key1) == val1);
         REQUIRE(c.at(key2) == val2);
@@ -201,6 +210,12 @@ TEST("unordered_string_multimap") {
         REQUIRE(c.find(nokey) == c.end());
     }
 
+    SECTION("find_hashed") {
+        auto val = c.find_hashed(key1, hash::hashXX<size_t>(key1))->second;
+        REQUIRE((val == val1 || val == val3));
+        REQUIRE(c.find_hashed(nokey, hash::hashXX<size_t>(nokey)) == nullptr);
+    }
+
     SECTION("count") {
         REQUIRE(c.count(key1) == 2);
         REQUIRE(c.count(key2) == 1);
@@ -363,6 +378,12 @@ TEST("unordered_string_set") {
         REQUIRE(c.find(nokey) == c.end());
     }
 
+    SECTION("find_hashed") {
+        REQUIRE(*c.find_hashed(key1, hash::hashXX<size_t>(key1)) == key1);
+        REQUIRE(c.find_hashed(nokey, hash::hashXX<size_t>(nokey)) == nullptr);
+        REQUIRE(get_allocs().is_empty());
+    }
+
     SECTION("count") {
         REQUIRE(c.count(key1) == 1);
         REQUIRE(c.count(key2) == 1);
@@ -440,3 +461,22 @@ TEST("unordered_string_multiset") {
         REQUIRE(c.erase(key1) == 0);
     }
 }
+
+TEST("find_hashed through rehashes") {
+    unordered_string_map<string, int> m;
+    REQUIRE(m.find_hashed(string_view("a"), hash::hashXX<size_t>("a")) == nullptr);
+    for (int i = 0; i < 2000; ++i) {
+        m.emplace(to_string(i), i);
+        for (int j = 0; j <= i; j += 97) {
+            auto key = to_string(j);
+            auto p = m.find_hashed(key, hash::hashXX<size_t>(key));
+            REQUIRE(p);
+            REQUIRE(p->second == j);
+        }
+    }
+    m.emplace("content-length", -1);
+#ifndef PANDA_HASH_RANDOM_SEED // "key"_h is deleted there
+    REQUIRE(m.find_hashed(string_view("content-length"), "content-length"_h)->second == -1);
+    REQUIRE(m.find_hashed(string_view("content-type"), "content-type"_h) == nullptr);
+#endif
+}
@@ -0,0 +1,97 @@
+#include "test.h"
+#include <panda/string_iovec.h>
+
+TEST_PREFIX("string_iovec: ", "[string_iovec]");
+
+namespace {
+    int freed;
+    void free_buf (char* p, size_t) { ++freed; delete[] p; }
+}
+
+TEST("strings are kept alive") {
+    string_iovec v;
+    {
+        string s1(100, 'a');
+        string s2 = "literal";
+        v = string_iovec{s1, string(), s2, s1.substr(50)};
+        CHECK(s1.use_count() == 3);
+        s1[0] = 'b'; // detaches, iovec still points to old buffer
+    }
+    CHECK(v.size() == 3);
+    CHECK(v.length() == 157);
+    CHECK(string_view((char*)v.data()[0].iov_base, v.data()[0].iov_len) == string(100, 'a'));
+    CHECK(string_view((char*)v.data()[1].iov_base, v.data()[1].iov_len) == "literal");
+}
+
+TEST("short strings are kept alive") {
+    string_iovec v;
+    {
+        string s1(5, 'a');
+        string s2 = to_string(12345);
+        v.add(s1);
+        v.add(s2);
+        s1[0] = 'b';
+    }
+    REQUIRE(v.size() == 2);
+    CHECK(string_view((char*)v.data()[0].iov_base, v.data()[0].iov_len) == "aaaaa");
+    CHECK(string_view((char*)v.data()[1].iov_base, v.data()[1].iov_len) == "12345");
+
+    v.consume(2);
+    string_iovec copy;
+    {
+        string_iovec tmp(v);
+        v.clear();
+        copy = tmp;
+    }
+    REQUIRE(copy.size() == 2);
+    CHECK(string_view((char*)copy.data()[0].iov_base, copy.data()[0].iov_len) == "aaa");
+    CHECK(string_view((char*)copy.data()[1].iov_base, copy.data()[1].iov_len) == "12345");
+}
+
+TEST("consume") {
+    std::vector<string> list = {string(10, 'a'), string(20, 'b'), string(30, 'c')};
+    string_iovec v(list.begin(), list.end());
+    v.consume(5);
+    CHECK(v.size() == 3);
+    CHECK(v.data()[0].iov_len == 5);
+    v.consume(10);
+    CHECK(v.size() == 2);
+    CHECK(v.data()[0].iov_len == 15);
+    CHECK(list[0].use_count() == 1);
+    CHECK(v.length() == 45);
+    v.consume(45);
+    CHECK(v.empty());
+    CHECK(list[2].use_count() == 1);
+}
+
+TEST("to_iovec") {
+    string arr[] = {"a", "", "bc"};
+    iovec iov[3];
+    CHECK(to_iovec(std::begin(arr), std::end(arr), iov, 3) == 2);
+    CHECK(iov[1].iov_len == 2);
+}
+
+TEST("adopt and slice") {
+    freed = 0;
+    iovec iov[3];
+    for (auto& v : iov) v = iovec{new char[16], 16};
+    memcpy(iov[0].iov_base, "HEAD1234567890ab", 16);
+    memcpy(iov[1].iov_base, "body", 4);
+    {
+        auto bufs = adopt_iovec(iov, 3, 20, free_buf);
+        CHECK(freed == 1); // unused buffer
+        REQUIRE(bufs.size() == 2);
+        CHECK(bufs[1] == "body");
+
+        auto pieces = slice(bufs[0], {4, 10});
+        REQUIRE(pieces.size() == 3);
+        CHECK(pieces[0] == "HEAD");
+        CHECK(pieces[0].data() == iov[0].iov_base);
+        CHECK(pieces[1] == "1234567890");
+        CHECK(pieces[2] == "ab");
+        bufs.clear();
+        CHECK(freed == 2); // second buffer
+        CHECK(pieces[2] == "ab");
+    }
+    CHECK(freed == 3);
+}
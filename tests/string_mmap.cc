@@ -0,0 +1,77 @@
+#include "test.h"
+#include <stdio.h>
+#include <system_error>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+TEST_PREFIX("string_mmap: ", "[string_mmap]");
+
+namespace {
+    struct TmpFile {
+        string path;
+        TmpFile (string_view content) : path("string_mmap_test.tmp") {
+            auto f = fopen(path.c_str(), "wb");
+            fwrite(content.data(), 1, content.length(), f);
+            fclose(f);
+        }
+        string read () const {
+            char buf[1000];
+            auto f = fopen(path.c_str(), "rb");
+            auto len = fread(buf, 1, sizeof(buf), f);
+            fclose(f);
+            return string(buf, len);
+        }
+        ~TmpFile () { remove(path.c_str()); }
+    };
+}
+
+TEST("map") {
+    string content(10000, 'x');
+    content += "key=value";
+    TmpFile file(content);
+
+    string sub;
+    {
+        auto s = string::from_file_mmap(file.path, string::MMAP_SEQUENTIAL | string::MMAP_WILLNEED);
+        CHECK(s.length() == content.length());
+        CHECK(s.substr(10000) == "key=value");
+        sub = s.substr(10004, 5);
+        CHECK(sub.data() == s.data() + 10004);
+    }
+    CHECK(sub == "value"); // mapping lives while any substring does
+}
+
+TEST("modification does not change file") {
+    TmpFile file("hello");
+    auto s = string::from_file_mmap(file.path);
+    s[0] = 'j';
+    CHECK(s == "jello");
+    CHECK(file.read() == "hello");
+    s += " world";
+    CHECK(s == "jello world");
+}
+
+TEST("empty file") {
+    TmpFile file("");
+    CHECK(string::from_file_mmap(file.path) == "");
+}
+
+TEST("no file") {
+    CHECK_THROWS_AS(string::from_file_mmap("/nonexistent/file"), std::system_error);
+}
+
+#ifndef _WIN32
+TEST("not a regular file") {
+    CHECK_THROWS_AS(string::from_file_mmap("."), std::system_error);
+    CHECK_THROWS_AS(string::from_file_mmap("/dev/null"), std::system_error);
+    if (access("/proc/self/status", R_OK) == 0) CHECK_THROWS_AS(string::from_file_mmap("/proc/self/status"), std::system_error);
+
+    string fifo = "string_mmap_test.fifo";
+    remove(fifo.c_str());
+    REQUIRE(mkfifo(fifo.c_str(), 0600) == 0);
+    CHECK_THROWS_AS(string::from_file_mmap(fifo), std::system_error); // doesn't block without writers
+    remove(fifo.c_str());
+}
+#endif
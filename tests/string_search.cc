@@ -0,0 +1,87 @@
+#include "test.h"
+#include <panda/string_search.h>
+#include <random>
+
+TEST_PREFIX("string_search: ", "[string_search]");
+
+using namespace panda::string_search;
+
+namespace {
+    struct LevelGuard {
+        Level prev = level();
+        ~LevelGuard () { set_level(prev); }
+    };
+
+    std::string random_string (std::mt19937& gen, size_t len, const char* alphabet) {
+        std::string ret(len, 0);
+        size_t cnt = strlen(alphabet);
+        for (auto& c : ret) c = alphabet[gen() % cnt];
+        return ret;
+    }
+
+    // results of panda::string_view must be the same as of std::string for any implementation
+    void check_same (const std::string& hs, const std::string& needle) {
+        string_view v(hs.data(), hs.length());
+        string_view n(needle.data(), needle.length());
+        for (size_t pos : {size_t(0), size_t(1), hs.length() / 2, hs.length() + 1, size_t(-1)}) {
+            CAPTURE(hs, needle, pos);
+            CHECK(v.find(n, pos)              == hs.find(needle, pos));
+            CHECK(v.rfind(n, pos)             == hs.rfind(needle, pos));
+            CHECK(v.find_first_of(n, pos)     == hs.find_first_of(needle, pos));
+            CHECK(v.find_last_of(n, pos)      == hs.find_last_of(needle, pos));
+            CHECK(v.find_first_not_of(n, pos) == hs.find_first_not_of(needle, pos));
+            CHECK(v.find_last_not_of(n, pos)  == hs.find_last_not_of(needle, pos));
+            if (needle.length()) {
+                CHECK(v.rfind(needle[0], pos)             == hs.rfind(needle[0], pos));
+                CHECK(v.find_first_not_of(needle[0], pos) == hs.find_first_not_of(needle[0], pos));
+                CHECK(v.find_last_not_of(needle[0], pos)  == hs.find_last_not_of(needle[0], pos));
+            }
+        }
+    }
+}
+
+TEST("all implementations give the same results") {
+    LevelGuard guard;
+    auto max = max_level();
+    for (auto lvl : {Level::SCALAR, Level::SSE2, Level::AVX2}) {
+        if (lvl > max) break;
+        set_level(lvl);
+        CHECK(level() == lvl);
+        std::mt19937 gen((int)lvl);
+        for (size_t len : {0, 1, 2, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000}) {
+            for (auto alphabet : {"ab", "abcdefgh", "\x80\xff" "a\x7f"}) {
+                auto hs = random_string(gen, len, alphabet);
+                check_same(hs, "");
+                for (size_t nlen : {1, 2, 3, 5, 16, 40}) {
+                    check_same(hs, random_string(gen, nlen, alphabet));
+                    if (nlen <= len) check_same(hs, hs.substr(gen() % (len - nlen + 1), nlen)); // existing substring
+                }
+            }
+        }
+    }
+}
+
+TEST("big sets") {
+    LevelGuard guard;
+    std::string set;
+    for (int c = 1; c < 256; c += 3) set += char(c);
+    std::string hs(1000, char(2));
+    hs[700] = char(4);
+    hs[100] = char(4);
+    for (auto lvl : {Level::SCALAR, Level::SSE2, Level::AVX2}) {
+        if (lvl > max_level()) break;
+        set_level(lvl);
+        check_same(hs, set);
+        CHECK(string_view(hs.data(), hs.length()).find_first_of(set.data(), 0, set.length()) == 100);
+        CHECK(string_view(hs.data(), hs.length()).find_last_of(set.data(), string_view::npos, set.length()) == 700);
+    }
+}
+
+TEST("basic_string uses kernels") {
+    string s = "GET /index.html HTTP/1.1\r\nHost: example.com\r\n\r\n";
+    CHECK(s.find("\r\n\r\n") == 43);
+    CHECK(s.rfind("\r\n") == 45);
+    CHECK(s.find_first_of(" \r\n") == 3);
+    CHECK(s.find_last_not_of("\r\n") == 42);
+    CHECK(wstring(L"abcabc").rfind(L"bc") == 4); // not accelerated
+}
@@ -0,0 +1,80 @@
+#include "test.h"
+#include <thread>
+#include <vector>
+
+TEST_PREFIX("shared_string: ", "[shared_string]");
+
+static_assert(shared_string::ATOMIC_REFCNT, "shared_string must have atomic refcnt");
+static_assert(!string::ATOMIC_REFCNT, "string must have plain refcnt");
+static_assert(sizeof(shared_string) == sizeof(string), "layout must be the same");
+
+TEST("cow") {
+    shared_string s(100, 'x');
+    auto s2 = s;
+    CHECK(s2.data() == s.data());
+    CHECK(s.use_count() == 2);
+    s2[0] = 'y';
+    CHECK(s2.data() != s.data());
+    CHECK(s.use_count() == 1);
+    CHECK(s[0] == 'x');
+
+    auto s3 = s;
+    s3.erase(10, 10);
+    CHECK(s3.length() == 90);
+    CHECK(s.length() == 100);
+    CHECK(s.use_count() == 1);
+}
+
+TEST("copies in different threads") {
+    shared_string s(1000, 'x');
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) threads.emplace_back([s]() mutable {
+        for (int j = 0; j < 100000; ++j) {
+            shared_string copy = s;
+            shared_string sub = copy.substr(1, 500);
+            if (sub.length() != 500) FAIL("bad length");
+        }
+        s.append("y"); // detaches
+        if (s.length() != 1001) FAIL("bad length");
+    });
+    for (auto& t : threads) t.join();
+    CHECK(s.use_count() == 1);
+    CHECK(s.length() == 1000);
+}
+
+TEST("conversion from/to string") {
+    SECTION("move unique buffer") {
+        string s(100, 'x');
+        auto ptr = s.data();
+        shared_string ss = std::move(s);
+        CHECK(ss.data() == ptr);
+        CHECK(ss.use_count() == 1);
+        string back = std::move(ss);
+        CHECK(back.data() == ptr);
+    }
+    SECTION("move shared buffer copies") {
+        string s(100, 'x');
+        auto s2 = s;
+        shared_string ss = std::move(s);
+        CHECK(ss.data() != s2.data());
+        CHECK(ss == s2);
+        CHECK(s2.use_count() == 1);
+    }
+    SECTION("copy never shares") {
+        shared_string ss(100, 'x');
+        string s = ss;
+        CHECK(s.data() != ss.data());
+        CHECK(s == ss);
+        CHECK(ss.use_count() == 1);
+    }
+    SECTION("swap") {
+        string s(100, 'x');
+        shared_string ss(50, 'y');
+        auto p1 = s.data(), p2 = ss.data();
+        s.swap(ss);
+        CHECK(s.data() == p2);
+        CHECK(ss.data() == p1);
+        CHECK(s.length() == 50);
+        CHECK(ss.length() == 100);
+    }
+}
@@ -1,6 +1,7 @@
 #include "test.h"
 #include <panda/string.h>
 #include <panda/from_chars.h>
+#include <random>
 
 TEST_PREFIX("to_chars: ", "[to_chars]");
 
@@ -114,3 +115,42 @@ TEST("uint16_t") { to_chars_test<uint16_t>(); }
 TEST("uint32_t") { to_chars_test<uint32_t>(); }
 TEST("uint64_t") { to_chars_test<uint64_t>(); }
 
+
+static_assert(panda::to_chars_maxsize<uint64_t>() == 20, "");
+static_assert(panda::to_chars_maxsize<int64_t>() == 20, "");
+static_assert(panda::to_chars_maxsize<int64_t>(2) == 65, "");
+static_assert(panda::to_chars_maxsize<uint32_t>(16) == 8, "");
+static_assert(panda::to_chars_maxsize<int8_t>() == 4, "");
+
+TEST("all lengths and bases") {
+    std::mt19937_64 gen(1);
+    char buf[100];
+    for (int i = 0; i < 20000; ++i) {
+        auto bits = gen() >> (gen() % 64);
+        for (auto base : {10, 16, 8}) {
+            auto fmt = base == 10 ? "%llu" : base == 16 ? "%llx" : "%llo";
+            auto sval = (int64_t)bits;
+            unsigned long long mag = sval < 0 ? 0 - bits : bits; // printf has no signed hex and octal
+            snprintf(buf, sizeof(buf), fmt, mag);
+            CHECK(tci<int64_t>(sval, base) == (sval < 0 ? "-" + string(buf) : string(buf)));
+            snprintf(buf, sizeof(buf), fmt, (unsigned long long)bits);
+            CHECK(tci<uint64_t>(bits, base) == string(buf));
+            snprintf(buf, sizeof(buf), base == 10 ? "%u" : base == 16 ? "%x" : "%o", (uint32_t)bits);
+            CHECK(tci<uint32_t>((uint32_t)bits, base) == string(buf));
+        }
+        auto len = tci<uint64_t>(bits).length();
+        CHECK(tci<uint64_t>(bits, 10, len) == tci<uint64_t>(bits));
+        CHECK_THROWS_AS(tci<uint64_t>(bits, 10, len - 1), Exc);
+    }
+}
+
+TEST("min in all bases") {
+    for (int base = 2; base <= 36; ++base) {
+        auto s = tci<int64_t>(std::numeric_limits<int64_t>::min(), base, panda::to_chars_maxsize<int64_t>(base));
+        CHECK(s.length() == panda::to_chars_maxsize<int64_t>(base));
+        int64_t val;
+        CHECK(!s.to_number(val, base).ec);
+        CHECK(val == std::numeric_limits<int64_t>::min());
+    }
+    CHECK(string::from_number(std::numeric_limits<int64_t>::min(), 2).length() == 65);
+}